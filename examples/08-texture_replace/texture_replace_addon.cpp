@@ -5,6 +5,7 @@
 
 #include <reshade.hpp>
 #include "config.hpp"
+#include <mutex>
 #include <vector>
 
 using namespace reshade::api;
@@ -18,6 +19,25 @@ static thread_local std::vector<std::vector<uint8_t>> s_data_to_delete;
 
 // See implementation in 'utils\load_texture_image.cpp'
 extern bool load_texture_image(const resource_desc &desc, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete);
+#if RESHADE_ADDON_TEXTURE_LOAD_ASYNC
+extern bool load_texture_image_async(const resource_desc &desc, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete, uint64_t &pending_key);
+extern bool get_pending_texture_image(const resource_desc &desc, uint64_t key, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete, bool &pending);
+
+// Replacement images that are still being decoded when a texture is created cannot be passed as initial data, so instead keep track of those textures and update them once decoding finished.
+// The key of the pending image is handed from the 'create_resource' to the 'init_resource' callback through a thread-local variable, for the same reasons as 's_data_to_delete' above.
+static thread_local uint64_t s_pending_key = 0;
+
+struct pending_texture
+{
+	device *owning_device;
+	resource texture;
+	resource_desc desc;
+	uint64_t key;
+};
+
+static std::mutex s_pending_textures_mutex;
+static std::vector<pending_texture> s_pending_textures;
+#endif
 
 static inline bool filter_texture(device *device, const resource_desc &desc, const subresource_box *box)
 {
@@ -41,16 +61,85 @@ static inline bool filter_texture(device *device, const resource_desc &desc, con
 
 static bool on_create_texture(device *device, resource_desc &desc, subresource_data *initial_data, resource_usage)
 {
+#if RESHADE_ADDON_TEXTURE_LOAD_ASYNC
+	s_pending_key = 0;
+#endif
+
 	if (!filter_texture(device, desc, nullptr))
 		return false;
 
+#if RESHADE_ADDON_TEXTURE_LOAD_ASYNC
+	// Immutable textures in D3D10 and D3D11 (which use the GPU-only heap) cannot be updated after creation, so replacements for those have to be decoded right away to pass them as initial data
+	// Default usage textures use the same heap, so cannot tell the two apart and have to decode synchronously for all of them
+	if ((device->get_api() == device_api::d3d10 || device->get_api() == device_api::d3d11) && desc.heap == memory_heap::gpu_only)
+		return initial_data != nullptr && load_texture_image(desc, *initial_data, s_data_to_delete);
+
+	return initial_data != nullptr && load_texture_image_async(desc, *initial_data, s_data_to_delete, s_pending_key);
+#else
 	return initial_data != nullptr && load_texture_image(desc, *initial_data, s_data_to_delete);
+#endif
 }
-static void on_after_create_texture(device *, const resource_desc &, const subresource_data *, resource_usage, resource)
+static void on_after_create_texture(device *device, const resource_desc &desc, const subresource_data *, resource_usage, resource resource)
 {
 	// Free the memory allocated via the 'load_texture_image' call above during the preceding 'create_resource' event that called in the 'on_create_texture' callback
 	s_data_to_delete.clear();
+
+#if RESHADE_ADDON_TEXTURE_LOAD_ASYNC
+	if (s_pending_key != 0)
+	{
+		const std::unique_lock<std::mutex> lock(s_pending_textures_mutex);
+		s_pending_textures.push_back({ device, resource, desc, s_pending_key });
+
+		s_pending_key = 0;
+	}
+#endif
+}
+#if RESHADE_ADDON_TEXTURE_LOAD_ASYNC
+static void on_destroy_texture(device *, resource resource)
+{
+	const std::unique_lock<std::mutex> lock(s_pending_textures_mutex);
+
+	for (auto it = s_pending_textures.begin(); it != s_pending_textures.end();)
+	{
+		if (it->texture == resource)
+			it = s_pending_textures.erase(it);
+		else
+			++it;
+	}
+}
+
+static void on_present(command_queue *queue, swapchain *, const rect *, const rect *, uint32_t, const rect *)
+{
+	device *const device = queue->get_device();
+
+	const std::unique_lock<std::mutex> lock(s_pending_textures_mutex);
+
+	for (auto it = s_pending_textures.begin(); it != s_pending_textures.end();)
+	{
+		if (it->owning_device != device)
+		{
+			++it;
+			continue;
+		}
+
+		bool pending = false;
+		subresource_data new_data;
+		std::vector<std::vector<uint8_t>> data_to_delete;
+		if (get_pending_texture_image(it->desc, it->key, new_data, data_to_delete, pending))
+		{
+			// Update texture with the new data now that it finished decoding
+			device->update_texture_region(new_data, it->texture, 0, nullptr);
+		}
+		else if (pending)
+		{
+			++it;
+			continue;
+		}
+
+		it = s_pending_textures.erase(it);
+	}
 }
+#endif
 
 static bool on_copy_texture(command_list *cmd_list, resource source, uint32_t source_subresource, const subresource_box *, resource dest, uint32_t dest_subresource, const subresource_box *dest_box, filter_mode)
 {
@@ -169,6 +258,10 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 		reshade::register_event<reshade::addon_event::update_texture_region>(on_update_texture);
 		reshade::register_event<reshade::addon_event::map_texture_region>(on_map_texture);
 		reshade::register_event<reshade::addon_event::unmap_texture_region>(on_unmap_texture);
+#if RESHADE_ADDON_TEXTURE_LOAD_ASYNC
+		reshade::register_event<reshade::addon_event::destroy_resource>(on_destroy_texture);
+		reshade::register_event<reshade::addon_event::present>(on_present);
+#endif
 		break;
 	case DLL_PROCESS_DETACH:
 		reshade::unregister_addon(hModule);
@@ -20,3 +20,7 @@
 #define RESHADE_ADDON_TEXTURE_LOAD_DIR ".\\texreplace"
 #define RESHADE_ADDON_TEXTURE_LOAD_FORMAT ".png"
 #define RESHADE_ADDON_TEXTURE_LOAD_HASH_TEXMOD 1
+// Maximum amount of memory in bytes to keep decoded replacement images in, so that textures that are recreated do not have to be decoded again
+#define RESHADE_ADDON_TEXTURE_LOAD_CACHE_SIZE (256 * 1024 * 1024)
+// Decode replacement images in the background during texture creation and update the textures once that finished, to reduce hitches at the cost of textures being replaced a few frames later
+#define RESHADE_ADDON_TEXTURE_LOAD_ASYNC 1
@@ -6,46 +6,307 @@
 #pragma once
 
 #include <cstdint>
+#include <cstring> // std::memcpy
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC32_HASH_TARGET_PCLMUL
+#else
+#include <immintrin.h>
+#define CRC32_HASH_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#endif
 
-inline uint32_t compute_crc32(const uint8_t *data, size_t size)
+/// <summary>
+/// CRC-32 (as used by zlib and PNG) and a fast 64-bit hash for identifying resource data.
+/// CRC-32 is computed with carry-less multiplication (if supported by the processor) or slicing-by-8 and always produces the same values as the bytewise reference algorithm.
+/// </summary>
+namespace crc32_hash
 {
-	static constexpr uint32_t crc32_table[256] = { // CRC polynomial 0xEDB88320
-		0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
-		0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
-		0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
-		0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
-		0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
-		0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-		0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
-		0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
-		0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-		0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
-		0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
-		0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-		0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
-		0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
-		0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
-		0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
-		0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
-		0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-		0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
-		0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
-		0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
-		0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
-		0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
-		0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-		0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
-		0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
-		0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-		0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
-		0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
-		0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-		0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
-		0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
-	};
-
-	uint32_t crc = 0xFFFFFFFF;
-	for (; size != 0; --size, ++data)
-		crc = (crc >> 8) ^ crc32_table[(crc ^ (*data)) & 0xFF];
-	return ~crc;
+	namespace internal
+	{
+		inline constexpr uint32_t crc32_table[256] = { // CRC polynomial 0xEDB88320
+			0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA, 0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
+			0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988, 0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
+			0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE, 0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
+			0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC, 0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
+			0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172, 0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
+			0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940, 0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
+			0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116, 0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
+			0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924, 0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
+			0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A, 0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
+			0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818, 0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
+			0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E, 0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
+			0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C, 0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
+			0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2, 0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
+			0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0, 0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
+			0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086, 0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
+			0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4, 0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
+			0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A, 0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
+			0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8, 0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
+			0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE, 0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
+			0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC, 0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
+			0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252, 0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
+			0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60, 0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
+			0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236, 0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
+			0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04, 0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
+			0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A, 0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
+			0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38, 0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
+			0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E, 0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
+			0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C, 0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
+			0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2, 0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
+			0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0, 0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
+			0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6, 0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
+			0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94, 0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D
+		};
+
+		struct crc32_slicing_tables
+		{
+			uint32_t data[8][256];
+		};
+
+		// Each table 'n' advances the CRC of a byte that is followed by 'n' further bytes, so that eight bytes can be processed with independent lookups
+		inline constexpr crc32_slicing_tables crc32_slicing = []() {
+			crc32_slicing_tables tables = {};
+			for (uint32_t i = 0; i < 256; ++i)
+				tables.data[0][i] = crc32_table[i];
+			for (uint32_t n = 1; n < 8; ++n)
+				for (uint32_t i = 0; i < 256; ++i)
+					tables.data[n][i] = (tables.data[n - 1][i] >> 8) ^ crc32_table[tables.data[n - 1][i] & 0xFF];
+			return tables;
+		}();
+
+		inline bool has_pclmul()
+		{
+			static const bool result = []() {
+#ifdef _MSC_VER
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 1)
+					return false;
+
+				// Folding uses PCLMULQDQ and the final extraction SSE4.1
+				__cpuid(info, 1);
+				return (info[2] & (1 << 1)) != 0 && (info[2] & (1 << 19)) != 0;
+#else
+				return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#endif
+			}();
+			return result;
+		}
+
+		inline uint32_t update_crc32_bytewise(uint32_t crc, const uint8_t *data, size_t size)
+		{
+			for (; size != 0; --size, ++data)
+				crc = (crc >> 8) ^ crc32_table[(crc ^ (*data)) & 0xFF];
+			return crc;
+		}
+
+		inline uint32_t update_crc32_slicing_by_8(uint32_t crc, const uint8_t *data, size_t size)
+		{
+			const auto &t = crc32_slicing.data;
+
+			for (; size >= 8; size -= 8, data += 8)
+			{
+				uint32_t lo, hi;
+				std::memcpy(&lo, data, sizeof(lo));
+				std::memcpy(&hi, data + 4, sizeof(hi));
+				lo ^= crc;
+
+				crc =
+					t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+					t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+			}
+
+			return update_crc32_bytewise(crc, data, size);
+		}
+
+		CRC32_HASH_TARGET_PCLMUL inline __m128i fold_128(__m128i value, __m128i next, __m128i k3k4)
+		{
+			const __m128i lo = _mm_clmulepi64_si128(value, k3k4, 0x00);
+			const __m128i hi = _mm_clmulepi64_si128(value, k3k4, 0x11);
+			return _mm_xor_si128(_mm_xor_si128(hi, next), lo);
+		}
+
+		/// <summary>
+		/// Folds 64 bytes at a time with carry-less multiplication and reduces the result with Barrett reduction (see "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction" by Intel).
+		/// Requires at least 64 bytes and processes a multiple of 16 bytes, so the caller has to handle any remainder.
+		/// </summary>
+		CRC32_HASH_TARGET_PCLMUL inline uint32_t update_crc32_pclmul(uint32_t crc, const uint8_t *data, size_t size)
+		{
+			// Constants for polynomial 0xEDB88320 in bit-reflected form
+			const __m128i k1k2 = _mm_set_epi64x(0x01C6E41596, 0x0154442BD4);
+			const __m128i k3k4 = _mm_set_epi64x(0x00CCAA009E, 0x01751997D0);
+			const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163CD6124);
+			const __m128i poly = _mm_set_epi64x(0x01F7011641, 0x01DB710641);
+			const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+			__m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x00));
+			__m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x10));
+			__m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x20));
+			__m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x30));
+			x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+			data += 64;
+			size -= 64;
+
+			for (; size >= 64; size -= 64, data += 64)
+			{
+				const __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+				const __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+				const __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+				const __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+
+				x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+				x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+				x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+				x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+
+				x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x00)));
+				x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x10)));
+				x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x20)));
+				x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 0x30)));
+			}
+
+			// Fold the four accumulators into one
+			x1 = fold_128(x1, x2, k3k4);
+			x1 = fold_128(x1, x3, k3k4);
+			x1 = fold_128(x1, x4, k3k4);
+
+			for (; size >= 16; size -= 16, data += 16)
+				x1 = fold_128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), k3k4);
+
+			// Fold 128 bits to 64 bits
+			x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+			x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+			x2 = _mm_srli_si128(x1, 4);
+			x1 = _mm_and_si128(x1, mask);
+			x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+			x1 = _mm_xor_si128(x1, x2);
+
+			// Barrett reduction to 32 bits
+			x2 = _mm_and_si128(x1, mask);
+			x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+			x2 = _mm_and_si128(x2, mask);
+			x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+			x1 = _mm_xor_si128(x1, x2);
+
+			return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+		}
+
+		inline uint64_t read_u64(const uint8_t *data)
+		{
+			uint64_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		inline uint32_t read_u32(const uint8_t *data)
+		{
+			uint32_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		inline uint64_t rotl64(uint64_t value, int shift)
+		{
+			return (value << shift) | (value >> (64 - shift));
+		}
+
+		inline constexpr uint64_t xxh64_prime1 = 0x9E3779B185EBCA87;
+		inline constexpr uint64_t xxh64_prime2 = 0xC2B2AE3D27D4EB4F;
+		inline constexpr uint64_t xxh64_prime3 = 0x165667B19E3779F9;
+		inline constexpr uint64_t xxh64_prime4 = 0x85EBCA77C2B2AE63;
+		inline constexpr uint64_t xxh64_prime5 = 0x27D4EB2F165667C5;
+
+		inline uint64_t xxh64_round(uint64_t acc, uint64_t input)
+		{
+			return rotl64(acc + input * xxh64_prime2, 31) * xxh64_prime1;
+		}
+		inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t value)
+		{
+			return (acc ^ xxh64_round(0, value)) * xxh64_prime1 + xxh64_prime4;
+		}
+	}
+
+	/// <summary>
+	/// Computes the CRC-32 checksum of the specified data.
+	/// </summary>
+	/// <param name="data">Pointer to the data to checksum.</param>
+	/// <param name="size">Size of the data in bytes.</param>
+	/// <param name="previous_crc">Checksum returned for the data preceding this block, to checksum data that is split across multiple blocks, or zero to start a new checksum.</param>
+	inline uint32_t compute_crc32(const uint8_t *data, size_t size, uint32_t previous_crc = 0)
+	{
+		uint32_t crc = ~previous_crc;
+
+		if (size >= 64 && internal::has_pclmul())
+		{
+			const size_t folded_size = size & ~static_cast<size_t>(15);
+			crc = internal::update_crc32_pclmul(crc, data, folded_size);
+			data += folded_size;
+			size -= folded_size;
+		}
+
+		return ~internal::update_crc32_slicing_by_8(crc, data, size);
+	}
+
+	/// <summary>
+	/// Computes a 64-bit non-cryptographic hash of the specified data (XXH64).
+	/// This produces a 64-bit result and therefore has fewer collisions than <see cref="compute_crc32"/> when used as a key for many different inputs, but its values are incompatible with it. It is not necessarily faster, since the latter uses hardware acceleration where available.
+	/// </summary>
+	/// <param name="data">Pointer to the data to hash.</param>
+	/// <param name="size">Size of the data in bytes.</param>
+	/// <param name="seed">Value to initialize the hash with.</param>
+	inline uint64_t compute_hash64(const uint8_t *data, size_t size, uint64_t seed = 0)
+	{
+		using namespace internal;
+
+		const uint8_t *const end = data + size;
+
+		uint64_t hash;
+		if (size >= 32)
+		{
+			uint64_t v1 = seed + xxh64_prime1 + xxh64_prime2;
+			uint64_t v2 = seed + xxh64_prime2;
+			uint64_t v3 = seed;
+			uint64_t v4 = seed - xxh64_prime1;
+
+			for (; end - data >= 32; data += 32)
+			{
+				v1 = xxh64_round(v1, read_u64(data + 0));
+				v2 = xxh64_round(v2, read_u64(data + 8));
+				v3 = xxh64_round(v3, read_u64(data + 16));
+				v4 = xxh64_round(v4, read_u64(data + 24));
+			}
+
+			hash = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+			hash = xxh64_merge_round(hash, v1);
+			hash = xxh64_merge_round(hash, v2);
+			hash = xxh64_merge_round(hash, v3);
+			hash = xxh64_merge_round(hash, v4);
+		}
+		else
+		{
+			hash = seed + xxh64_prime5;
+		}
+
+		hash += static_cast<uint64_t>(size);
+
+		for (; end - data >= 8; data += 8)
+			hash = rotl64(hash ^ xxh64_round(0, read_u64(data)), 27) * xxh64_prime1 + xxh64_prime4;
+		if (end - data >= 4)
+		{
+			hash = rotl64(hash ^ (static_cast<uint64_t>(read_u32(data)) * xxh64_prime1), 23) * xxh64_prime2 + xxh64_prime3;
+			data += 4;
+		}
+		for (; data != end; ++data)
+			hash = rotl64(hash ^ (*data * xxh64_prime5), 11) * xxh64_prime1;
+
+		hash ^= hash >> 33;
+		hash *= xxh64_prime2;
+		hash ^= hash >> 29;
+		hash *= xxh64_prime3;
+		hash ^= hash >> 32;
+
+		return hash;
+	}
 }
+
+using crc32_hash::compute_crc32;
+using crc32_hash::compute_hash64;
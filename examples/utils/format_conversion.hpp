@@ -0,0 +1,518 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <reshade_api_format.hpp>
+#include <cstdint>
+#include <cstring> // std::memcpy
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FORMAT_CONVERSION_TARGET_AVX2
+#else
+#include <immintrin.h>
+#define FORMAT_CONVERSION_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/// <summary>
+/// Row conversion kernels between texture formats and 8-bit RGBA.
+/// Each kernel processes as many pixels as possible with SSE2 (or AVX2, if supported by the processor) and finishes the remainder of the row with scalar code.
+/// </summary>
+namespace format_conversion
+{
+	/// <summary>
+	/// Instruction set extensions that the conversion kernels can make use of.
+	/// </summary>
+	enum class simd_level
+	{
+		scalar,
+		sse2,
+		avx2
+	};
+
+	namespace internal
+	{
+		inline bool has_avx2()
+		{
+#ifdef _MSC_VER
+			static const bool result = []() {
+				int info[4];
+				__cpuid(info, 0);
+				if (info[0] < 7)
+					return false;
+
+				// Check that the processor supports AVX and the operating system saves the YMM registers
+				__cpuid(info, 1);
+				if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+					return false;
+
+				__cpuidex(info, 7, 0);
+				return (info[1] & (1 << 5)) != 0;
+			}();
+			return result;
+#else
+			return __builtin_cpu_supports("avx2");
+#endif
+		}
+
+		inline simd_level &max_simd_level()
+		{
+			static simd_level level = has_avx2() ? simd_level::avx2 : simd_level::sse2;
+			return level;
+		}
+
+		inline uint32_t load_u32(const uint8_t *src)
+		{
+			uint32_t value;
+			std::memcpy(&value, src, sizeof(value));
+			return value;
+		}
+		inline void store_u32(uint8_t *dst, uint32_t value)
+		{
+			std::memcpy(dst, &value, sizeof(value));
+		}
+
+		inline uint32_t swap_red_blue(uint32_t value)
+		{
+			return (value & 0xFF00FF00) | ((value >> 16) & 0xFF) | ((value & 0xFF) << 16);
+		}
+		inline uint32_t unpack_r10g10b10a2(uint32_t value)
+		{
+			// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255) and multiply 2-bit alpha by 85 to get it into 8-bit range
+			const uint32_t a = value >> 30;
+			return ((value >> 2) & 0xFF) | (((value >> 12) & 0xFF) << 8) | (((value >> 22) & 0xFF) << 16) | ((a * 85) << 24);
+		}
+
+		inline __m128i swap_red_blue(__m128i value)
+		{
+			return _mm_or_si128(
+				_mm_and_si128(value, _mm_set1_epi32(0xFF00FF00)),
+				_mm_or_si128(
+					_mm_and_si128(_mm_srli_epi32(value, 16), _mm_set1_epi32(0xFF)),
+					_mm_slli_epi32(_mm_and_si128(value, _mm_set1_epi32(0xFF)), 16)));
+		}
+		inline __m128i unpack_r10g10b10a2(__m128i value)
+		{
+			const __m128i mask = _mm_set1_epi32(0xFF);
+			const __m128i r = _mm_and_si128(_mm_srli_epi32(value, 2), mask);
+			const __m128i g = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(value, 12), mask), 8);
+			const __m128i b = _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(value, 22), mask), 16);
+			// Multiplying 2-bit alpha by 85 is the same as repeating its bit pattern four times
+			__m128i a = _mm_srli_epi32(value, 30);
+			a = _mm_or_si128(a, _mm_slli_epi32(a, 2));
+			a = _mm_or_si128(a, _mm_slli_epi32(a, 4));
+			return _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, _mm_slli_epi32(a, 24)));
+		}
+
+		inline FORMAT_CONVERSION_TARGET_AVX2 __m256i swap_red_blue(__m256i value)
+		{
+			return _mm256_shuffle_epi8(value, _mm256_setr_epi8(
+				2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+				2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15));
+		}
+		inline FORMAT_CONVERSION_TARGET_AVX2 __m256i unpack_r10g10b10a2(__m256i value)
+		{
+			const __m256i mask = _mm256_set1_epi32(0xFF);
+			const __m256i r = _mm256_and_si256(_mm256_srli_epi32(value, 2), mask);
+			const __m256i g = _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(value, 12), mask), 8);
+			const __m256i b = _mm256_slli_epi32(_mm256_and_si256(_mm256_srli_epi32(value, 22), mask), 16);
+			__m256i a = _mm256_srli_epi32(value, 30);
+			a = _mm256_or_si256(a, _mm256_slli_epi32(a, 2));
+			a = _mm256_or_si256(a, _mm256_slli_epi32(a, 4));
+			return _mm256_or_si256(_mm256_or_si256(r, g), _mm256_or_si256(b, _mm256_slli_epi32(a, 24)));
+		}
+
+		template <bool swap, bool unpack_10bit, bool opaque>
+		FORMAT_CONVERSION_TARGET_AVX2 size_t convert_32bpp_avx2(const uint8_t *src, uint8_t *dst, size_t width)
+		{
+			size_t x = 0;
+
+			const __m256i alpha = _mm256_set1_epi32(opaque ? 0xFF000000 : 0);
+
+			for (; x + 8 <= width; x += 8)
+			{
+				__m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 4));
+				if constexpr (unpack_10bit)
+					value = unpack_r10g10b10a2(value);
+				if constexpr (swap)
+					value = swap_red_blue(value);
+				if constexpr (opaque)
+					value = _mm256_or_si256(value, alpha);
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * 4), value);
+			}
+
+			return x;
+		}
+
+		/// <summary>
+		/// Converts a row of 32-bit pixels, optionally swapping the red and blue channels, unpacking 10-bit channels and/or forcing alpha to opaque.
+		/// </summary>
+		template <bool swap, bool unpack_10bit, bool opaque>
+		void convert_32bpp(const uint8_t *src, uint8_t *dst, size_t width)
+		{
+			size_t x = 0;
+
+			const simd_level level = max_simd_level();
+
+			if (level >= simd_level::avx2)
+				x = convert_32bpp_avx2<swap, unpack_10bit, opaque>(src, dst, width);
+
+			if (level >= simd_level::sse2)
+			{
+				const __m128i alpha = _mm_set1_epi32(opaque ? 0xFF000000 : 0);
+
+				for (; x + 4 <= width; x += 4)
+				{
+					__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+					if constexpr (unpack_10bit)
+						value = unpack_r10g10b10a2(value);
+					if constexpr (swap)
+						value = swap_red_blue(value);
+					if constexpr (opaque)
+						value = _mm_or_si128(value, alpha);
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), value);
+				}
+			}
+
+			for (; x < width; ++x)
+			{
+				uint32_t value = load_u32(src + x * 4);
+				if constexpr (unpack_10bit)
+					value = unpack_r10g10b10a2(value);
+				if constexpr (swap)
+					value = swap_red_blue(value);
+				if constexpr (opaque)
+					value |= 0xFF000000;
+				store_u32(dst + x * 4, value);
+			}
+		}
+
+		/// <summary>
+		/// Expands a row of 8-bit single channel pixels to RGBA, with the channel value written to the components selected by <paramref name="channel_mask"/> and the remaining ones set to <paramref name="fill"/>.
+		/// </summary>
+		inline void expand_8bpp(const uint8_t *src, uint8_t *dst, size_t width, uint32_t channel_mask, uint32_t fill)
+		{
+			size_t x = 0;
+
+			const simd_level level = max_simd_level();
+
+			const __m128i mask = _mm_set1_epi32(channel_mask);
+			const __m128i fill_value = _mm_set1_epi32(fill);
+
+			for (; x + 16 <= width && level >= simd_level::sse2; x += 16)
+			{
+				const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+
+				// Broadcast every byte to all four bytes of a 32-bit lane
+				const __m128i value_lo = _mm_unpacklo_epi8(value, value);
+				const __m128i value_hi = _mm_unpackhi_epi8(value, value);
+
+				const __m128i result[4] = {
+					_mm_unpacklo_epi16(value_lo, value_lo),
+					_mm_unpackhi_epi16(value_lo, value_lo),
+					_mm_unpacklo_epi16(value_hi, value_hi),
+					_mm_unpackhi_epi16(value_hi, value_hi),
+				};
+
+				for (int i = 0; i < 4; ++i)
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + (x + i * 4) * 4), _mm_or_si128(_mm_and_si128(result[i], mask), fill_value));
+			}
+
+			for (; x < width; ++x)
+				store_u32(dst + x * 4, ((src[x] * 0x01010101u) & channel_mask) | fill);
+		}
+
+		/// <summary>
+		/// Expands a row of 16-bit two channel pixels to RGBA, either as red and green channel or as luminance and alpha.
+		/// </summary>
+		template <bool luminance_alpha>
+		void expand_16bpp(const uint8_t *src, uint8_t *dst, size_t width)
+		{
+			size_t x = 0;
+
+			const simd_level level = max_simd_level();
+
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i low_mask = _mm_set1_epi32(0xFF);
+			const __m128i opaque = _mm_set1_epi32(0xFF000000);
+
+			for (; x + 8 <= width && level >= simd_level::sse2; x += 8)
+			{
+				const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 2));
+
+				__m128i result[2] = {
+					_mm_unpacklo_epi16(value, zero),
+					_mm_unpackhi_epi16(value, zero),
+				};
+
+				for (int i = 0; i < 2; ++i)
+				{
+					if constexpr (luminance_alpha)
+					{
+						const __m128i l = _mm_and_si128(result[i], low_mask);
+						const __m128i a = _mm_srli_epi32(result[i], 8);
+						result[i] = _mm_or_si128(
+							_mm_or_si128(l, _mm_slli_epi32(l, 8)),
+							_mm_or_si128(_mm_slli_epi32(l, 16), _mm_slli_epi32(a, 24)));
+					}
+					else
+					{
+						result[i] = _mm_or_si128(result[i], opaque);
+					}
+				}
+
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4), result[0]);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 4 + 16), result[1]);
+			}
+
+			for (; x < width; ++x)
+			{
+				const uint32_t c0 = src[x * 2 + 0];
+				const uint32_t c1 = src[x * 2 + 1];
+				if constexpr (luminance_alpha)
+					store_u32(dst + x * 4, c0 | (c0 << 8) | (c0 << 16) | (c1 << 24));
+				else
+					store_u32(dst + x * 4, c0 | (c1 << 8) | 0xFF000000);
+			}
+		}
+
+		template <int channels>
+		FORMAT_CONVERSION_TARGET_AVX2 size_t narrow_32bpp_avx2(const uint8_t *src, uint8_t *dst, size_t width)
+		{
+			size_t x = 0;
+
+			// Pack the channels of each 128-bit lane to its start, then move the packed data of the upper lane right after that of the lower lane
+			const __m256i shuffle = channels == 1 ?
+				_mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1) :
+				channels == 2 ?
+				_mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1) :
+				_mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+			const __m256i permute = channels == 1 ?
+				_mm256_setr_epi32(0, 4, 1, 1, 1, 1, 1, 1) :
+				channels == 2 ?
+				_mm256_setr_epi32(0, 1, 4, 5, 2, 2, 2, 2) :
+				_mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 3);
+
+			// Each iteration writes a full 32 bytes, so stop while there is still enough space left in the destination row
+			for (; x + (32 + channels - 1) / channels <= width; x += 8)
+			{
+				const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 4));
+				_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x * channels), _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(value, shuffle), permute));
+			}
+
+			return x;
+		}
+
+		/// <summary>
+		/// Extracts the first <typeparamref name="channels"/> channels of a row of 8-bit RGBA pixels.
+		/// </summary>
+		template <int channels>
+		void narrow_32bpp(const uint8_t *src, uint8_t *dst, size_t width)
+		{
+			static_assert(channels >= 1 && channels <= 3);
+
+			size_t x = 0;
+
+			const simd_level level = max_simd_level();
+
+			if (level >= simd_level::avx2)
+				x = narrow_32bpp_avx2<channels>(src, dst, width);
+
+			if constexpr (channels == 3)
+			{
+				const __m128i mask_lo = _mm_set_epi32(0, 0xFFFFFF, 0, 0xFFFFFF);
+				const __m128i mask_hi = _mm_set_epi32(0xFFFFFF, 0, 0xFFFFFF, 0);
+
+				// Each iteration writes a full 16 bytes, so stop while there is still enough space left in the destination row
+				for (; x + 6 <= width && level >= simd_level::sse2; x += 4)
+				{
+					const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x * 4));
+
+					// Pack two pixels into the lower 48 bits of each 64-bit lane
+					const __m128i packed = _mm_or_si128(
+						_mm_and_si128(value, mask_lo),
+						_mm_srli_epi64(_mm_and_si128(value, mask_hi), 8));
+					// Then move the upper lane down to directly follow the lower lane
+					const __m128i result = _mm_or_si128(
+						_mm_and_si128(packed, _mm_set_epi32(0, 0, 0xFFFF, 0xFFFFFFFF)),
+						_mm_and_si128(_mm_srli_si128(packed, 2), _mm_set_epi32(0, 0xFFFFFFFF, 0xFFFF0000, 0)));
+					_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x * 3), result);
+				}
+			}
+
+			for (; x < width; ++x)
+				for (int c = 0; c < channels; ++c)
+					dst[x * channels + c] = src[x * 4 + c];
+		}
+	}
+
+	/// <summary>
+	/// Gets the instruction set extensions that the conversion kernels currently make use of.
+	/// </summary>
+	inline simd_level get_max_simd_level()
+	{
+		return internal::max_simd_level();
+	}
+	/// <summary>
+	/// Limits the instruction set extensions that the conversion kernels make use of, e.g. to compare the performance of the different code paths.
+	/// Levels that are not supported by the processor are clamped to the highest supported one.
+	/// </summary>
+	inline void set_max_simd_level(simd_level level)
+	{
+		if (level == simd_level::avx2 && !internal::has_avx2())
+			level = simd_level::sse2;
+		internal::max_simd_level() = level;
+	}
+
+	/// <summary>
+	/// Checks whether rows of the specified <paramref name="format"/> can be converted to 8-bit RGBA with <see cref="convert_row_to_rgba8"/>.
+	/// </summary>
+	inline bool can_convert_to_rgba8(reshade::api::format format)
+	{
+		switch (format)
+		{
+		case reshade::api::format::l8_unorm:
+		case reshade::api::format::a8_unorm:
+		case reshade::api::format::r8_typeless:
+		case reshade::api::format::r8_unorm:
+		case reshade::api::format::r8_snorm:
+		case reshade::api::format::l8a8_unorm:
+		case reshade::api::format::r8g8_typeless:
+		case reshade::api::format::r8g8_unorm:
+		case reshade::api::format::r8g8_snorm:
+		case reshade::api::format::r8g8b8a8_typeless:
+		case reshade::api::format::r8g8b8a8_unorm:
+		case reshade::api::format::r8g8b8a8_unorm_srgb:
+		case reshade::api::format::r8g8b8x8_unorm:
+		case reshade::api::format::r8g8b8x8_unorm_srgb:
+		case reshade::api::format::b8g8r8a8_typeless:
+		case reshade::api::format::b8g8r8a8_unorm:
+		case reshade::api::format::b8g8r8a8_unorm_srgb:
+		case reshade::api::format::b8g8r8x8_typeless:
+		case reshade::api::format::b8g8r8x8_unorm:
+		case reshade::api::format::b8g8r8x8_unorm_srgb:
+		case reshade::api::format::r10g10b10a2_typeless:
+		case reshade::api::format::r10g10b10a2_unorm:
+		case reshade::api::format::b10g10r10a2_typeless:
+		case reshade::api::format::b10g10r10a2_unorm:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	/// <summary>
+	/// Converts a row of <paramref name="width"/> pixels in the specified <paramref name="format"/> to 8-bit RGBA.
+	/// Channels missing from the source format are set to zero, except for alpha, which is set to opaque.
+	/// </summary>
+	/// <returns><see langword="true"/> if the format is supported, <see langword="false"/> otherwise.</returns>
+	inline bool convert_row_to_rgba8(reshade::api::format format, const uint8_t *src, uint8_t *dst, size_t width)
+	{
+		switch (format)
+		{
+		case reshade::api::format::l8_unorm:
+			internal::expand_8bpp(src, dst, width, 0x00FFFFFF, 0xFF000000);
+			return true;
+		case reshade::api::format::a8_unorm:
+			internal::expand_8bpp(src, dst, width, 0xFF000000, 0);
+			return true;
+		case reshade::api::format::r8_typeless:
+		case reshade::api::format::r8_unorm:
+		case reshade::api::format::r8_snorm:
+			internal::expand_8bpp(src, dst, width, 0x000000FF, 0xFF000000);
+			return true;
+		case reshade::api::format::l8a8_unorm:
+			internal::expand_16bpp<true>(src, dst, width);
+			return true;
+		case reshade::api::format::r8g8_typeless:
+		case reshade::api::format::r8g8_unorm:
+		case reshade::api::format::r8g8_snorm:
+			internal::expand_16bpp<false>(src, dst, width);
+			return true;
+		case reshade::api::format::r8g8b8a8_typeless:
+		case reshade::api::format::r8g8b8a8_unorm:
+		case reshade::api::format::r8g8b8a8_unorm_srgb:
+			if (src != dst)
+				std::memcpy(dst, src, width * 4);
+			return true;
+		case reshade::api::format::r8g8b8x8_unorm:
+		case reshade::api::format::r8g8b8x8_unorm_srgb:
+			internal::convert_32bpp<false, false, true>(src, dst, width);
+			return true;
+		case reshade::api::format::b8g8r8a8_typeless:
+		case reshade::api::format::b8g8r8a8_unorm:
+		case reshade::api::format::b8g8r8a8_unorm_srgb:
+			internal::convert_32bpp<true, false, false>(src, dst, width);
+			return true;
+		case reshade::api::format::b8g8r8x8_typeless:
+		case reshade::api::format::b8g8r8x8_unorm:
+		case reshade::api::format::b8g8r8x8_unorm_srgb:
+			internal::convert_32bpp<true, false, true>(src, dst, width);
+			return true;
+		case reshade::api::format::r10g10b10a2_typeless:
+		case reshade::api::format::r10g10b10a2_unorm:
+			internal::convert_32bpp<false, true, false>(src, dst, width);
+			return true;
+		case reshade::api::format::b10g10r10a2_typeless:
+		case reshade::api::format::b10g10r10a2_unorm:
+			internal::convert_32bpp<true, true, false>(src, dst, width);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	/// <summary>
+	/// Converts a row of <paramref name="width"/> 8-bit RGBA pixels to the specified <paramref name="format"/>.
+	/// Since the destination format is never larger than the source, <paramref name="dst"/> may point to the same memory as <paramref name="src"/>.
+	/// </summary>
+	/// <returns><see langword="true"/> if the format is supported, <see langword="false"/> otherwise.</returns>
+	inline bool convert_row_from_rgba8(reshade::api::format format, const uint8_t *src, uint8_t *dst, size_t width)
+	{
+		switch (format)
+		{
+		case reshade::api::format::l8_unorm:
+		case reshade::api::format::a8_unorm:
+		case reshade::api::format::r8_typeless:
+		case reshade::api::format::r8_unorm:
+		case reshade::api::format::r8_snorm:
+			internal::narrow_32bpp<1>(src, dst, width);
+			return true;
+		case reshade::api::format::l8a8_unorm:
+		case reshade::api::format::r8g8_typeless:
+		case reshade::api::format::r8g8_unorm:
+		case reshade::api::format::r8g8_snorm:
+			internal::narrow_32bpp<2>(src, dst, width);
+			return true;
+		case reshade::api::format::r8g8b8a8_typeless:
+		case reshade::api::format::r8g8b8a8_unorm:
+		case reshade::api::format::r8g8b8a8_unorm_srgb:
+		case reshade::api::format::r8g8b8x8_unorm:
+		case reshade::api::format::r8g8b8x8_unorm_srgb:
+			if (src != dst)
+				std::memmove(dst, src, width * 4);
+			return true;
+		case reshade::api::format::b8g8r8a8_typeless:
+		case reshade::api::format::b8g8r8a8_unorm:
+		case reshade::api::format::b8g8r8a8_unorm_srgb:
+		case reshade::api::format::b8g8r8x8_typeless:
+		case reshade::api::format::b8g8r8x8_unorm:
+		case reshade::api::format::b8g8r8x8_unorm_srgb:
+			internal::convert_32bpp<true, false, false>(src, dst, width);
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	/// <summary>
+	/// Removes the alpha channel from <paramref name="count"/> 8-bit RGBA pixels, producing tightly packed 8-bit RGB pixels.
+	/// <paramref name="dst"/> may point to the same memory as <paramref name="src"/>.
+	/// </summary>
+	inline void strip_alpha_rgba8(const uint8_t *src, uint8_t *dst, size_t count)
+	{
+		internal::narrow_32bpp<3>(src, dst, count);
+	}
+}
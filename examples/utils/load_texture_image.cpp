@@ -8,36 +8,59 @@
 #include <reshade.hpp>
 #include "config.hpp"
 #include "crc32_hash.hpp"
+#include "format_conversion.hpp"
+#include <list>
+#include <mutex>
+#include <memory>
 #include <vector>
+#include <fstream>
 #include <filesystem>
+#include <unordered_map>
 #include <stb_image.h>
 
 using namespace reshade::api;
 
-static std::filesystem::path make_texture_file_path(uint32_t texture_hash)
+struct replacement_image
 {
-	// Prepend executable directory to image files
-	wchar_t file_prefix[MAX_PATH] = L"";
-	GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
+	std::vector<uint8_t> pixel_data;
+	uint32_t row_pitch = 0;
+};
 
-	std::filesystem::path path = file_prefix;
-	path = path.parent_path();
-	path /= RESHADE_ADDON_TEXTURE_LOAD_DIR;
+struct replacement_files
+{
+	// Block compressed images are uploaded as is, so they are preferred over image files in the configured format for the same hash, which are only used if the DDS file does not fit the texture
+	std::filesystem::path dds_path;
+	std::filesystem::path image_path;
+};
+
+struct replacement_cache_entry
+{
+	std::shared_ptr<const replacement_image> image;
+	bool loading = false;
+	bool in_lru_list = false;
+	std::list<uint64_t>::iterator lru_position;
+};
 
-	wchar_t hash_string[11];
-	swprintf_s(hash_string, L"0x%08X", texture_hash);
+// Index of all image files in the replacement directory, so that checking whether a replacement exists for a texture does not have to touch the file system
+static std::once_flag s_replacement_index_built;
+static std::unordered_map<uint32_t, replacement_files> s_replacement_index;
 
-	path /= hash_string;
-	path += RESHADE_ADDON_TEXTURE_LOAD_FORMAT;
+// Decoded replacement images, so that textures that are recreated frequently do not have to be decoded again every time
+static std::mutex s_cache_mutex;
+static std::unordered_map<uint64_t, replacement_cache_entry> s_cache;
+static std::list<uint64_t> s_cache_lru; // Most recently used entry is at the front
+static size_t s_cache_size = 0;
 
-	return path;
+static constexpr uint32_t make_fourcc(char a, char b, char c, char d)
+{
+	return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
 }
 
-bool load_texture_image(const resource_desc &desc, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete)
+static uint32_t compute_texture_hash(const resource_desc &desc, const subresource_data &data)
 {
 #if RESHADE_ADDON_TEXTURE_LOAD_HASH_TEXMOD
 	// Behavior of the original TexMod (see https://github.com/codemasher/texmod/blob/master/uMod_DX9/uMod_TextureFunction.cpp#L41)
-	const uint32_t hash = ~compute_crc32(
+	return ~compute_crc32(
 		static_cast<const uint8_t *>(data.data),
 		desc.texture.height * static_cast<size_t>(
 			(desc.texture.format >= format::bc1_typeless && desc.texture.format <= format::bc1_unorm_srgb) || (desc.texture.format >= format::bc4_typeless && desc.texture.format <= format::bc4_snorm) ? (desc.texture.width * 4) / 8 :
@@ -45,23 +68,170 @@ bool load_texture_image(const resource_desc &desc, subresource_data &data, std::
 			format_row_pitch(desc.texture.format, desc.texture.width)));
 #else
 	// Correct hash calculation using entire resource data
-	const uint32_t hash = compute_crc32(
+	return compute_crc32(
 		static_cast<const uint8_t *>(data.data),
 		format_slice_pitch(desc.texture.format, data.row_pitch, desc.texture.height));
 #endif
+}
 
-	const std::filesystem::path file_path = make_texture_file_path(hash);
+static void build_replacement_index()
+{
+	// Prepend executable directory to image files
+	wchar_t file_prefix[MAX_PATH] = L"";
+	GetModuleFileNameW(nullptr, file_prefix, ARRAYSIZE(file_prefix));
 
-	// Check if a replacement file for this texture hash exists and if so, overwrite the texture data with its contents
-	if (!std::filesystem::exists(file_path))
-		return false;
+	std::filesystem::path directory = file_prefix;
+	directory = directory.parent_path();
+	directory /= RESHADE_ADDON_TEXTURE_LOAD_DIR;
+
+	const std::filesystem::path image_extension = RESHADE_ADDON_TEXTURE_LOAD_FORMAT;
+
+	std::error_code ec;
+	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory, std::filesystem::directory_options::skip_permission_denied, ec))
+	{
+		if (!entry.is_regular_file(ec))
+			continue;
+
+		const std::filesystem::path &path = entry.path();
+
+		const bool is_dds = _wcsicmp(path.extension().c_str(), L".dds") == 0;
+		if (!is_dds && _wcsicmp(path.extension().c_str(), image_extension.c_str()) != 0)
+			continue;
+
+		// File names have the format "0x%08X"
+		const std::wstring stem = path.stem().native();
+		if (stem.size() != 10 || stem[0] != L'0' || (stem[1] != L'x' && stem[1] != L'X'))
+			continue;
+
+		wchar_t *stem_end = nullptr;
+		const uint32_t hash = static_cast<uint32_t>(std::wcstoul(stem.c_str() + 2, &stem_end, 16));
+		if (*stem_end != L'\0')
+			continue;
+
+		replacement_files &files = s_replacement_index[hash];
+		(is_dds ? files.dds_path : files.image_path) = path;
+	}
+
+	reshade::log::message(reshade::log::level::info, "Found %zu replacement textures.", s_replacement_index.size());
+}
+
+static bool find_replacement(uint32_t hash, replacement_files &files)
+{
+	std::call_once(s_replacement_index_built, build_replacement_index);
+
+	// The index is never modified after it was built, so can be read without locking
+	if (const auto it = s_replacement_index.find(hash);
+		it != s_replacement_index.end())
+	{
+		files = it->second;
+		return true;
+	}
+
+	return false;
+}
+
+static std::shared_ptr<const replacement_image> load_dds_image(const std::filesystem::path &file_path, const resource_desc &desc)
+{
+	std::ifstream file(file_path, std::ios::binary);
+
+	uint32_t magic = 0;
+	uint32_t header[31] = {};
+	if (!file.read(reinterpret_cast<char *>(&magic), sizeof(magic)) || magic != make_fourcc('D', 'D', 'S', ' ') ||
+		!file.read(reinterpret_cast<char *>(header), sizeof(header)) || header[0] != sizeof(header))
+	{
+		reshade::log::message(reshade::log::level::error, "Failed to replace texture data because DDS file is invalid!");
+		return nullptr;
+	}
+
+	const uint32_t width = header[3];
+	const uint32_t height = header[2];
+	const uint32_t pixel_format_flags = header[19];
+	const uint32_t fourcc = header[20];
+
+	format dds_format = format::unknown;
+	if (pixel_format_flags & 0x4) // DDPF_FOURCC
+	{
+		switch (fourcc)
+		{
+		case make_fourcc('D', 'X', 'T', '1'):
+			dds_format = format::bc1_unorm;
+			break;
+		case make_fourcc('D', 'X', 'T', '2'):
+		case make_fourcc('D', 'X', 'T', '3'):
+			dds_format = format::bc2_unorm;
+			break;
+		case make_fourcc('D', 'X', 'T', '4'):
+		case make_fourcc('D', 'X', 'T', '5'):
+			dds_format = format::bc3_unorm;
+			break;
+		case make_fourcc('A', 'T', 'I', '1'):
+		case make_fourcc('B', 'C', '4', 'U'):
+			dds_format = format::bc4_unorm;
+			break;
+		case make_fourcc('A', 'T', 'I', '2'):
+		case make_fourcc('B', 'C', '5', 'U'):
+			dds_format = format::bc5_unorm;
+			break;
+		case make_fourcc('D', 'X', '1', '0'):
+			// Format values match the DXGI_FORMAT enumeration
+			if (uint32_t header_dx10[5] = {};
+				file.read(reinterpret_cast<char *>(header_dx10), sizeof(header_dx10)))
+				dds_format = static_cast<format>(header_dx10[0]);
+			break;
+		}
+	}
+	else if ((pixel_format_flags & 0x40) != 0 && header[21] == 32) // DDPF_RGB
+	{
+		if (header[22] == 0x000000FF && header[23] == 0x0000FF00 && header[24] == 0x00FF0000)
+			dds_format = format::r8g8b8a8_unorm;
+		else if (header[22] == 0x00FF0000 && header[23] == 0x0000FF00 && header[24] == 0x000000FF)
+			dds_format = format::b8g8r8a8_unorm;
+	}
+
+	// Only support changing pixel data, but not texture dimensions or format
+	if (desc.texture.width != width ||
+		desc.texture.height != height)
+	{
+		reshade::log::message(reshade::log::level::error, "Failed to replace texture data because dimensions do not match!");
+		return nullptr;
+	}
+	if (dds_format == format::unknown || format_to_typeless(dds_format) != format_to_typeless(desc.texture.format))
+	{
+		reshade::log::message(reshade::log::level::error, "Failed to replace texture data because format of DDS file does not match!");
+		return nullptr;
+	}
+
+	const auto image = std::make_shared<replacement_image>();
+	image->row_pitch = format_row_pitch(dds_format, width);
+
+	// Only the base level is replaced, so read just that from the file
+	image->pixel_data.resize(format_slice_pitch(dds_format, image->row_pitch, height));
+	if (!file.read(reinterpret_cast<char *>(image->pixel_data.data()), image->pixel_data.size()))
+	{
+		reshade::log::message(reshade::log::level::error, "Failed to replace texture data because DDS file is truncated!");
+		return nullptr;
+	}
+
+	return image;
+}
+
+static std::shared_ptr<const replacement_image> load_replacement_image(const replacement_files &files, const resource_desc &desc)
+{
+	if (!files.dds_path.empty())
+	{
+		// Fall back to the image file in the configured format if the DDS file cannot be used for this texture (e.g. because its format does not match)
+		if (std::shared_ptr<const replacement_image> image = load_dds_image(files.dds_path, desc);
+			image != nullptr || files.image_path.empty())
+			return image;
+	}
 
 	int width = 0, height = 0, channels = 0;
-	stbi_uc *const rgba_pixel_data_p = stbi_load(file_path.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	stbi_uc *const rgba_pixel_data_p = stbi_load(files.image_path.u8string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
 	if (rgba_pixel_data_p == nullptr)
-		return false;
+		return nullptr;
 
-	std::vector<uint8_t> pixel_data(rgba_pixel_data_p, rgba_pixel_data_p + static_cast<size_t>(width) * static_cast<size_t>(height) * 4);
+	const auto image = std::make_shared<replacement_image>();
+	image->pixel_data.assign(rgba_pixel_data_p, rgba_pixel_data_p + static_cast<size_t>(width) * static_cast<size_t>(height) * 4);
 
 	stbi_image_free(rgba_pixel_data_p);
 
@@ -70,87 +240,243 @@ bool load_texture_image(const resource_desc &desc, subresource_data &data, std::
 		desc.texture.height != static_cast<uint32_t>(height))
 	{
 		reshade::log::message(reshade::log::level::error, "Failed to replace texture data because dimensions do not match!");
-		return false;
+		return nullptr;
 	}
 
-	switch (desc.texture.format)
+	// Convert in place, which works since the image rows are tightly packed and the target format is never larger than RGBA
+	if (!format_conversion::convert_row_from_rgba8(desc.texture.format, image->pixel_data.data(), image->pixel_data.data(), static_cast<size_t>(width) * static_cast<size_t>(height)))
 	{
-	case format::l8_unorm:
-	case format::a8_unorm:
-	case format::r8_typeless:
-	case format::r8_unorm:
-	case format::r8_snorm:
-		for (size_t y = 0; y < static_cast<size_t>(height); ++y)
-		{
-			for (size_t x = 0; x < static_cast<size_t>(width); ++x)
-			{
-				const uint8_t *const src = pixel_data.data() + (y * width + x) * 4;
-				uint8_t *const dst = pixel_data.data() + (y * width + x);
+		reshade::log::message(reshade::log::level::error, "Failed to replace texture data because format is not supported!");
+		return nullptr;
+	}
 
-				dst[0] = src[0];
-			}
+	const uint32_t bytes_per_pixel = format_row_pitch(desc.texture.format, 1);
+
+	image->pixel_data.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * bytes_per_pixel);
+	image->row_pitch = width * bytes_per_pixel;
+
+	return image;
+}
+
+static uint64_t make_cache_key(uint32_t hash, const resource_desc &desc)
+{
+	// Converted image data depends on the texture format, so need to distinguish those
+	return (static_cast<uint64_t>(hash) << 32) | static_cast<uint32_t>(desc.texture.format);
+}
+
+static void cache_image(uint64_t key, std::shared_ptr<const replacement_image> image)
+{
+	const std::unique_lock<std::mutex> lock(s_cache_mutex);
+
+	replacement_cache_entry &entry = s_cache[key];
+	if (entry.image != nullptr)
+		s_cache_size -= entry.image->pixel_data.size();
+	if (entry.in_lru_list)
+		s_cache_lru.erase(entry.lru_position);
+
+	// Images that failed to load are kept too, so that it is not attempted again, but they do not count towards the cache size
+	entry.image = std::move(image);
+	entry.loading = false;
+	s_cache_lru.push_front(key);
+	entry.in_lru_list = true;
+	entry.lru_position = s_cache_lru.begin();
+
+	if (entry.image != nullptr)
+		s_cache_size += entry.image->pixel_data.size();
+
+	// Evict least recently used images until the cache fits into its budget again (but always keep the image that was just added)
+	while (s_cache_size > RESHADE_ADDON_TEXTURE_LOAD_CACHE_SIZE && s_cache_lru.size() > 1)
+	{
+		const auto it = s_cache.find(s_cache_lru.back());
+		s_cache_lru.pop_back();
+
+		if (it->second.image != nullptr)
+			s_cache_size -= it->second.image->pixel_data.size();
+		s_cache.erase(it);
+	}
+}
+
+/// <summary>
+/// Looks up an image in the cache.
+/// </summary>
+/// <returns><see langword="true"/> if the image was found or is currently being loaded, <see langword="false"/> otherwise.</returns>
+static bool find_cached_image(uint64_t key, std::shared_ptr<const replacement_image> &image, bool &loading)
+{
+	const std::unique_lock<std::mutex> lock(s_cache_mutex);
+
+	const auto it = s_cache.find(key);
+	if (it == s_cache.end())
+		return false;
+
+	image = it->second.image;
+	loading = it->second.loading;
+
+	if (it->second.in_lru_list)
+		s_cache_lru.splice(s_cache_lru.begin(), s_cache_lru, it->second.lru_position);
+
+	return true;
+}
+
+static void apply_image(const replacement_image &image, const resource_desc &desc, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete)
+{
+	// Copy the cached image, since the cache may evict it while the data is still in use
+	std::vector<uint8_t> &pixel_data = data_to_delete.emplace_back(image.pixel_data);
+
+	data.data = pixel_data.data();
+	data.row_pitch = image.row_pitch;
+	data.slice_pitch = format_slice_pitch(desc.texture.format, image.row_pitch, desc.texture.height);
+}
+
+#if RESHADE_ADDON_TEXTURE_LOAD_ASYNC
+struct replacement_load_task
+{
+	uint64_t key;
+	replacement_files files;
+	resource_desc desc;
+};
+
+static void CALLBACK load_replacement_image_callback(PTP_CALLBACK_INSTANCE, void *context)
+{
+	const std::unique_ptr<replacement_load_task> task(static_cast<replacement_load_task *>(context));
+
+	cache_image(task->key, load_replacement_image(task->files, task->desc));
+}
+
+static PTP_CALLBACK_ENVIRON get_callback_environment()
+{
+	static TP_CALLBACK_ENVIRON environment;
+	static std::once_flag environment_initialized;
+
+	std::call_once(environment_initialized, []() {
+		InitializeThreadpoolEnvironment(&environment);
+
+		// Keep the module containing this code loaded while any callback is still running, so that unloading the add-on does not unmap it while an image is still being decoded
+		HMODULE module = nullptr;
+		if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, reinterpret_cast<LPCWSTR>(&load_replacement_image_callback), &module))
+			SetThreadpoolCallbackLibrary(&environment, module);
+	});
+
+	return &environment;
+}
+
+static void queue_replacement_image(uint64_t key, const replacement_files &files, const resource_desc &desc)
+{
+	{
+		const std::unique_lock<std::mutex> lock(s_cache_mutex);
+
+		replacement_cache_entry &entry = s_cache[key];
+		if (entry.loading)
+			return;
+		entry.loading = true;
+
+		// Loading entries are not part of the least recently used list, so that they cannot be evicted before the load finished
+		if (entry.in_lru_list)
+		{
+			s_cache_lru.erase(entry.lru_position);
+			entry.in_lru_list = false;
 		}
-		pixel_data.resize(static_cast<size_t>(width) * static_cast<size_t>(height));
-		data.data = pixel_data.data();
-		data.row_pitch = width;
-		data.slice_pitch = data.row_pitch * height;
-		break;
-	case format::l8a8_unorm:
-	case format::r8g8_typeless:
-	case format::r8g8_unorm:
-	case format::r8g8_snorm:
-		for (size_t y = 0; y < static_cast<size_t>(height); ++y)
+		if (entry.image != nullptr)
 		{
-			for (size_t x = 0; x < static_cast<size_t>(width); ++x)
-			{
-				const uint8_t *const src = pixel_data.data() + (y * width + x) * 4;
-				uint8_t *const dst = pixel_data.data() + (y * width + x) * 2;
-
-				dst[0] = src[0];
-				dst[1] = src[1];
-			}
+			s_cache_size -= entry.image->pixel_data.size();
+			entry.image.reset();
 		}
-		pixel_data.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 2);
-		data.data = pixel_data.data();
-		data.row_pitch = width * 2;
-		data.slice_pitch = data.row_pitch * height;
-		break;
-	case format::r8g8b8a8_typeless:
-	case format::r8g8b8a8_unorm:
-	case format::r8g8b8a8_unorm_srgb:
-	case format::r8g8b8x8_unorm:
-	case format::r8g8b8x8_unorm_srgb:
-		data.data = pixel_data.data();
-		data.row_pitch = width * 4;
-		data.slice_pitch = data.row_pitch * height;
-		break;
-	case format::b8g8r8a8_typeless:
-	case format::b8g8r8a8_unorm:
-	case format::b8g8r8a8_unorm_srgb:
-	case format::b8g8r8x8_typeless:
-	case format::b8g8r8x8_unorm:
-	case format::b8g8r8x8_unorm_srgb:
-		for (size_t y = 0; y < static_cast<size_t>(height); ++y)
+	}
+
+	replacement_load_task *const task = new replacement_load_task { key, files, desc };
+	if (!TrySubmitThreadpoolCallback(&load_replacement_image_callback, task, get_callback_environment()))
+		load_replacement_image_callback(nullptr, task);
+}
+#endif
+
+bool load_texture_image(const resource_desc &desc, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete)
+{
+	const uint32_t hash = compute_texture_hash(desc, data);
+
+	// Check if a replacement file for this texture hash exists and if so, overwrite the texture data with its contents
+	replacement_files files;
+	if (!find_replacement(hash, files))
+		return false;
+
+	const uint64_t key = make_cache_key(hash, desc);
+
+	std::shared_ptr<const replacement_image> image;
+	if (bool loading = false;
+		!find_cached_image(key, image, loading) || loading)
+	{
+		// The data is needed right away, so load it on this thread (even if it is already being loaded in the background, to avoid waiting for that)
+		image = load_replacement_image(files, desc);
+		cache_image(key, image);
+	}
+
+	if (image == nullptr)
+		return false;
+
+	apply_image(*image, desc, data, data_to_delete);
+
+	return true;
+}
+
+#if RESHADE_ADDON_TEXTURE_LOAD_ASYNC
+bool load_texture_image_async(const resource_desc &desc, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete, uint64_t &pending_key)
+{
+	pending_key = 0;
+
+	const uint32_t hash = compute_texture_hash(desc, data);
+
+	replacement_files files;
+	if (!find_replacement(hash, files))
+		return false;
+
+	const uint64_t key = make_cache_key(hash, desc);
+
+	std::shared_ptr<const replacement_image> image;
+	if (bool loading = false;
+		!find_cached_image(key, image, loading) || loading)
+	{
+		// Load image in the background and let the caller update the texture once that finished, instead of stalling texture creation
+		queue_replacement_image(key, files, desc);
+		pending_key = key;
+		return false;
+	}
+
+	if (image == nullptr)
+		return false;
+
+	apply_image(*image, desc, data, data_to_delete);
+
+	return true;
+}
+
+bool get_pending_texture_image(const resource_desc &desc, uint64_t key, subresource_data &data, std::vector<std::vector<uint8_t>> &data_to_delete, bool &pending)
+{
+	std::shared_ptr<const replacement_image> image;
+	if (bool loading = false;
+		!find_cached_image(key, image, loading) || loading)
+	{
+		// Image may have been evicted again before it was picked up, so load it again in that case
+		if (!loading)
 		{
-			for (size_t x = 0; x < static_cast<size_t>(width); ++x)
+			replacement_files files;
+			if (!find_replacement(static_cast<uint32_t>(key >> 32), files))
 			{
-				uint8_t *const dst = pixel_data.data() + (y * width + x) * 4;
-
-				// Swap red and blue channel
-				std::swap(dst[0], dst[2]);
+				pending = false;
+				return false;
 			}
+
+			queue_replacement_image(key, files, desc);
 		}
-		data.data = pixel_data.data();
-		data.row_pitch = width * 4;
-		data.slice_pitch = data.row_pitch * height;
-		break;
-	default:
-		// Unsupported format
-		reshade::log::message(reshade::log::level::error, "Failed to replace texture data because format is not supported!");
+
+		pending = true;
 		return false;
 	}
 
-	data_to_delete.push_back(std::move(pixel_data));
+	pending = false;
+
+	if (image == nullptr)
+		return false;
+
+	apply_image(*image, desc, data, data_to_delete);
 
 	return true;
 }
+#endif
@@ -8,6 +8,7 @@
 #include <reshade.hpp>
 #include "config.hpp"
 #include "crc32_hash.hpp"
+#include "format_conversion.hpp"
 #include <vector>
 #include <filesystem>
 #include <stb_image_write.h>
@@ -150,103 +151,19 @@ bool save_texture_image(const resource_desc &desc, const subresource_data &data)
 	switch (desc.texture.format)
 	{
 	case format::l8_unorm:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
-
-				dst[0] = src[0];
-				dst[1] = src[0];
-				dst[2] = src[0];
-				dst[3] = 255;
-			}
-		}
-		break;
 	case format::a8_unorm:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
-
-				dst[0] = 0;
-				dst[1] = 0;
-				dst[2] = 0;
-				dst[3] = src[0];
-			}
-		}
-		break;
 	case format::r8_typeless:
 	case format::r8_unorm:
 	case format::r8_snorm:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
-
-				dst[0] = src[0];
-				dst[1] = 0;
-				dst[2] = 0;
-				dst[3] = 255;
-			}
-		}
-		break;
 	case format::l8a8_unorm:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x * 2;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
-
-				dst[0] = src[0];
-				dst[1] = src[0];
-				dst[2] = src[0];
-				dst[3] = src[1];
-			}
-		}
-		break;
 	case format::r8g8_typeless:
 	case format::r8g8_unorm:
 	case format::r8g8_snorm:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x * 2;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
-
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = 0;
-				dst[3] = 255;
-			}
-		}
-		break;
 	case format::r8g8b8a8_typeless:
 	case format::r8g8b8a8_unorm:
 	case format::r8g8b8a8_unorm_srgb:
 	case format::r8g8b8x8_unorm:
 	case format::r8g8b8x8_unorm_srgb:
-		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x * 4;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
-
-				dst[0] = src[0];
-				dst[1] = src[1];
-				dst[2] = src[2];
-				dst[3] = src[3];
-			}
-		}
-		break;
 	case format::b8g8r8a8_typeless:
 	case format::b8g8r8a8_unorm:
 	case format::b8g8r8a8_unorm_srgb:
@@ -254,19 +171,7 @@ bool save_texture_image(const resource_desc &desc, const subresource_data &data)
 	case format::b8g8r8x8_unorm:
 	case format::b8g8r8x8_unorm_srgb:
 		for (size_t y = 0; y < desc.texture.height; ++y, data_p += data.row_pitch)
-		{
-			for (size_t x = 0; x < desc.texture.width; ++x)
-			{
-				const uint8_t *const src = data_p + x * 4;
-				uint8_t *const dst = rgba_pixel_data.data() + (y * desc.texture.width + x) * 4;
-
-				// Swap red and blue channel
-				dst[0] = src[2];
-				dst[1] = src[1];
-				dst[2] = src[0];
-				dst[3] = src[3];
-			}
-		}
+			format_conversion::convert_row_to_rgba8(desc.texture.format, data_p, rgba_pixel_data.data() + y * desc.texture.width * 4, desc.texture.width);
 		break;
 	case format::bc1_typeless:
 	case format::bc1_unorm:
@@ -73,7 +73,8 @@ reshade::d3d12::device_impl::device_impl(ID3D12Device *device) :
 		descriptor_heap_cpu(device, D3D12_DESCRIPTOR_HEAP_TYPE_RTV),
 		descriptor_heap_cpu(device, D3D12_DESCRIPTOR_HEAP_TYPE_DSV) },
 	_gpu_view_heap(device),
-	_gpu_sampler_heap(device)
+	_gpu_sampler_heap(device),
+	_view_table(device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV))
 {
 	for (UINT type = 0; type < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++type)
 		_descriptor_handle_size[type] = device->GetDescriptorHandleIncrementSize(static_cast<D3D12_DESCRIPTOR_HEAP_TYPE>(type));
@@ -560,6 +561,7 @@ void reshade::d3d12::device_impl::destroy_resource_view(api::resource_view view)
 	D3D12_CPU_DESCRIPTOR_HANDLE descriptor_handle = { static_cast<SIZE_T>(view.handle) };
 
 	const std::unique_lock<std::shared_mutex> lock(_resource_mutex);
+	_view_table.erase(descriptor_handle.ptr);
 	_views.erase(descriptor_handle.ptr);
 
 	for (UINT i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
@@ -572,6 +574,10 @@ reshade::api::resource reshade::d3d12::device_impl::get_resource_from_view(api::
 
 	D3D12_CPU_DESCRIPTOR_HANDLE descriptor_handle = { static_cast<SIZE_T>(view.handle) };
 
+	if (ID3D12Resource *resource = nullptr;
+		_view_table.find(descriptor_handle.ptr, &resource, nullptr))
+		return to_handle(resource);
+
 	const std::shared_lock<std::shared_mutex> lock(_resource_mutex);
 
 	if (const auto it = _views.find(descriptor_handle.ptr); it != _views.end())
@@ -585,6 +591,10 @@ reshade::api::resource_view_desc reshade::d3d12::device_impl::get_resource_view_
 
 	D3D12_CPU_DESCRIPTOR_HANDLE descriptor_handle = { static_cast<SIZE_T>(view.handle) };
 
+	if (api::resource_view_desc desc;
+		_view_table.find(descriptor_handle.ptr, nullptr, &desc))
+		return desc;
+
 	const std::shared_lock<std::shared_mutex> lock(_resource_mutex);
 
 	if (const auto it = _views.find(descriptor_handle.ptr); it != _views.end())
@@ -597,24 +607,28 @@ uint64_t reshade::d3d12::device_impl::get_resource_view_gpu_address(api::resourc
 {
 	D3D12_CPU_DESCRIPTOR_HANDLE descriptor_handle = { static_cast<SIZE_T>(view.handle) };
 
-	const std::shared_lock<std::shared_mutex> lock(_resource_mutex);
+	ID3D12Resource *resource = nullptr;
+	api::resource_view_desc desc;
 
-	if (const auto it = _views.find(descriptor_handle.ptr); it != _views.end())
+	if (!_view_table.find(descriptor_handle.ptr, &resource, &desc))
 	{
-		switch (it->second.second.type)
-		{
-		case api::resource_view_type::buffer:
-			return it->second.first->GetGPUVirtualAddress() + it->second.second.buffer.offset;
-		case api::resource_view_type::acceleration_structure:
+		const std::shared_lock<std::shared_mutex> lock(_resource_mutex);
+
+		if (const auto it = _views.find(descriptor_handle.ptr); it != _views.end())
+			std::tie(resource, desc) = it->second;
+		else
 			return view.handle;
-		default:
-			assert(false);
-			return 0;
-		}
 	}
-	else
+
+	switch (desc.type)
 	{
+	case api::resource_view_type::buffer:
+		return resource->GetGPUVirtualAddress() + desc.buffer.offset;
+	case api::resource_view_type::acceleration_structure:
 		return view.handle;
+	default:
+		assert(false);
+		return 0;
 	}
 }
 
@@ -2096,6 +2110,7 @@ void reshade::d3d12::device_impl::register_resource(ID3D12Resource *resource, bo
 			_buffer_gpu_addresses.insert_or_assign(
 				address,
 				std::tuple<UINT64, ID3D12Resource *, bool >({ desc.Width, resource, acceleration_structure }));
+			_buffer_gpu_address_table.insert(resource, address, desc.Width, acceleration_structure);
 		}
 	}
 #else
@@ -2117,6 +2132,7 @@ void reshade::d3d12::device_impl::unregister_resource(ID3D12Resource *resource)
 		if (const auto it = _buffer_gpu_addresses.find(start_address);
 			it != _buffer_gpu_addresses.end() && std::get<ID3D12Resource *>(it->second) == resource)
 			_buffer_gpu_addresses.erase(it);
+		_buffer_gpu_address_table.erase(resource);
 	}
 #endif
 
@@ -2141,16 +2157,53 @@ void reshade::d3d12::device_impl::register_resource_view(D3D12_CPU_DESCRIPTOR_HA
 		desc = convert_resource_view_desc(resource->GetDesc());
 
 	const std::unique_lock<std::shared_mutex> lock(_resource_mutex);
-	_views.insert_or_assign(handle.ptr, std::make_pair(resource, std::move(desc)));
+
+	if (_view_table.insert(handle.ptr, resource, desc))
+	{
+		// Remove any entry left over from a time when this handle could not be stored in the view table
+		if (!_views.empty())
+			_views.erase(handle.ptr);
+	}
+	else
+	{
+		_views.insert_or_assign(handle.ptr, std::make_pair(resource, std::move(desc)));
+	}
 }
 void reshade::d3d12::device_impl::register_resource_view(D3D12_CPU_DESCRIPTOR_HANDLE handle, D3D12_CPU_DESCRIPTOR_HANDLE source_handle)
 {
 	const std::unique_lock<std::shared_mutex> lock(_resource_mutex);
 
-	if (const auto it = _views.find(source_handle.ptr); it != _views.end())
-		_views.insert_or_assign(handle.ptr, it->second);
+	// Copy between view table entries directly in the common case
+	if (_view_table.copy(handle.ptr, source_handle.ptr))
+	{
+		if (!_views.empty())
+			_views.erase(handle.ptr);
+		return;
+	}
+
+	ID3D12Resource *resource = nullptr;
+	api::resource_view_desc desc;
+
+	if (!_view_table.find(source_handle.ptr, &resource, &desc))
+	{
+		if (const auto it = _views.find(source_handle.ptr); it != _views.end())
+			std::tie(resource, desc) = it->second;
+		else
+		{
+			assert(false);
+			return;
+		}
+	}
+
+	if (_view_table.insert(handle.ptr, resource, desc))
+	{
+		if (!_views.empty())
+			_views.erase(handle.ptr);
+	}
 	else
-		assert(false);
+	{
+		_views.insert_or_assign(handle.ptr, std::make_pair(resource, desc));
+	}
 }
 
 reshade::d3d12::command_list_immediate_impl *reshade::d3d12::device_impl::get_immediate_command_list()
@@ -2182,6 +2235,18 @@ bool reshade::d3d12::device_impl::resolve_gpu_address(D3D12_GPU_VIRTUAL_ADDRESS
 	if (!address)
 		return true;
 
+	// Try lock-free lookup first, which succeeds for the vast majority of addresses
+	ID3D12Resource *resource = nullptr;
+	bool acceleration_structure = false;
+	if (_buffer_gpu_address_table.find(address, resource, *out_offset, acceleration_structure))
+	{
+		*out_resource = to_handle(resource);
+		if (out_acceleration_structure != nullptr)
+			*out_acceleration_structure = acceleration_structure;
+		return true;
+	}
+
+	// Otherwise fall back to an exact search, e.g. for addresses in pages shared by multiple buffers
 	const std::shared_lock<std::shared_mutex> lock(_resource_mutex);
 
 	// Find next resource placed above this address
@@ -7,6 +7,8 @@
 
 #include "descriptor_heap.hpp"
 #include "reshade_api_object_impl.hpp"
+#include "gpu_address_table.hpp"
+#include "descriptor_view_table.hpp"
 #include <map>
 #include <unordered_map>
 #include <concurrent_vector.h>
@@ -154,7 +156,10 @@ namespace reshade::d3d12
 #if RESHADE_ADDON >= 2
 		concurrency::concurrent_vector<D3D12DescriptorHeap *> _descriptor_heaps;
 		std::map<D3D12_GPU_VIRTUAL_ADDRESS, std::tuple<UINT64, ID3D12Resource *, bool>> _buffer_gpu_addresses;
+		gpu_address_table<ID3D12Resource *> _buffer_gpu_address_table;
 #endif
+		descriptor_view_table<ID3D12Resource *> _view_table;
+		// Views with descriptor handles that cannot be stored in the view table above
 		std::unordered_map<SIZE_T, std::pair<ID3D12Resource *, api::resource_view_desc>> _views;
 
 		com_ptr<ID3D12PipelineState> _mipmap_pipeline;
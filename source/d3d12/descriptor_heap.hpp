@@ -7,6 +7,7 @@
 
 #include <d3d12.h>
 #include "com_ptr.hpp"
+#include "descriptor_slot_allocator.hpp"
 #include <vector>
 #include <cassert>
 #include <shared_mutex>
@@ -15,100 +16,95 @@ namespace reshade::d3d12
 {
 	class descriptor_heap_cpu
 	{
-		struct heap_info
-		{
-			com_ptr<ID3D12DescriptorHeap> heap;
-			std::vector<bool> state;
-			SIZE_T heap_base = 0;
-		};
-
-		const UINT pool_size = 1024;
-
 	public:
 		descriptor_heap_cpu(ID3D12Device *device, D3D12_DESCRIPTOR_HEAP_TYPE type) :
-			_device(device), _type(type)
+			_device(device), _type(type), _slots(type)
 		{
 			_increment_size = device->GetDescriptorHandleIncrementSize(type);
 		}
+		descriptor_heap_cpu(const descriptor_heap_cpu &) = delete;
+
+		descriptor_heap_cpu &operator=(const descriptor_heap_cpu &) = delete;
 
 		bool allocate(D3D12_CPU_DESCRIPTOR_HANDLE &handle)
 		{
-			const std::unique_lock<std::shared_mutex> lock(_mutex);
-
-			for (int attempt = 0; attempt < 2; ++attempt)
-			{
-				for (heap_info &heap_info : _heap_infos)
-				{
-					// Find free empty in the heap
-					if (const auto it = std::find(heap_info.state.begin(), heap_info.state.end(), false);
-						it != heap_info.state.end())
-					{
-						const size_t index = it - heap_info.state.begin();
-						heap_info.state[index] = true; // Mark this entry as being in use
+			uint32_t slot;
+			if (!_slots.allocate(slot, [this](descriptor_slot_allocator &allocator) { return allocate_heap(allocator); }))
+				return false;
 
-						handle.ptr = heap_info.heap_base + index * _increment_size;
-						return true;
-					}
-				}
+			handle = convert_slot_to_handle(slot);
+			return true;
+		}
 
-				// No more space available in the existing heaps, so create a new one and try again
-				if (!allocate_heap())
-					break;
-			}
+		void free(D3D12_CPU_DESCRIPTOR_HANDLE handle)
+		{
+			uint32_t slot;
+			if (!convert_handle_to_slot(handle, slot))
+				return; // This handle was not allocated from this heap
 
-			return false;
+			_slots.free(slot);
 		}
 
-		void free(D3D12_CPU_DESCRIPTOR_HANDLE handle)
+	private:
+		D3D12_CPU_DESCRIPTOR_HANDLE convert_slot_to_handle(uint32_t slot) const
 		{
-			const std::unique_lock<std::shared_mutex> lock(_mutex);
+			const uint32_t pool_index = descriptor_slot_allocator::pool_of_slot(slot);
 
-			for (heap_info &heap_info : _heap_infos)
+			return { _heap_bases[pool_index] + (slot - descriptor_slot_allocator::pool_first_slot(pool_index)) * _increment_size };
+		}
+		bool convert_handle_to_slot(D3D12_CPU_DESCRIPTOR_HANDLE handle, uint32_t &slot) const
+		{
+			// Heaps are only ever added, so can search them without locking (there are at most a few, since they double in size)
+			for (uint32_t pool_index = 0, heap_count = _heap_count.load(std::memory_order_acquire); pool_index < heap_count; ++pool_index)
 			{
-				const SIZE_T heap_beg = heap_info.heap_base;
-				const SIZE_T heap_end = heap_info.heap_base + pool_size * _increment_size;
+				const SIZE_T heap_beg = _heap_bases[pool_index];
+				const SIZE_T heap_end = heap_beg + descriptor_slot_allocator::pool_size(pool_index) * _increment_size;
 
 				if (handle.ptr >= heap_beg && handle.ptr < heap_end)
 				{
-					const SIZE_T index = (handle.ptr - heap_beg) / _increment_size;
-
-					// Mark free slot in the descriptor heap
-					heap_info.state[index] = false;
-					break;
+					slot = descriptor_slot_allocator::pool_first_slot(pool_index) + static_cast<uint32_t>((handle.ptr - heap_beg) / _increment_size);
+					return true;
 				}
 			}
+
+			return false;
 		}
 
-	private:
-		bool allocate_heap()
+		bool allocate_heap(descriptor_slot_allocator &allocator)
 		{
-			heap_info &heap_info = _heap_infos.emplace_back();
+			const uint32_t pool_index = allocator.pool_count();
+			if (pool_index == descriptor_slot_allocator::max_pools)
+				return false;
 
 			D3D12_DESCRIPTOR_HEAP_DESC desc;
 			desc.Type = _type;
-			desc.NumDescriptors = pool_size;
+			desc.NumDescriptors = descriptor_slot_allocator::pool_size(pool_index);
 			desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 			desc.NodeMask = 0;
 
-			if (FAILED(_device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&heap_info.heap))))
-			{
-				_heap_infos.pop_back();
+			if (FAILED(_device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&_heaps[pool_index]))))
 				return false;
-			}
 
-			heap_info.heap_base = heap_info.heap->GetCPUDescriptorHandleForHeapStart().ptr;
-			heap_info.state.resize(pool_size);
+			_heap_bases[pool_index] = _heaps[pool_index]->GetCPUDescriptorHandleForHeapStart().ptr;
+
+			allocator.add_pool();
+			_heap_count.store(pool_index + 1, std::memory_order_release);
 
 			return true;
 		}
 
 		ID3D12Device *const _device;
-		std::vector<heap_info> _heap_infos;
+		com_ptr<ID3D12DescriptorHeap> _heaps[descriptor_slot_allocator::max_pools];
+		SIZE_T _heap_bases[descriptor_slot_allocator::max_pools] = {};
+		std::atomic<uint32_t> _heap_count = 0;
 		SIZE_T _increment_size;
 		D3D12_DESCRIPTOR_HEAP_TYPE _type;
-		std::shared_mutex _mutex;
+		// Each heap type uses its own thread cache, so that threads creating different kinds of views do not keep handing over their caches
+		concurrent_descriptor_slot_allocator _slots;
 	};
 
+	static_assert(D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES <= concurrent_descriptor_slot_allocator::max_cache_indices);
+
 	template <D3D12_DESCRIPTOR_HEAP_TYPE type, UINT static_size, UINT transient_size>
 	class descriptor_heap_gpu
 	{
@@ -0,0 +1,317 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <algorithm> // std::min, std::find
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace reshade
+{
+	/// <summary>
+	/// Allocation policy for descriptor slots, which is kept separate from the descriptor heaps themselves so that it does not depend on a device or graphics API.
+	/// Slots are grouped into pools that double in size, so that there are only ever a few pools to search and the pool a slot belongs to can be computed from its index directly.
+	/// Each pool tracks which of its slots are in use in a bitset, which is searched for free slots a word at a time.
+	/// This is not synchronized, so callers have to serialize access.
+	/// </summary>
+	class descriptor_slot_allocator
+	{
+		struct pool_info
+		{
+			std::vector<uint32_t> words;
+			uint32_t free_count = 0;
+			uint32_t first_free_word = 0; // All words before this one are completely in use
+		};
+
+	public:
+		static constexpr uint32_t base_pool_size = 1024;
+		static constexpr uint32_t max_pools = 16;
+
+		static uint32_t pool_size(uint32_t pool) { return base_pool_size << pool; }
+		static uint32_t pool_first_slot(uint32_t pool) { return base_pool_size * ((1u << pool) - 1); }
+		static uint32_t pool_of_slot(uint32_t slot)
+		{
+			return bit_scan_reverse(slot / base_pool_size + 1);
+		}
+
+		uint32_t pool_count() const { return static_cast<uint32_t>(_pools.size()); }
+
+		/// <summary>
+		/// Gets the number of slots that are currently allocated across all pools.
+		/// </summary>
+		uint32_t used_count() const
+		{
+			uint32_t count = 0;
+			for (uint32_t pool_index = 0; pool_index < pool_count(); ++pool_index)
+				count += pool_size(pool_index) - _pools[pool_index].free_count;
+			return count;
+		}
+
+		/// <summary>
+		/// Adds another pool of slots, twice the size of the previous one.
+		/// </summary>
+		bool add_pool()
+		{
+			if (_pools.size() == max_pools)
+				return false;
+
+			const uint32_t size = pool_size(pool_count());
+
+			pool_info &pool = _pools.emplace_back();
+			pool.words.resize(size / 32);
+			pool.free_count = size;
+
+			return true;
+		}
+
+		/// <summary>
+		/// Allocates up to <paramref name="count"/> free slots, preferring those in smaller pools.
+		/// </summary>
+		/// <returns>The number of slots that were allocated, which is less than requested if all pools are full.</returns>
+		uint32_t allocate(uint32_t *out_slots, uint32_t count)
+		{
+			uint32_t allocated = 0;
+
+			for (uint32_t pool_index = 0; pool_index < pool_count() && allocated < count; ++pool_index)
+			{
+				pool_info &pool = _pools[pool_index];
+
+				for (; pool.free_count != 0 && allocated < count; --pool.free_count)
+				{
+					while (pool.words[pool.first_free_word] == ~0u)
+						pool.first_free_word++;
+
+					uint32_t &word = pool.words[pool.first_free_word];
+
+					const uint32_t bit = bit_scan_forward(~word);
+					word |= 1u << bit;
+
+					out_slots[allocated++] = pool_first_slot(pool_index) + pool.first_free_word * 32 + bit;
+				}
+			}
+
+			return allocated;
+		}
+
+		/// <summary>
+		/// Marks the specified slots as free again.
+		/// </summary>
+		void free(const uint32_t *slots, uint32_t count)
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				const uint32_t pool_index = pool_of_slot(slots[i]);
+				assert(pool_index < pool_count());
+
+				pool_info &pool = _pools[pool_index];
+
+				const uint32_t index = slots[i] - pool_first_slot(pool_index);
+				const uint32_t word_index = index / 32;
+				assert((pool.words[word_index] & (1u << (index % 32))) != 0); // Slot was freed twice, or was never allocated
+
+				pool.words[word_index] &= ~(1u << (index % 32));
+				pool.free_count++;
+				pool.first_free_word = std::min(pool.first_free_word, word_index);
+			}
+		}
+
+	private:
+		static uint32_t bit_scan_forward(uint32_t value)
+		{
+			assert(value != 0);
+#ifdef _MSC_VER
+			unsigned long bit;
+			_BitScanForward(&bit, value);
+			return bit;
+#else
+			return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+		}
+		static uint32_t bit_scan_reverse(uint32_t value)
+		{
+			assert(value != 0);
+#ifdef _MSC_VER
+			unsigned long bit;
+			_BitScanReverse(&bit, value);
+			return bit;
+#else
+			return 31 - static_cast<uint32_t>(__builtin_clz(value));
+#endif
+		}
+
+		std::vector<pool_info> _pools;
+	};
+
+	/// <summary>
+	/// Thread-safe wrapper around <see cref="descriptor_slot_allocator"/>, which the CPU descriptor heaps of the graphics APIs build on.
+	/// Each thread keeps a few free slots around, so that most allocations and frees do not need to take a lock.
+	/// Threads only have a single cache per cache index, which is handed over when a thread switches to a different allocator with the same index (e.g. one per descriptor heap type, which threads rarely alternate between different devices of).
+	/// Slots left in the cache of a thread are returned to their owner when the thread exits, or discarded if the owner no longer exists by then.
+	/// </summary>
+	class concurrent_descriptor_slot_allocator
+	{
+		static constexpr uint32_t thread_cache_size = 64;
+
+		struct thread_cache
+		{
+			~thread_cache()
+			{
+				return_to_owner(*this);
+			}
+
+			uint64_t owner_id = 0;
+			uint32_t count = 0;
+			uint32_t slots[thread_cache_size];
+		};
+
+		struct instance_registry
+		{
+			std::shared_mutex mutex;
+			std::unordered_map<uint64_t, concurrent_descriptor_slot_allocator *> instances;
+		};
+
+	public:
+		static constexpr uint32_t max_cache_indices = 4;
+
+		explicit concurrent_descriptor_slot_allocator(uint32_t cache_index) :
+			_cache_index(cache_index), _id(s_next_id++)
+		{
+			assert(cache_index < max_cache_indices);
+
+			instance_registry &registry = get_registry();
+			const std::unique_lock<std::shared_mutex> lock(registry.mutex);
+			registry.instances.emplace(_id, this);
+		}
+		concurrent_descriptor_slot_allocator(const concurrent_descriptor_slot_allocator &) = delete;
+		~concurrent_descriptor_slot_allocator()
+		{
+			// Slots left in thread caches are discarded once those threads notice that this allocator no longer exists
+			instance_registry &registry = get_registry();
+			const std::unique_lock<std::shared_mutex> lock(registry.mutex);
+			registry.instances.erase(_id);
+		}
+
+		concurrent_descriptor_slot_allocator &operator=(const concurrent_descriptor_slot_allocator &) = delete;
+
+		/// <summary>
+		/// Allocates a slot, growing the underlying allocator if all pools are full.
+		/// </summary>
+		/// <param name="add_pool">Function that is called with the underlying allocator (while holding the lock) when it is full, which should add a pool and return <see langword="true"/>, or <see langword="false"/> if that is not possible.</param>
+		template <typename F>
+		bool allocate(uint32_t &slot, F &&add_pool)
+		{
+			thread_cache &cache = get_thread_cache();
+
+			if (cache.count == 0)
+			{
+				const std::unique_lock<std::shared_mutex> lock(_mutex);
+
+				// Refill only half the cache, so that subsequent frees do not immediately have to return slots again
+				cache.count = _allocator.allocate(cache.slots, thread_cache_size / 2);
+
+				// No more space available in the existing pools, so add a new one and try again
+				while (cache.count == 0 && add_pool(_allocator))
+					cache.count = _allocator.allocate(cache.slots, thread_cache_size / 2);
+
+				if (cache.count == 0)
+					return false;
+			}
+
+			slot = cache.slots[--cache.count];
+			return true;
+		}
+
+		/// <summary>
+		/// Frees a slot previously allocated with <see cref="allocate"/> (on any thread).
+		/// </summary>
+		void free(uint32_t slot)
+		{
+			thread_cache &cache = get_thread_cache();
+
+			// Freeing a slot twice would hand it out twice later on, and would only be caught by the allocator once the cache is flushed (if at all), so check for that here already
+			assert(std::find(cache.slots, cache.slots + cache.count, slot) == cache.slots + cache.count);
+
+			if (cache.count == thread_cache_size)
+			{
+				// Return the upper half of the cache in one go once it is full
+				const std::unique_lock<std::shared_mutex> lock(_mutex);
+				_allocator.free(cache.slots + thread_cache_size / 2, thread_cache_size / 2);
+				cache.count = thread_cache_size / 2;
+			}
+
+			cache.slots[cache.count++] = slot;
+		}
+
+		/// <summary>
+		/// Gets the number of slots that are allocated from the underlying allocator, which includes slots that are cached by threads.
+		/// </summary>
+		uint32_t used_count() const
+		{
+			const std::shared_lock<std::shared_mutex> lock(_mutex);
+			return _allocator.used_count();
+		}
+
+	private:
+		static instance_registry &get_registry()
+		{
+			// This is never destroyed, since threads may still exit (and return their cached slots) after static destructors ran
+			static instance_registry *const registry = new instance_registry();
+			return *registry;
+		}
+
+		thread_cache &get_thread_cache()
+		{
+			thread_cache &cache = s_thread_caches[_cache_index];
+
+			if (cache.owner_id != _id)
+			{
+				// Thread switched to a different allocator with the same cache index, so return the cached slots of the previous one before reusing the cache
+				return_to_owner(cache);
+				cache.owner_id = _id;
+			}
+
+			return cache;
+		}
+
+		static void return_to_owner(thread_cache &cache)
+		{
+			if (cache.count == 0)
+				return;
+
+			instance_registry &registry = get_registry();
+			const std::shared_lock<std::shared_mutex> lock(registry.mutex);
+
+			if (const auto it = registry.instances.find(cache.owner_id);
+				it != registry.instances.end())
+			{
+				concurrent_descriptor_slot_allocator *const owner = it->second;
+
+				const std::unique_lock<std::shared_mutex> owner_lock(owner->_mutex);
+				owner->_allocator.free(cache.slots, cache.count);
+			}
+
+			cache.count = 0;
+		}
+
+		descriptor_slot_allocator _allocator;
+		const uint32_t _cache_index;
+		const uint64_t _id;
+		mutable std::shared_mutex _mutex;
+
+		static inline std::atomic<uint64_t> s_next_id = 1;
+		static thread_local thread_cache s_thread_caches[max_cache_indices];
+	};
+
+	inline thread_local concurrent_descriptor_slot_allocator::thread_cache concurrent_descriptor_slot_allocator::s_thread_caches[max_cache_indices];
+}
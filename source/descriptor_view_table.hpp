@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "reshade_api_resource.hpp"
+#include <atomic>
+#include <cassert>
+#include <cstring> // std::memcpy
+#include <type_traits>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+
+namespace reshade
+{
+	/// <summary>
+	/// Maps CPU descriptor handles to the resource and view description last written to them, with lookups that do not take any locks.
+	/// Resources are identified by a handle of type <typeparamref name="T"/> (e.g. a pointer to the native resource object), which has to be cheap to copy.
+	/// Descriptor handles are addresses of descriptors laid out densely in their heaps, so dividing them by the descriptor size yields an index, which is used to look up an entry in a radix tree that only ever grows.
+	/// The table is keyed by the size of the descriptors that are most common (shader resource views), so that leaves are fully used by their heaps. Descriptors of types that are smaller may map to the same entry as their neighbors, in which case only the first one is stored.
+	/// Nodes are kept small, so that the many small heaps applications tend to scatter across the address space only cost a few kilobytes each, at the expense of a deeper tree.
+	/// Entries are guarded by a sequence counter, so that a lookup racing with a modification notices and retries, rather than returning a torn view description.
+	/// Operations may fail for handles that cannot be represented (e.g. when they are outside the covered range or collide with another handle), so callers should fall back to a different container in that case.
+	/// Modifications are not synchronized and have to be serialized by the caller.
+	/// </summary>
+	template <typename T>
+	class descriptor_view_table
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		static constexpr unsigned int leaf_bits = 6;
+		static constexpr unsigned int inner_bits = 8;
+		static constexpr unsigned int root_bits = 12;
+		static constexpr unsigned int address_bits = 47; // User mode address space
+		static constexpr unsigned int max_inner_levels = 4; // Enough to cover the address space with descriptor sizes of 2 bytes or more
+
+		static_assert(sizeof(api::resource_view_desc) == 3 * sizeof(uint64_t));
+
+		struct entry
+		{
+			std::atomic<uint32_t> sequence = 0; // Odd while the entry is being modified
+			std::atomic<uint64_t> handle = 0;
+			std::atomic<T> resource = T {};
+			std::atomic<uint64_t> desc[3] = {};
+		};
+
+		struct leaf_node
+		{
+			entry entries[1 << leaf_bits];
+		};
+		struct inner_node
+		{
+			std::atomic<void *> children[1 << inner_bits] = {}; // Either inner nodes or leaves, depending on the level
+		};
+
+	public:
+		/// <param name="increment_size">Distance between consecutive descriptors in a heap of the most common descriptor type.</param>
+		explicit descriptor_view_table(uint32_t increment_size)
+		{
+			// Descriptors are at least this far apart, so all bits below the largest power of two that fits are redundant
+			unsigned int shift = 0;
+			while ((increment_size >> (shift + 1)) != 0)
+				shift++;
+			_handle_shift = shift < 1 ? 1 : shift;
+
+			// Use as few inner levels as possible, with the root covering whatever bits are left over
+			const unsigned int index_bits = address_bits - _handle_shift;
+			while (leaf_bits + _inner_levels * inner_bits + root_bits < index_bits)
+				_inner_levels++;
+			assert(_inner_levels <= max_inner_levels);
+		}
+		descriptor_view_table(const descriptor_view_table &) = delete;
+		~descriptor_view_table()
+		{
+			for (std::atomic<void *> &root_child : _root)
+				delete_node(root_child.load(std::memory_order_relaxed), _inner_levels);
+		}
+
+		descriptor_view_table &operator=(const descriptor_view_table &) = delete;
+
+		/// <summary>
+		/// Sets the view that was written to the descriptor at the specified <paramref name="handle"/>.
+		/// </summary>
+		/// <returns><see langword="true"/> if the view was stored, or <see langword="false"/> if the handle cannot be represented in this table.</returns>
+		bool insert(uint64_t handle, T resource, const api::resource_view_desc &desc)
+		{
+			assert(handle != 0);
+
+			entry *const slot = get_entry(handle, true);
+			if (slot == nullptr)
+				return false;
+
+			// Another descriptor handle maps to the same entry, which can only happen if handles are not laid out like expected
+			if (const uint64_t existing_handle = slot->handle.load(std::memory_order_relaxed);
+				existing_handle != 0 && existing_handle != handle)
+				return false;
+
+			uint64_t desc_data[3];
+			std::memcpy(desc_data, &desc, sizeof(desc));
+
+			write_entry(*slot, handle, resource, desc_data);
+			return true;
+		}
+
+		/// <summary>
+		/// Copies the view stored for the descriptor at <paramref name="source_handle"/> to the descriptor at <paramref name="handle"/>.
+		/// </summary>
+		/// <returns><see langword="true"/> if the view was copied, or <see langword="false"/> if either handle cannot be represented in this table or no view is stored for the source descriptor.</returns>
+		bool copy(uint64_t handle, uint64_t source_handle)
+		{
+			const entry *const source_entry = get_entry(source_handle, false);
+			if (source_entry == nullptr || source_entry->handle.load(std::memory_order_relaxed) != source_handle)
+				return false;
+
+			entry *const slot = get_entry(handle, true);
+			if (slot == nullptr)
+				return false;
+
+			if (const uint64_t existing_handle = slot->handle.load(std::memory_order_relaxed);
+				existing_handle != 0 && existing_handle != handle)
+				return false;
+
+			// Modifications are serialized, so can read the source entry without checking its sequence counter
+			uint64_t desc_data[3];
+			for (size_t i = 0; i < 3; ++i)
+				desc_data[i] = source_entry->desc[i].load(std::memory_order_relaxed);
+
+			write_entry(*slot, handle, source_entry->resource.load(std::memory_order_relaxed), desc_data);
+			return true;
+		}
+
+		/// <summary>
+		/// Removes the view stored for the descriptor at the specified <paramref name="handle"/>.
+		/// </summary>
+		void erase(uint64_t handle)
+		{
+			entry *const slot = get_entry(handle, false);
+			if (slot == nullptr || slot->handle.load(std::memory_order_relaxed) != handle)
+				return;
+
+			const uint64_t desc_data[3] = {};
+			write_entry(*slot, 0, T {}, desc_data);
+		}
+
+		/// <summary>
+		/// Finds the view stored for the descriptor at the specified <paramref name="handle"/>. This may be called concurrently with modifications.
+		/// </summary>
+		bool find(uint64_t handle, T *out_resource, api::resource_view_desc *out_desc) const
+		{
+			const entry *const slot = get_entry(handle, false);
+			if (slot == nullptr)
+				return false;
+
+			uint64_t entry_handle;
+			T resource;
+			uint64_t desc_data[3];
+
+			// Retry until the entry was read without being modified at the same time (which only takes a few instructions, so this spins rarely and briefly)
+			for (uint32_t sequence = 0;; _mm_pause())
+			{
+				sequence = slot->sequence.load(std::memory_order_acquire);
+				if ((sequence & 1) != 0)
+					continue;
+
+				entry_handle = slot->handle.load(std::memory_order_relaxed);
+				resource = slot->resource.load(std::memory_order_relaxed);
+				for (size_t i = 0; i < 3; ++i)
+					desc_data[i] = slot->desc[i].load(std::memory_order_relaxed);
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot->sequence.load(std::memory_order_relaxed) == sequence)
+					break;
+			}
+
+			if (entry_handle != handle)
+				return false;
+
+			if (out_resource != nullptr)
+				*out_resource = resource;
+			if (out_desc != nullptr)
+				std::memcpy(out_desc, desc_data, sizeof(*out_desc));
+			return true;
+		}
+
+		/// <summary>
+		/// Gets the number of bytes allocated for the nodes of this table. This has to be serialized with modifications.
+		/// </summary>
+		size_t memory_usage() const { return _memory_usage; }
+
+	private:
+		entry *get_entry(uint64_t handle, bool create) const
+		{
+			const uint64_t index = handle >> _handle_shift;
+
+			unsigned int bits = leaf_bits + _inner_levels * inner_bits;
+			if ((index >> bits) >= (1 << root_bits))
+				return nullptr;
+
+			std::atomic<void *> *child = &_root[index >> bits];
+			for (unsigned int level = _inner_levels; level != 0; --level)
+			{
+				inner_node *const inner = get_child<inner_node>(*child, create);
+				if (inner == nullptr)
+					return nullptr;
+
+				bits -= inner_bits;
+				child = &inner->children[(index >> bits) & ((1 << inner_bits) - 1)];
+			}
+
+			leaf_node *const leaf = get_child<leaf_node>(*child, create);
+			if (leaf == nullptr)
+				return nullptr;
+
+			return &leaf->entries[index & ((1 << leaf_bits) - 1)];
+		}
+
+		template <typename node_type>
+		node_type *get_child(std::atomic<void *> &child, bool create) const
+		{
+			node_type *node = static_cast<node_type *>(child.load(std::memory_order_acquire));
+			if (node == nullptr && create)
+			{
+				child.store(node = new node_type(), std::memory_order_release);
+				_memory_usage += sizeof(node_type);
+			}
+			return node;
+		}
+
+		static void delete_node(void *node, unsigned int level)
+		{
+			if (node == nullptr)
+				return;
+
+			if (level == 0)
+			{
+				delete static_cast<leaf_node *>(node);
+				return;
+			}
+
+			inner_node *const inner = static_cast<inner_node *>(node);
+			for (std::atomic<void *> &child : inner->children)
+				delete_node(child.load(std::memory_order_relaxed), level - 1);
+			delete inner;
+		}
+
+		static void write_entry(entry &entry, uint64_t handle, T resource, const uint64_t desc_data[3])
+		{
+			const uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+			entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			entry.handle.store(handle, std::memory_order_relaxed);
+			entry.resource.store(resource, std::memory_order_relaxed);
+			for (size_t i = 0; i < 3; ++i)
+				entry.desc[i].store(desc_data[i], std::memory_order_relaxed);
+
+			entry.sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+		mutable std::atomic<void *> _root[1 << root_bits] = {};
+		mutable size_t _memory_usage = sizeof(_root);
+		unsigned int _handle_shift = 0;
+		unsigned int _inner_levels = 0;
+	};
+}
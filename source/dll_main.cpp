@@ -8,6 +8,7 @@
 #include "ini_file.hpp"
 #include "hook_manager.hpp"
 #include "addon_manager.hpp"
+#include "temp_mem_arena.hpp"
 #include <Windows.h>
 #include <Psapi.h>
 #ifndef NDEBUG
@@ -352,6 +353,10 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD fdwReason, LPVOID)
 				reshade::log::message(reshade::log::level::warning, "Add-ons are still loaded! Application may crash on exit.");
 #endif
 
+			if (const reshade::temp_mem_arena::statistics temp_mem_stats = reshade::temp_mem_arena::get_statistics();
+				temp_mem_stats.heap_allocations != 0)
+				reshade::log::message(reshade::log::level::debug, "Temporary memory arena served %llu allocations (peak usage of %zu bytes), %llu had to fall back to the heap.", temp_mem_stats.arena_allocations, temp_mem_stats.peak_usage, temp_mem_stats.heap_allocations);
+
 			reshade::hooks::uninstall();
 
 			// Module is now invalid, so break out of any message loops that may still have it in the call stack (see 'HookGetMessage' implementation in input.cpp)
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "effect_cache_archive.hpp"
+#include "dll_log.hpp"
+#include <cassert>
+#include <cstring> // std::memcpy
+#include <Windows.h>
+
+static constexpr uint32_t archive_magic = 0x58465352; // "RSFX"
+static constexpr uint32_t archive_version = 1;
+static constexpr uint32_t entry_magic = 0x45465352; // "RSFE"
+
+struct archive_header
+{
+	uint32_t magic;
+	uint32_t version;
+};
+struct entry_header
+{
+	uint32_t magic;
+	uint32_t key_size;
+	uint64_t data_size;
+	uint64_t checksum;
+};
+
+static uint64_t compute_checksum(const std::string_view key, const std::string_view data)
+{
+	// 64-bit FNV-1a hash, which is stable across builds (unlike 'std::hash')
+	uint64_t hash = 14695981039346656037ull;
+	for (const char c : key)
+		hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+	for (const char c : data)
+		hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+	return hash;
+}
+
+static bool write_file(HANDLE file, const void *data, size_t size)
+{
+	DWORD size_written = 0;
+	return WriteFile(file, data, static_cast<DWORD>(size), &size_written, nullptr) && size_written == size;
+}
+
+bool reshade::effect_cache_archive::open(const std::filesystem::path &path)
+{
+	const std::unique_lock<std::shared_mutex> lock(_mutex);
+
+	assert(_file == nullptr);
+
+	_read_only = false;
+
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		// Another process may already have the archive opened for writing, so fall back to read-only access
+		file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			log::message(log::level::error, "Failed to open effect cache archive '%s' with error code %lu!", path.u8string().c_str(), GetLastError());
+			return false;
+		}
+
+		_read_only = true;
+	}
+
+	_path = path;
+	_file = file;
+
+	if (!map_and_build_index())
+	{
+		log::message(log::level::error, "Failed to map effect cache archive '%s' with error code %lu!", path.u8string().c_str(), GetLastError());
+
+		unmap();
+		CloseHandle(_file);
+		_file = nullptr;
+		return false;
+	}
+
+	// Rewrite the archive without superseded entries once those make up more than half of it, to keep it from growing indefinitely
+	if (!_read_only && _unused_size > _file_size / 2 && !compact())
+		log::message(log::level::warning, "Failed to compact effect cache archive '%s'.", path.u8string().c_str());
+
+	return _file != nullptr;
+}
+void reshade::effect_cache_archive::close()
+{
+	const std::unique_lock<std::shared_mutex> lock(_mutex);
+
+	unmap();
+
+	if (_file != nullptr)
+	{
+		CloseHandle(_file);
+		_file = nullptr;
+	}
+}
+
+bool reshade::effect_cache_archive::is_open() const
+{
+	const std::shared_lock<std::shared_mutex> lock(_mutex);
+
+	return _file != nullptr;
+}
+
+bool reshade::effect_cache_archive::read(const std::string &key, std::string &data) const
+{
+	const std::shared_lock<std::shared_mutex> lock(_mutex);
+
+	const auto it = _index.find(key);
+	if (it == _index.end())
+		return false;
+
+	const std::string_view entry_data(it->second.data, it->second.size);
+
+	// Verify checksum here rather than when building the index, so that only entries that are actually used have to be paged in
+	if (compute_checksum(key, entry_data) != it->second.checksum)
+		return false;
+
+	data.assign(entry_data);
+	return true;
+}
+bool reshade::effect_cache_archive::write(const std::string &key, const std::string_view data)
+{
+	const std::unique_lock<std::shared_mutex> lock(_mutex);
+
+	if (_file == nullptr || _read_only)
+		return false;
+
+	const entry_header header = { entry_magic, static_cast<uint32_t>(key.size()), data.size(), compute_checksum(key, data) };
+
+	LARGE_INTEGER position;
+	position.QuadPart = static_cast<LONGLONG>(_file_size);
+
+	if (!SetFilePointerEx(_file, position, nullptr, FILE_BEGIN) ||
+		!write_file(_file, &header, sizeof(header)) ||
+		!write_file(_file, key.data(), key.size()) ||
+		!write_file(_file, data.data(), data.size()))
+		return false; // The partially written entry is overwritten by the next append, since the end position is not advanced
+
+	_file_size += sizeof(header) + key.size() + data.size();
+
+	// The file mapping does not grow with the file, so keep a copy of the appended data in memory for subsequent reads
+	const std::string &stored_data = _appended_data.emplace_front(data);
+	const entry new_entry = { stored_data.data(), stored_data.size(), header.checksum };
+
+	if (const auto it = _index.find(key);
+		it != _index.end())
+	{
+		_unused_size += sizeof(entry_header) + key.size() + it->second.size;
+		it->second = new_entry;
+	}
+	else
+	{
+		_index.emplace(key, new_entry);
+	}
+
+	return true;
+}
+
+void reshade::effect_cache_archive::clear()
+{
+	const std::unique_lock<std::shared_mutex> lock(_mutex);
+
+	if (_file == nullptr || _read_only)
+		return;
+
+	unmap();
+
+	LARGE_INTEGER position = {};
+	if (!SetFilePointerEx(_file, position, nullptr, FILE_BEGIN) || !SetEndOfFile(_file) || !map_and_build_index())
+	{
+		log::message(log::level::error, "Failed to clear effect cache archive '%s' with error code %lu!", _path.u8string().c_str(), GetLastError());
+
+		unmap();
+		CloseHandle(_file);
+		_file = nullptr;
+	}
+}
+
+bool reshade::effect_cache_archive::map_and_build_index()
+{
+	_index.clear();
+	_appended_data.clear();
+	_unused_size = 0;
+
+	LARGE_INTEGER file_size = {};
+	if (!GetFileSizeEx(_file, &file_size))
+		return false;
+	_file_size = static_cast<uint64_t>(file_size.QuadPart);
+
+	if (_file_size < sizeof(archive_header))
+	{
+		if (_read_only)
+			return false;
+
+		// Initialize new archive with a header
+		const archive_header header = { archive_magic, archive_version };
+
+		LARGE_INTEGER position = {};
+		if (!SetFilePointerEx(_file, position, nullptr, FILE_BEGIN) || !write_file(_file, &header, sizeof(header)) || !SetEndOfFile(_file))
+			return false;
+
+		_file_size = sizeof(header);
+	}
+
+	_file_mapping = CreateFileMappingW(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (_file_mapping == nullptr)
+		return false;
+	_file_view = static_cast<const char *>(MapViewOfFile(_file_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (_file_view == nullptr)
+		return false;
+
+	archive_header header;
+	std::memcpy(&header, _file_view, sizeof(header));
+	if (header.magic != archive_magic || header.version != archive_version)
+	{
+		if (_read_only)
+			return false;
+
+		// Discard archives written by a different version and start over
+		unmap();
+
+		LARGE_INTEGER position = {};
+		if (!SetFilePointerEx(_file, position, nullptr, FILE_BEGIN) || !SetEndOfFile(_file))
+			return false;
+
+		return map_and_build_index();
+	}
+
+	uint64_t offset = sizeof(archive_header);
+	while (offset + sizeof(entry_header) <= _file_size)
+	{
+		entry_header entry;
+		std::memcpy(&entry, _file_view + offset, sizeof(entry));
+
+		const uint64_t entry_size = sizeof(entry) + entry.key_size + entry.data_size;
+		// Stop at the first incomplete entry (e.g. if the application crashed while appending)
+		if (entry.magic != entry_magic || entry_size > _file_size - offset)
+			break;
+
+		const char *const key_data = _file_view + offset + sizeof(entry);
+		const effect_cache_archive::entry new_entry = { key_data + entry.key_size, static_cast<size_t>(entry.data_size), entry.checksum };
+
+		if (const auto it = _index.find(std::string(key_data, entry.key_size));
+			it != _index.end())
+		{
+			_unused_size += sizeof(entry) + entry.key_size + it->second.size;
+			it->second = new_entry;
+		}
+		else
+		{
+			_index.emplace(std::string(key_data, entry.key_size), new_entry);
+		}
+
+		offset += entry_size;
+	}
+
+	// New entries are appended right after the last valid one, overwriting anything that follows
+	_file_size = offset;
+
+	return true;
+}
+void reshade::effect_cache_archive::unmap()
+{
+	_index.clear();
+	_appended_data.clear();
+
+	if (_file_view != nullptr)
+	{
+		UnmapViewOfFile(_file_view);
+		_file_view = nullptr;
+	}
+	if (_file_mapping != nullptr)
+	{
+		CloseHandle(_file_mapping);
+		_file_mapping = nullptr;
+	}
+}
+bool reshade::effect_cache_archive::compact()
+{
+	std::filesystem::path temp_path = _path;
+	temp_path += L".tmp";
+
+	HANDLE const temp_file = CreateFileW(temp_path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (temp_file == INVALID_HANDLE_VALUE)
+		return false;
+
+	const archive_header header = { archive_magic, archive_version };
+	bool success = write_file(temp_file, &header, sizeof(header));
+
+	for (const std::pair<const std::string, entry> &entry : _index)
+	{
+		if (!success)
+			break;
+
+		const entry_header header_data = { entry_magic, static_cast<uint32_t>(entry.first.size()), entry.second.size, entry.second.checksum };
+
+		success =
+			write_file(temp_file, &header_data, sizeof(header_data)) &&
+			write_file(temp_file, entry.first.data(), entry.first.size()) &&
+			write_file(temp_file, entry.second.data, entry.second.size);
+	}
+
+	CloseHandle(temp_file);
+
+	if (!success)
+	{
+		DeleteFileW(temp_path.c_str());
+		return false;
+	}
+
+	unmap();
+	CloseHandle(_file);
+	_file = nullptr;
+
+	success = MoveFileExW(temp_path.c_str(), _path.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+	if (!success)
+		DeleteFileW(temp_path.c_str());
+
+	// Reopen the archive (which is the old one if replacing it failed above)
+	HANDLE const file = CreateFileW(_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	_file = file;
+
+	if (!map_and_build_index())
+	{
+		unmap();
+		CloseHandle(_file);
+		_file = nullptr;
+		return false;
+	}
+
+	return success;
+}
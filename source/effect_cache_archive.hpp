@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <string>
+#include <filesystem>
+#include <forward_list>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace reshade
+{
+	/// <summary>
+	/// Append-only archive that packs all cached effect data into a single file, which is memory mapped for reading.
+	/// </summary>
+	class effect_cache_archive
+	{
+	public:
+		effect_cache_archive() = default;
+		~effect_cache_archive() { close(); }
+
+		effect_cache_archive(const effect_cache_archive &) = delete;
+		effect_cache_archive &operator=(const effect_cache_archive &) = delete;
+
+		/// <summary>
+		/// Opens the archive at the specified <paramref name="path"/>, creating it if it does not exist yet, and builds the index of all entries in it.
+		/// </summary>
+		/// <param name="path">Path to the archive file.</param>
+		/// <returns><see langword="true"/> if the archive was opened successfully, <see langword="false"/> otherwise.</returns>
+		bool open(const std::filesystem::path &path);
+		/// <summary>
+		/// Closes the archive, unmapping it from memory.
+		/// </summary>
+		void close();
+
+		/// <summary>
+		/// Checks whether the archive is currently open.
+		/// </summary>
+		bool is_open() const;
+
+		/// <summary>
+		/// Reads the data of the entry with the specified <paramref name="key"/> from the archive.
+		/// </summary>
+		/// <param name="key">Unique key identifying the entry.</param>
+		/// <param name="data">Reference filled with the data of the entry.</param>
+		/// <returns><see langword="true"/> if the entry exists and its checksum matches, <see langword="false"/> otherwise.</returns>
+		bool read(const std::string &key, std::string &data) const;
+		/// <summary>
+		/// Appends an entry with the specified <paramref name="key"/> to the archive, superseding any previous entry with the same key.
+		/// </summary>
+		/// <param name="key">Unique key identifying the entry.</param>
+		/// <param name="data">Data to store in the entry.</param>
+		/// <returns><see langword="true"/> if the entry was written successfully, <see langword="false"/> otherwise.</returns>
+		bool write(const std::string &key, const std::string_view data);
+
+		/// <summary>
+		/// Removes all entries from the archive.
+		/// </summary>
+		void clear();
+
+	private:
+		struct entry
+		{
+			const char *data;
+			size_t size;
+			uint64_t checksum;
+		};
+
+		bool map_and_build_index();
+		void unmap();
+		bool compact();
+
+		mutable std::shared_mutex _mutex;
+		std::filesystem::path _path;
+		void *_file = nullptr;
+		void *_file_mapping = nullptr;
+		const char *_file_view = nullptr;
+		uint64_t _file_size = 0;
+		uint64_t _unused_size = 0;
+		bool _read_only = false;
+		std::unordered_map<std::string, entry> _index;
+		std::forward_list<std::string> _appended_data;
+	};
+}
@@ -29,6 +29,12 @@ namespace reshadefx
 		/// </summary>
 		const effect_module &module() const { return _module; }
 
+		/// <summary>
+		/// Gets the number of instructions emitted so far.
+		/// Text-based back-ends report the number of SSA values instead, since each of those corresponds to an emitted expression or statement.
+		/// </summary>
+		virtual size_t num_instructions() const { return _next_id - 1; }
+
 		/// <summary>
 		/// Finalizes and returns the generated code for the entire module (all entry points).
 		/// </summary>
@@ -8,8 +8,10 @@
 #include <cassert>
 #include <cstring> // std::memcmp
 #include <charconv> // std::from_chars
+#include <iterator> // std::distance
 #include <algorithm> // std::find_if, std::max, std::sort
 #include <unordered_set>
+#include <unordered_map>
 
 // Use the C++ variant of the SPIR-V headers
 #include <spirv.hpp>
@@ -25,6 +27,136 @@ inline uint32_t align_up(uint32_t size, uint32_t alignment)
 	return ((size + alignment) & ~alignment);
 }
 
+template <typename T>
+inline void hash_combine(size_t &seed, const T &v)
+{
+	seed ^= std::hash<T>()(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+inline size_t hash_type(const type &info)
+{
+	// Only hash the fields that are compared by 'operator==' (so ignoring qualifiers)
+	size_t hash = 0;
+	hash_combine(hash, static_cast<uint32_t>(info.base));
+	hash_combine(hash, static_cast<uint32_t>(info.rows | (info.cols << 4)));
+	hash_combine(hash, info.array_length);
+	hash_combine(hash, info.struct_definition);
+	return hash;
+}
+
+/// <summary>
+/// A list of instruction operands, which stores the first few operands inline, so that most instructions do not need a separate heap allocation
+/// </summary>
+class spirv_operand_list
+{
+	static constexpr uint32_t inline_capacity = 5;
+
+public:
+	spirv_operand_list() = default;
+	spirv_operand_list(const spirv_operand_list &other)
+	{
+		append(other.begin(), other.end());
+	}
+	spirv_operand_list(spirv_operand_list &&other) noexcept
+	{
+		*this = std::move(other);
+	}
+	~spirv_operand_list()
+	{
+		if (_data != _inline_data)
+			delete[] _data;
+	}
+
+	spirv_operand_list &operator=(const spirv_operand_list &other)
+	{
+		if (this != &other)
+		{
+			_size = 0;
+			append(other.begin(), other.end());
+		}
+		return *this;
+	}
+	spirv_operand_list &operator=(spirv_operand_list &&other) noexcept
+	{
+		if (this == &other)
+			return *this;
+
+		if (_data != _inline_data)
+			delete[] _data;
+
+		if (other._data != other._inline_data)
+		{
+			// Take ownership of the heap allocation
+			_data = other._data;
+			_capacity = other._capacity;
+			other._data = other._inline_data;
+			other._capacity = inline_capacity;
+		}
+		else
+		{
+			_data = _inline_data;
+			_capacity = inline_capacity;
+			std::memcpy(_inline_data, other._inline_data, other._size * sizeof(spv::Id));
+		}
+
+		_size = other._size;
+		other._size = 0;
+		return *this;
+	}
+
+	bool empty() const { return _size == 0; }
+	size_t size() const { return _size; }
+
+	spv::Id *data() { return _data; }
+	const spv::Id *data() const { return _data; }
+
+	spv::Id *begin() { return _data; }
+	const spv::Id *begin() const { return _data; }
+	spv::Id *end() { return _data + _size; }
+	const spv::Id *end() const { return _data + _size; }
+
+	spv::Id &operator[](size_t index) { assert(index < _size); return _data[index]; }
+	const spv::Id &operator[](size_t index) const { assert(index < _size); return _data[index]; }
+
+	void push_back(spv::Id operand)
+	{
+		if (_size == _capacity)
+			reserve(_capacity * 2);
+
+		_data[_size++] = operand;
+	}
+
+	template <typename It>
+	void append(It begin, It end)
+	{
+		reserve(_size + static_cast<uint32_t>(std::distance(begin, end)));
+
+		for (; begin != end; ++begin)
+			_data[_size++] = *begin;
+	}
+
+	void reserve(uint32_t capacity)
+	{
+		if (capacity <= _capacity)
+			return;
+
+		spv::Id *const data = new spv::Id[capacity];
+		std::memcpy(data, _data, _size * sizeof(spv::Id));
+
+		if (_data != _inline_data)
+			delete[] _data;
+
+		_data = data;
+		_capacity = capacity;
+	}
+
+private:
+	spv::Id *_data = _inline_data;
+	uint32_t _size = 0;
+	uint32_t _capacity = inline_capacity;
+	spv::Id _inline_data[inline_capacity];
+};
+
 /// <summary>
 /// A single instruction in a SPIR-V module
 /// </summary>
@@ -33,7 +165,7 @@ struct spirv_instruction
 	spv::Op op;
 	spv::Id type;
 	spv::Id result;
-	std::vector<spv::Id> operands;
+	spirv_operand_list operands;
 
 	explicit spirv_instruction(spv::Op op = spv::OpNop) : op(op), type(0), result(0) {}
 	spirv_instruction(spv::Op op, spv::Id result) : op(op), type(result), result(0) {}
@@ -54,7 +186,7 @@ struct spirv_instruction
 	template <typename It>
 	spirv_instruction &add(It begin, It end)
 	{
-		operands.insert(operands.end(), begin, end);
+		operands.append(begin, end);
 		return *this;
 	}
 
@@ -73,6 +205,14 @@ struct spirv_instruction
 		return *this;
 	}
 
+	/// <summary>
+	/// Gets the number of words this instruction occupies in a SPIR-V module.
+	/// </summary>
+	uint32_t word_count() const
+	{
+		return 1 + (type != 0) + (result != 0) + static_cast<uint32_t>(operands.size());
+	}
+
 	/// <summary>
 	/// Write this instruction to a SPIR-V module.
 	/// </summary>
@@ -88,25 +228,27 @@ struct spirv_instruction
 		// ...           | ...
 		// WordCount - 1 | Operand N (N is determined by WordCount minus the 1 to 3 words used for the opcode, instruction type <id>, and instruction Result <id>).
 
-		const uint32_t word_count = 1 + (type != 0) + (result != 0) + static_cast<uint32_t>(operands.size());
-		write_word(output, (word_count << spv::WordCountShift) | op);
+		uint32_t header[3];
+		uint32_t header_size = 0;
+		header[header_size++] = (word_count() << spv::WordCountShift) | op;
 
 		// Optional instruction type ID
 		if (type != 0)
-			write_word(output, type);
+			header[header_size++] = type;
 
 		// Optional instruction result ID
 		if (result != 0)
-			write_word(output, result);
+			header[header_size++] = result;
+
+		output.append(reinterpret_cast<const char *>(header), header_size * sizeof(uint32_t));
 
 		// Write out the operands
-		for (const uint32_t operand : operands)
-			write_word(output, operand);
+		output.append(reinterpret_cast<const char *>(operands.data()), operands.size() * sizeof(uint32_t));
 	}
 
 	static void write_word(std::basic_string<char> &output, uint32_t word)
 	{
-		output.insert(output.end(), reinterpret_cast<const char *>(&word), reinterpret_cast<const char *>(&word + 1));
+		output.append(reinterpret_cast<const char *>(&word), sizeof(word));
 	}
 
 	operator uint32_t() const
@@ -131,6 +273,26 @@ struct spirv_basic_block
 	{
 		instructions.insert(instructions.end(), block.instructions.begin(), block.instructions.end());
 	}
+
+	/// <summary>
+	/// Gets the number of words all instructions in this basic block occupy in a SPIR-V module.
+	/// </summary>
+	size_t word_count() const
+	{
+		size_t count = 0;
+		for (const spirv_instruction &inst : instructions)
+			count += inst.word_count();
+		return count;
+	}
+
+	/// <summary>
+	/// Write all instructions in this basic block to a SPIR-V module.
+	/// </summary>
+	void write(std::basic_string<char> &output) const
+	{
+		for (const spirv_instruction &inst : instructions)
+			inst.write(output);
+	}
 };
 
 class codegen_spirv final : public codegen
@@ -161,24 +323,86 @@ private:
 			return lhs.type == rhs.type && lhs.is_ptr == rhs.is_ptr && lhs.array_stride == rhs.array_stride && lhs.storage == rhs.storage;
 		}
 	};
-	struct function_blocks
+	struct type_lookup_hash
+	{
+		size_t operator()(const type_lookup &lookup) const
+		{
+			size_t hash = hash_type(lookup.type);
+			hash_combine(hash, lookup.is_ptr);
+			hash_combine(hash, lookup.array_stride);
+			hash_combine(hash, static_cast<uint32_t>(lookup.storage.first));
+			hash_combine(hash, static_cast<uint32_t>(lookup.storage.second));
+			return hash;
+		}
+	};
+	struct function_type_lookup
 	{
-		spirv_basic_block declaration;
-		spirv_basic_block variables;
-		spirv_basic_block definition;
 		reshadefx::type return_type;
 		std::vector<reshadefx::type> param_types;
 
-		friend bool operator==(const function_blocks &lhs, const function_blocks &rhs)
+		friend bool operator==(const function_type_lookup &lhs, const function_type_lookup &rhs)
+		{
+			return lhs.return_type == rhs.return_type && lhs.param_types == rhs.param_types;
+		}
+	};
+	struct function_type_lookup_hash
+	{
+		size_t operator()(const function_type_lookup &lookup) const
+		{
+			size_t hash = hash_type(lookup.return_type);
+			for (const reshadefx::type &param_type : lookup.param_types)
+				hash_combine(hash, hash_type(param_type));
+			return hash;
+		}
+	};
+	struct constant_lookup
+	{
+		reshadefx::type type;
+		reshadefx::constant data;
+
+		friend bool operator==(const constant_lookup &lhs, const constant_lookup &rhs)
 		{
-			if (lhs.param_types.size() != rhs.param_types.size())
+			if (!(lhs.type == rhs.type && std::memcmp(&lhs.data.as_uint[0], &rhs.data.as_uint[0], sizeof(uint32_t) * 16) == 0 && lhs.data.array_data.size() == rhs.data.array_data.size()))
 				return false;
-			for (size_t i = 0; i < lhs.param_types.size(); ++i)
-				if (!(lhs.param_types[i] == rhs.param_types[i]))
+			for (size_t i = 0; i < lhs.data.array_data.size(); ++i)
+				if (std::memcmp(&lhs.data.array_data[i].as_uint[0], &rhs.data.array_data[i].as_uint[0], sizeof(uint32_t) * 16) != 0)
 					return false;
-			return lhs.return_type == rhs.return_type;
+			return true;
 		}
 	};
+	struct constant_lookup_hash
+	{
+		size_t operator()(const constant_lookup &lookup) const
+		{
+			size_t hash = hash_type(lookup.type);
+			for (const uint32_t value : lookup.data.as_uint)
+				hash_combine(hash, value);
+			for (const reshadefx::constant &element : lookup.data.array_data)
+				for (const uint32_t value : element.as_uint)
+					hash_combine(hash, value);
+			return hash;
+		}
+	};
+	struct encoded_sections
+	{
+		// State of the module when these sections were encoded, to detect when they are outdated
+		size_t num_instructions = 0;
+		spv::Id next_id = 0;
+		size_t num_capabilities = 0;
+		size_t num_global_ubo_types = 0;
+
+		std::basic_string<char> header;
+		std::basic_string<char> debug_info;
+		std::basic_string<char> types_and_constants;
+	};
+	struct function_blocks
+	{
+		spirv_basic_block declaration;
+		spirv_basic_block variables;
+		spirv_basic_block definition;
+		reshadefx::type return_type;
+		std::vector<reshadefx::type> param_types;
+	};
 
 	bool _debug_info = false;
 	bool _vulkan_semantics = false;
@@ -197,6 +421,8 @@ private:
 	std::vector<function_blocks> _functions_blocks;
 	std::unordered_map<id, spirv_basic_block> _block_data;
 	spirv_basic_block *_current_block_data = nullptr;
+	size_t _num_instructions = 0;
+	mutable encoded_sections _shared_sections;
 
 	spv::Id _glsl_ext = 0;
 	spv::Id _global_ubo_type = 0;
@@ -204,14 +430,15 @@ private:
 	std::vector<spv::Id> _global_ubo_types;
 	function_blocks *_current_function_blocks = nullptr;
 
-	std::vector<std::pair<type_lookup, spv::Id>> _type_lookup;
-	std::vector<std::tuple<type, constant, spv::Id>> _constant_lookup;
-	std::vector<std::pair<function_blocks, spv::Id>> _function_type_lookup;
+	std::unordered_map<type_lookup, spv::Id, type_lookup_hash> _type_lookup;
+	std::unordered_map<constant_lookup, spv::Id, constant_lookup_hash> _constant_lookup;
+	std::unordered_map<function_type_lookup, spv::Id, function_type_lookup_hash> _function_type_lookup;
 	std::unordered_map<std::string, spv::Id> _string_lookup;
 	std::unordered_map<spv::Id, std::pair<spv::StorageClass, spv::ImageFormat>> _storage_lookup;
 	std::unordered_map<std::string, uint32_t> _semantic_to_location;
 
-	std::unordered_set<spv::Id> _spec_constants;
+	// Maps each specialization constant to the index of its instruction in '_types_and_constants'
+	std::unordered_map<spv::Id, size_t> _spec_constants;
 	std::unordered_set<spv::Capability> _capabilities;
 
 	void add_location(const location &loc, spirv_basic_block &block)
@@ -261,6 +488,8 @@ private:
 	}
 	spirv_instruction &add_instruction_without_result(spv::Op op, spirv_basic_block &block)
 	{
+		_num_instructions++;
+
 		return block.instructions.emplace_back(op);
 	}
 
@@ -304,18 +533,28 @@ private:
 		if (_debug_info)
 		{
 			// All debug instructions
-			for (const spirv_instruction &inst : _debug_a.instructions)
-				inst.write(spirv);
+			spirv.reserve(spirv.size() + _debug_a.word_count() * sizeof(uint32_t));
+			_debug_a.write(spirv);
 		}
 	}
-	void finalize_type_and_constants_section(std::basic_string<char> &spirv) const
+	void finalize_type_and_constants_section(std::basic_string<char> &spirv, const std::vector<bool> *emitted_ids = nullptr) const
 	{
 		// All type declarations
-		for (const spirv_instruction &inst : _types_and_constants.instructions)
-			inst.write(spirv);
+		if (emitted_ids == nullptr)
+		{
+			spirv.reserve(spirv.size() + (_types_and_constants.word_count() + 3 + _global_ubo_types.size() + 4 + 4) * sizeof(uint32_t));
+			_types_and_constants.write(spirv);
+		}
+		else
+		{
+			// Only add those that are in the list of IDs to emit (and anything without a result, like debug line information)
+			for (const spirv_instruction &inst : _types_and_constants.instructions)
+				if (inst.result == 0 || (*emitted_ids)[inst.result])
+					inst.write(spirv);
+		}
 
 		// Initialize the UBO type now that all member types are known
-		if (_global_ubo_type == 0 || _global_ubo_variable == 0)
+		if (_global_ubo_type == 0 || _global_ubo_variable == 0 || (emitted_ids != nullptr && !(*emitted_ids)[_global_ubo_variable]))
 			return;
 
 		const id global_ubo_type_ptr = _global_ubo_type + 1;
@@ -333,32 +572,77 @@ private:
 			.write(spirv);
 	}
 
+	/// <summary>
+	/// Encodes the sections that are identical for the entire module and all entry points, or returns the previously encoded ones if the module did not change since.
+	/// </summary>
+	const encoded_sections &finalize_shared_sections() const
+	{
+		if (_shared_sections.header.empty() ||
+			_shared_sections.num_instructions != _num_instructions ||
+			_shared_sections.next_id != _next_id ||
+			_shared_sections.num_capabilities != _capabilities.size() ||
+			_shared_sections.num_global_ubo_types != _global_ubo_types.size())
+		{
+			_shared_sections.num_instructions = _num_instructions;
+			_shared_sections.next_id = _next_id;
+			_shared_sections.num_capabilities = _capabilities.size();
+			_shared_sections.num_global_ubo_types = _global_ubo_types.size();
+
+			_shared_sections.header.clear();
+			finalize_header_section(_shared_sections.header);
+			_shared_sections.debug_info.clear();
+			finalize_debug_info_section(_shared_sections.debug_info);
+			_shared_sections.types_and_constants.clear();
+			finalize_type_and_constants_section(_shared_sections.types_and_constants);
+		}
+
+		return _shared_sections;
+	}
+
+	/// <summary>
+	/// Calculates the maximum size of a SPIR-V module containing the shared sections and all other instructions of this module.
+	/// </summary>
+	size_t calculate_module_size(const encoded_sections &shared_sections) const
+	{
+		size_t word_count =
+			_entries.word_count() +
+			_execution_modes.word_count() +
+			_debug_b.word_count() +
+			_annotations.word_count() +
+			_variables.word_count();
+		for (const function_blocks &func : _functions_blocks)
+			word_count += func.declaration.word_count() + func.variables.word_count() + func.definition.word_count();
+
+		return shared_sections.header.size() + shared_sections.debug_info.size() + shared_sections.types_and_constants.size() + word_count * sizeof(uint32_t);
+	}
+
+	size_t num_instructions() const override { return _num_instructions; }
+
 	std::basic_string<char> finalize_code() const override
 	{
+		const encoded_sections &shared_sections = finalize_shared_sections();
+
 		std::basic_string<char> spirv;
-		finalize_header_section(spirv);
+		spirv.reserve(calculate_module_size(shared_sections));
+
+		spirv += shared_sections.header;
 
 		// All entry point declarations
-		for (const spirv_instruction &inst : _entries.instructions)
-			inst.write(spirv);
+		_entries.write(spirv);
 
 		// All execution mode declarations
-		for (const spirv_instruction &inst : _execution_modes.instructions)
-			inst.write(spirv);
+		_execution_modes.write(spirv);
 
-		finalize_debug_info_section(spirv);
+		spirv += shared_sections.debug_info;
 
-		for (const spirv_instruction &inst : _debug_b.instructions)
-			inst.write(spirv);
+		_debug_b.write(spirv);
 
 		// All annotation instructions
-		for (const spirv_instruction &inst : _annotations.instructions)
-			inst.write(spirv);
+		_annotations.write(spirv);
 
-		finalize_type_and_constants_section(spirv);
+		spirv += shared_sections.types_and_constants;
 
-		for (const spirv_instruction &inst : _variables.instructions)
-			inst.write(spirv);
+		_variables.write(spirv);
 
 		// All function definitions
 		for (const function_blocks &func : _functions_blocks)
@@ -387,51 +671,122 @@ private:
 		if (entry_point == nullptr)
 			return {};
 
-		// Build list of IDs to remove
-		std::vector<spv::Id> variables_to_remove;
-		std::vector<spv::Id> functions_to_remove;
+		// Find all IDs that are reachable from the entry point, so that everything else can be removed from the module
+		// Literal operands are treated like IDs too here, which may keep some unused types and constants alive, but never removes a used one
+		std::vector<bool> referenced_ids(_next_id);
+		std::vector<bool> emitted_ids(_next_id);
+		std::vector<spv::Id> interface_variables;
+
+		const auto mark_referenced_ids =
+			[this, &referenced_ids, &emitted_ids](const spirv_instruction &inst) {
+				if (inst.type < _next_id)
+					referenced_ids[inst.type] = true;
+				for (const spv::Id operand : inst.operands)
+					if (operand < _next_id)
+						referenced_ids[operand] = true;
+				if (inst.result != 0)
+					emitted_ids[inst.result] = true;
+			};
 
-		std::basic_string<char> spirv;
-		finalize_header_section(spirv);
+		const auto is_function_referenced =
+			[entry_point](spv::Id definition) {
+				return definition == entry_point->id ||
+					std::find(entry_point->referenced_functions.begin(), entry_point->referenced_functions.end(), definition) != entry_point->referenced_functions.end();
+			};
 
-		// The entry point and execution mode declaration
 		for (const spirv_instruction &inst : _entries.instructions)
 		{
 			assert(inst.op == spv::OpEntryPoint);
 
-			// Only add the matching entry point
 			if (inst.operands[1] == entry_point->id)
 			{
-				inst.write(spirv);
-			}
-			else
-			{
-				functions_to_remove.push_back(inst.operands[1]);
+				mark_referenced_ids(inst);
 
-				// Add interface variables to list of variables to remove
 				for (uint32_t k = 2 + static_cast<uint32_t>((std::strlen(reinterpret_cast<const char *>(&inst.operands[2])) + 4) / 4); k < inst.operands.size(); ++k)
-					variables_to_remove.push_back(inst.operands[k]);
+					interface_variables.push_back(inst.operands[k]);
 			}
 		}
 
+		for (const spirv_instruction &inst : _execution_modes.instructions)
+			if (inst.operands[0] == entry_point->id)
+				mark_referenced_ids(inst);
+
+		for (const function_blocks &function : _functions_blocks)
+		{
+			if (function.definition.instructions.empty() || !is_function_referenced(function_definition(function)))
+				continue;
+
+			for (const spirv_instruction &inst : function.declaration.instructions)
+				mark_referenced_ids(inst);
+			for (const spirv_instruction &inst : function.variables.instructions)
+				mark_referenced_ids(inst);
+			for (const spirv_instruction &inst : function.definition.instructions)
+				mark_referenced_ids(inst);
+		}
+
+		// Global variables only reference constants and types, but never each other
+		for (const spirv_instruction &inst : _variables.instructions)
+		{
+			if (inst.op != spv::OpVariable)
+				continue;
+
+			// Keep input and output variables of other entry points out, even if their ID happens to match a literal operand
+			const spv::StorageClass storage = static_cast<spv::StorageClass>(inst.operands[0]);
+			if (storage == spv::StorageClassInput || storage == spv::StorageClassOutput ?
+					std::find(interface_variables.begin(), interface_variables.end(), inst.result) != interface_variables.end() :
+					referenced_ids[inst.result])
+				mark_referenced_ids(inst);
+		}
+
+		// The global uniform block is only declared when finalizing, so have to handle it separately
+		if (_global_ubo_variable != 0 && referenced_ids[_global_ubo_variable])
+		{
+			const id global_ubo_type_ptr = _global_ubo_type + 1;
+
+			emitted_ids[_global_ubo_type] = referenced_ids[_global_ubo_type] = true;
+			emitted_ids[global_ubo_type_ptr] = referenced_ids[global_ubo_type_ptr] = true;
+			emitted_ids[_global_ubo_variable] = true;
+
+			for (const spv::Id member_type : _global_ubo_types)
+				referenced_ids[member_type] = true;
+		}
+
+		// Types and constants are always declared after everything they reference, so a single pass in reverse order is enough to find all that are used
+		for (auto inst_it = _types_and_constants.instructions.rbegin(); inst_it != _types_and_constants.instructions.rend(); ++inst_it)
+			if (inst_it->result != 0 && referenced_ids[inst_it->result])
+				mark_referenced_ids(*inst_it);
+
+		const encoded_sections &shared_sections = finalize_shared_sections();
+
+		// Reserve enough space for the entire module, even though instructions that are not referenced are skipped below
+		std::basic_string<char> spirv;
+		spirv.reserve(calculate_module_size(shared_sections));
+
+		spirv += shared_sections.header;
+
+		// The entry point and execution mode declaration
+		for (const spirv_instruction &inst : _entries.instructions)
+		{
+			// Only add the matching entry point
+			if (inst.operands[1] == entry_point->id)
+				inst.write(spirv);
+		}
+
 		for (const spirv_instruction &inst : _execution_modes.instructions)
 		{
 			assert(inst.op == spv::OpExecutionMode);
 
 			// Only add execution mode for the matching entry point
 			if (inst.operands[0] == entry_point->id)
-			{
 				inst.write(spirv);
-			}
 		}
 
-		finalize_debug_info_section(spirv);
+		spirv += shared_sections.debug_info;
 
 		for (const spirv_instruction &inst : _debug_b.instructions)
 		{
-			// Remove all names of interface variables and functions for non-matching entry points
-			if (std::find(variables_to_remove.begin(), variables_to_remove.end(), inst.operands[0]) != variables_to_remove.end() ||
-				std::find(functions_to_remove.begin(), functions_to_remove.end(), inst.operands[0]) != functions_to_remove.end())
+			// Remove all names of removed variables, types and functions
+			if (!emitted_ids[inst.operands[0]])
 				continue;
 
 			inst.write(spirv);
@@ -440,12 +795,12 @@ private:
 		// All annotation instructions
 		for (spirv_instruction inst : _annotations.instructions)
 		{
+			// Remove all decorations targeting any of the removed variables, types and functions
+			if (!emitted_ids[inst.operands[0]])
+				continue;
+
 			if (inst.op == spv::OpDecorate)
 			{
-				// Remove all decorations targeting any of the interface variables for non-matching entry points
-				if (std::find(variables_to_remove.begin(), variables_to_remove.end(), inst.operands[0]) != variables_to_remove.end())
-					continue;
-
 				// Replace bindings
 				if (inst.operands[1] == spv::DecorationBinding)
 				{
@@ -462,12 +817,12 @@ private:
 			inst.write(spirv);
 		}
 
-		finalize_type_and_constants_section(spirv);
+		finalize_type_and_constants_section(spirv, &emitted_ids);
 
 		for (const spirv_instruction &inst : _variables.instructions)
 		{
-			// Remove all declarations of the interface variables for non-matching entry points
-			if (inst.op == spv::OpVariable && std::find(variables_to_remove.begin(), variables_to_remove.end(), inst.result) != variables_to_remove.end())
+			// Remove all declarations of variables that are not referenced by this entry point
+			if (inst.op == spv::OpVariable && !emitted_ids[inst.result])
 				continue;
 
 			inst.write(spirv);
@@ -476,13 +831,7 @@ private:
 		// All referenced function definitions
 		for (const function_blocks &function : _functions_blocks)
 		{
-			if (function.definition.instructions.empty())
-				continue;
-
-			assert(function.declaration.instructions[function.declaration.instructions[0].op != spv::OpFunction ? 1 : 0].op == spv::OpFunction);
-			const spv::Id definition = function.declaration.instructions[function.declaration.instructions[0].op != spv::OpFunction ? 1 : 0].result;
-
-			if (std::find(functions_to_remove.begin(), functions_to_remove.end(), definition) != functions_to_remove.end())
+			if (function.definition.instructions.empty() || !is_function_referenced(function_definition(function)))
 				continue;
 
 			for (const spirv_instruction &inst : function.declaration.instructions)
@@ -501,6 +850,13 @@ private:
 		return spirv;
 	}
 
+	static spv::Id function_definition(const function_blocks &function)
+	{
+		const spirv_instruction &inst = function.declaration.instructions[function.declaration.instructions[0].op != spv::OpFunction ? 1 : 0];
+		assert(inst.op == spv::OpFunction);
+		return inst.result;
+	}
+
 	spv::Id convert_type(type info, bool is_ptr = false, spv::StorageClass storage = spv::StorageClassFunction, spv::ImageFormat format = spv::ImageFormatUnknown, uint32_t array_stride = 0)
 	{
 		assert(array_stride == 0 || info.is_array());
@@ -523,8 +879,7 @@ private:
 
 		const type_lookup lookup { info, is_ptr, array_stride, { storage, format } };
 
-		if (const auto lookup_it = std::find_if(_type_lookup.begin(), _type_lookup.end(),
-				[&lookup](const std::pair<type_lookup, spv::Id> &lookup_entry) { return lookup_entry.first == lookup; });
+		if (const auto lookup_it = _type_lookup.find(lookup);
 			lookup_it != _type_lookup.end())
 			return lookup_it->second;
 
@@ -689,14 +1044,15 @@ private:
 			}
 		}
 
-		_type_lookup.push_back({ lookup, type_id });
+		_type_lookup.emplace(lookup, type_id);
 
 		return type_id;
 	}
 	spv::Id convert_type(const function_blocks &info)
 	{
-		if (const auto lookup_it = std::find_if(_function_type_lookup.begin(), _function_type_lookup.end(),
-				[&lookup = info](const std::pair<function_blocks, spv::Id> &lookup_entry) { return lookup_entry.first == lookup; });
+		function_type_lookup lookup { info.return_type, info.param_types };
+
+		if (const auto lookup_it = _function_type_lookup.find(lookup);
 			lookup_it != _function_type_lookup.end())
 			return lookup_it->second;
 
@@ -712,7 +1068,7 @@ private:
 			.add(return_type_id)
 			.add(param_type_ids.begin(), param_type_ids.end());
 
-		_function_type_lookup.push_back({ info, inst });
+		_function_type_lookup.emplace(std::move(lookup), inst);
 
 		return inst;
 	}
@@ -740,8 +1096,7 @@ private:
 			lookup.type.struct_definition = static_cast<uint32_t>(elem_info.base);
 		}
 
-		if (const auto lookup_it = std::find_if(_type_lookup.begin(), _type_lookup.end(),
-				[&lookup](const std::pair<type_lookup, spv::Id> &lookup_entry) { return lookup_entry.first == lookup; });
+		if (const auto lookup_it = _type_lookup.find(lookup);
 			lookup_it != _type_lookup.end())
 			return lookup_it->second;
 
@@ -756,7 +1111,7 @@ private:
 				.add(info.is_storage() ? 2 : 1) // Used with a sampler or as storage
 				.add(format);
 
-		_type_lookup.push_back({ lookup, type_id });
+		_type_lookup.emplace(lookup, type_id);
 
 		return type_id;
 	}
@@ -1047,8 +1402,7 @@ private:
 
 					if (info.type.is_array())
 					{
-						elem_inst = *std::find_if(_types_and_constants.instructions.rbegin(), _types_and_constants.instructions.rend(),
-							[operand_id = base_inst.operands[i]](const spirv_instruction &inst) { return inst == operand_id; });
+						elem_inst = _types_and_constants.instructions[_spec_constants.at(base_inst.operands[i])];
 
 						assert(initializer_value.array_data.size() == base_inst.operands.size());
 						initializer_value = initializer_value.array_data[i];
@@ -1056,8 +1410,7 @@ private:
 
 					for (size_t row = 0; row < elem_inst.operands.size(); ++row)
 					{
-						const spirv_instruction &row_inst = *std::find_if(_types_and_constants.instructions.rbegin(), _types_and_constants.instructions.rend(),
-							[operand_id = elem_inst.operands[row]](const spirv_instruction &inst) { return inst == operand_id; });
+						const spirv_instruction &row_inst = _types_and_constants.instructions[_spec_constants.at(elem_inst.operands[row])];
 
 						if (row_inst.op != spv::OpSpecConstantComposite)
 						{
@@ -1067,8 +1420,7 @@ private:
 
 						for (size_t col = 0; col < row_inst.operands.size(); ++col)
 						{
-							const spirv_instruction &col_inst = *std::find_if(_types_and_constants.instructions.rbegin(), _types_and_constants.instructions.rend(),
-								[operand_id = row_inst.operands[col]](const spirv_instruction &inst) { return inst == operand_id; });
+							const spirv_instruction &col_inst = _types_and_constants.instructions[_spec_constants.at(row_inst.operands[col])];
 
 							add_spec_constant(col_inst, info, initializer_value, row * info.type.cols + col);
 						}
@@ -1978,17 +2330,9 @@ private:
 	{
 		if (!spec_constant) // Specialization constants cannot reuse other constants
 		{
-			if (const auto it = std::find_if(_constant_lookup.begin(), _constant_lookup.end(),
-					[&data_type, &data](std::tuple<type, constant, spv::Id> &x) {
-						if (!(std::get<0>(x) == data_type && std::memcmp(&std::get<1>(x).as_uint[0], &data.as_uint[0], sizeof(uint32_t) * 16) == 0 && std::get<1>(x).array_data.size() == data.array_data.size()))
-							return false;
-						for (size_t i = 0; i < data.array_data.size(); ++i)
-							if (std::memcmp(&std::get<1>(x).array_data[i].as_uint[0], &data.array_data[i].as_uint[0], sizeof(uint32_t) * 16) != 0)
-								return false;
-						return true;
-					});
+			if (const auto it = _constant_lookup.find({ data_type, data });
 				it != _constant_lookup.end())
-				return std::get<2>(*it); // Reuse existing constant instead of duplicating the definition
+				return it->second; // Reuse existing constant instead of duplicating the definition
 		}
 
 		spv::Id result;
@@ -2066,9 +2410,9 @@ private:
 		}
 
 		if (spec_constant) // Keep track of all specialization constants
-			_spec_constants.insert(result);
+			_spec_constants.emplace(result, _types_and_constants.instructions.size() - 1);
 		else
-			_constant_lookup.push_back({ data_type, data, result });
+			_constant_lookup.emplace(constant_lookup { data_type, data }, result);
 
 		return result;
 	}
@@ -4,10 +4,11 @@
  */
 
 #include "effect_expression.hpp"
-#include <cmath> // std::fmod
+#include <cmath> // std::fmod, std::pow, std::sqrt, ...
 #include <cassert>
 #include <cstring> // std::memcpy, std::memset
 #include <algorithm> // std::max, std::min
+#include <type_traits> // std::is_invocable_v
 
 reshadefx::type reshadefx::type::merge(const type &lhs, const type &rhs)
 {
@@ -624,3 +625,353 @@ bool reshadefx::expression::evaluate_constant_expression(reshadefx::tokenid op,
 
 	return true;
 }
+
+static float calculate_determinant(const float *matrix, unsigned int size)
+{
+	if (size == 1)
+		return matrix[0];
+	if (size == 2)
+		return matrix[0] * matrix[3] - matrix[1] * matrix[2];
+
+	// Laplace expansion along the first row
+	float result = 0.0f;
+	for (unsigned int col = 0; col < size; ++col)
+	{
+		float minor[9];
+		for (unsigned int r = 1, k = 0; r < size; ++r)
+			for (unsigned int c = 0; c < size; ++c)
+				if (c != col)
+					minor[k++] = matrix[r * size + c];
+
+		const float cofactor = calculate_determinant(minor, size - 1);
+		result += (col % 2 == 0) ? matrix[col] * cofactor : -matrix[col] * cofactor;
+	}
+
+	return result;
+}
+
+template <typename T>
+static void multiply(const T *lhs, const reshadefx::type &lhs_type, const T *rhs, const reshadefx::type &rhs_type, T *result)
+{
+	if (lhs_type.is_scalar())
+	{
+		for (unsigned int i = 0; i < rhs_type.components(); ++i)
+			result[i] = lhs[0] * rhs[i];
+	}
+	else if (rhs_type.is_scalar())
+	{
+		for (unsigned int i = 0; i < lhs_type.components(); ++i)
+			result[i] = lhs[i] * rhs[0];
+	}
+	else if (lhs_type.is_vector()) // Row vector times matrix
+	{
+		for (unsigned int col = 0; col < rhs_type.cols; ++col)
+		{
+			T sum = 0;
+			for (unsigned int k = 0; k < rhs_type.rows; ++k)
+				sum += lhs[k] * rhs[k * rhs_type.cols + col];
+			result[col] = sum;
+		}
+	}
+	else if (rhs_type.is_vector()) // Matrix times column vector
+	{
+		for (unsigned int row = 0; row < lhs_type.rows; ++row)
+		{
+			T sum = 0;
+			for (unsigned int k = 0; k < lhs_type.cols; ++k)
+				sum += lhs[row * lhs_type.cols + k] * rhs[k];
+			result[row] = sum;
+		}
+	}
+	else
+	{
+		for (unsigned int row = 0; row < lhs_type.rows; ++row)
+		{
+			for (unsigned int col = 0; col < rhs_type.cols; ++col)
+			{
+				T sum = 0;
+				for (unsigned int k = 0; k < lhs_type.cols; ++k)
+					sum += lhs[row * lhs_type.cols + k] * rhs[k * rhs_type.cols + col];
+				result[row * rhs_type.cols + col] = sum;
+			}
+		}
+	}
+}
+
+bool reshadefx::expression::evaluate_constant_intrinsic(const reshadefx::location &loc, const std::string &name, const std::vector<expression> &args, const reshadefx::type &res_type)
+{
+	for (const expression &arg : args)
+		if (!arg.is_constant || arg.type.is_array() || !arg.type.is_numeric())
+			return false;
+
+	reshadefx::constant result = {};
+	const unsigned int num_components = res_type.components();
+
+	const auto apply_float =
+		[&result, &args, num_components](auto func) {
+			for (unsigned int i = 0; i < num_components; ++i)
+			{
+				if constexpr (std::is_invocable_v<decltype(func), float>)
+					result.as_float[i] = func(args[0].constant.as_float[i]);
+				else if constexpr (std::is_invocable_v<decltype(func), float, float>)
+					result.as_float[i] = func(args[0].constant.as_float[i], args[1].constant.as_float[i]);
+				else
+					result.as_float[i] = func(args[0].constant.as_float[i], args[1].constant.as_float[i], args[2].constant.as_float[i]);
+			}
+		};
+	const auto calculate_dot =
+		[](const reshadefx::constant &lhs, const reshadefx::constant &rhs, unsigned int components) {
+			float sum = 0.0f;
+			for (unsigned int i = 0; i < components; ++i)
+				sum += lhs.as_float[i] * rhs.as_float[i];
+			return sum;
+		};
+
+	if (name == "abs")
+	{
+		if (args[0].type.is_floating_point())
+			apply_float([](float x) { return std::abs(x); });
+		else
+			for (unsigned int i = 0; i < num_components; ++i)
+				result.as_uint[i] = args[0].constant.as_int[i] < 0 ? 0u - args[0].constant.as_uint[i] : args[0].constant.as_uint[i];
+	}
+	else if (name == "sign")
+	{
+		if (args[0].type.is_floating_point())
+			apply_float([](float x) { return static_cast<float>((x > 0.0f) - (x < 0.0f)); });
+		else
+			for (unsigned int i = 0; i < num_components; ++i)
+				result.as_int[i] = (args[0].constant.as_int[i] > 0) - (args[0].constant.as_int[i] < 0);
+	}
+	else if (name == "min" || name == "max" || name == "clamp")
+	{
+		for (unsigned int i = 0; i < num_components; ++i)
+		{
+			if (args[0].type.is_floating_point())
+			{
+				float value = args[0].constant.as_float[i];
+				if (name != "min")
+					value = std::fmax(value, args[1].constant.as_float[i]);
+				if (name != "max")
+					value = std::fmin(value, args[name == "clamp" ? 2 : 1].constant.as_float[i]);
+				result.as_float[i] = value;
+			}
+			else if (args[0].type.is_signed())
+			{
+				int32_t value = args[0].constant.as_int[i];
+				if (name != "min")
+					value = std::max(value, args[1].constant.as_int[i]);
+				if (name != "max")
+					value = std::min(value, args[name == "clamp" ? 2 : 1].constant.as_int[i]);
+				result.as_int[i] = value;
+			}
+			else
+			{
+				uint32_t value = args[0].constant.as_uint[i];
+				if (name != "min")
+					value = std::max(value, args[1].constant.as_uint[i]);
+				if (name != "max")
+					value = std::min(value, args[name == "clamp" ? 2 : 1].constant.as_uint[i]);
+				result.as_uint[i] = value;
+			}
+		}
+	}
+	else if (name == "sin")
+		apply_float([](float x) { return std::sin(x); });
+	else if (name == "cos")
+		apply_float([](float x) { return std::cos(x); });
+	else if (name == "tan")
+		apply_float([](float x) { return std::tan(x); });
+	else if (name == "asin")
+		apply_float([](float x) { return std::asin(x); });
+	else if (name == "acos")
+		apply_float([](float x) { return std::acos(x); });
+	else if (name == "atan")
+		apply_float([](float x) { return std::atan(x); });
+	else if (name == "atan2")
+		apply_float([](float y, float x) { return std::atan2(y, x); });
+	else if (name == "sinh")
+		apply_float([](float x) { return std::sinh(x); });
+	else if (name == "cosh")
+		apply_float([](float x) { return std::cosh(x); });
+	else if (name == "tanh")
+		apply_float([](float x) { return std::tanh(x); });
+	else if (name == "exp")
+		apply_float([](float x) { return std::exp(x); });
+	else if (name == "exp2")
+		apply_float([](float x) { return std::exp2(x); });
+	else if (name == "log")
+		apply_float([](float x) { return std::log(x); });
+	else if (name == "log2")
+		apply_float([](float x) { return std::log2(x); });
+	else if (name == "log10")
+		apply_float([](float x) { return std::log10(x); });
+	else if (name == "pow")
+	{
+		// The result of a negative base is undefined on the GPU, so leave those to the driver
+		for (unsigned int i = 0; i < num_components; ++i)
+			if (args[0].constant.as_float[i] < 0.0f)
+				return false;
+
+		apply_float([](float x, float y) { return std::pow(x, y); });
+	}
+	else if (name == "sqrt")
+		apply_float([](float x) { return std::sqrt(x); });
+	else if (name == "rsqrt")
+		apply_float([](float x) { return 1.0f / std::sqrt(x); });
+	else if (name == "rcp")
+		apply_float([](float x) { return 1.0f / x; });
+	else if (name == "floor")
+		apply_float([](float x) { return std::floor(x); });
+	else if (name == "ceil")
+		apply_float([](float x) { return std::ceil(x); });
+	else if (name == "trunc")
+		apply_float([](float x) { return std::trunc(x); });
+	else if (name == "round")
+		apply_float([](float x) { return std::nearbyint(x); }); // Round half to even, like HLSL does
+	else if (name == "frac")
+		apply_float([](float x) { return x - std::floor(x); });
+	else if (name == "saturate")
+		apply_float([](float x) { return std::fmin(std::fmax(x, 0.0f), 1.0f); });
+	else if (name == "degrees")
+		apply_float([](float x) { return x * 57.29577951f; });
+	else if (name == "radians")
+		apply_float([](float x) { return x * 0.0174532925f; });
+	else if (name == "step")
+		apply_float([](float y, float x) { return x >= y ? 1.0f : 0.0f; });
+	else if (name == "smoothstep")
+		apply_float([](float min, float max, float x) { const float t = std::fmin(std::fmax((x - min) / (max - min), 0.0f), 1.0f); return t * t * (3.0f - 2.0f * t); });
+	else if (name == "lerp")
+		apply_float([](float x, float y, float s) { return x + s * (y - x); });
+	else if (name == "mad")
+		apply_float([](float m, float a, float b) { return m * a + b; });
+	else if (name == "ldexp")
+	{
+		for (unsigned int i = 0; i < num_components; ++i)
+			result.as_float[i] = std::ldexp(args[0].constant.as_float[i], args[1].constant.as_int[i]);
+	}
+	else if (name == "isnan" || name == "isinf")
+	{
+		for (unsigned int i = 0; i < num_components; ++i)
+			result.as_uint[i] = name == "isnan" ? std::isnan(args[0].constant.as_float[i]) : std::isinf(args[0].constant.as_float[i]);
+	}
+	else if (name == "all" || name == "any")
+	{
+		bool value = name == "all";
+		for (unsigned int i = 0; i < args[0].type.components(); ++i)
+			value = name == "all" ? (value && args[0].constant.as_uint[i] != 0) : (value || args[0].constant.as_uint[i] != 0);
+		result.as_uint[0] = value;
+	}
+	else if (name == "asint" || name == "asuint" || name == "asfloat")
+	{
+		// Only the type changes, the bits stay the same
+		for (unsigned int i = 0; i < num_components; ++i)
+			result.as_uint[i] = args[0].constant.as_uint[i];
+	}
+	else if (name == "countbits")
+	{
+		for (unsigned int i = 0; i < num_components; ++i)
+			for (uint32_t value = args[0].constant.as_uint[i]; value != 0; value &= value - 1)
+				result.as_uint[i]++;
+	}
+	else if (name == "reversebits")
+	{
+		for (unsigned int i = 0; i < num_components; ++i)
+			for (unsigned int bit = 0; bit < 32; ++bit)
+				result.as_uint[i] |= ((args[0].constant.as_uint[i] >> bit) & 1) << (31 - bit);
+	}
+	else if (name == "firstbitlow" || name == "firstbithigh")
+	{
+		for (unsigned int i = 0; i < num_components; ++i)
+		{
+			uint32_t value = args[0].constant.as_uint[i];
+			// For negative signed values the search is for the first bit that differs from the sign bit instead
+			if (name == "firstbithigh" && args[0].type.is_signed() && args[0].constant.as_int[i] < 0)
+				value = ~value;
+
+			result.as_uint[i] = 0xFFFFFFFF;
+			for (unsigned int bit = 0; bit < 32; ++bit)
+			{
+				const unsigned int index = name == "firstbitlow" ? bit : 31 - bit;
+				if ((value >> index) & 1)
+				{
+					result.as_uint[i] = index;
+					break;
+				}
+			}
+		}
+	}
+	else if (name == "dot")
+	{
+		result.as_float[0] = calculate_dot(args[0].constant, args[1].constant, args[0].type.components());
+	}
+	else if (name == "length" || name == "distance" || name == "normalize")
+	{
+		reshadefx::constant vector = args[0].constant;
+		if (name == "distance")
+			for (unsigned int i = 0; i < args[0].type.components(); ++i)
+				vector.as_float[i] -= args[1].constant.as_float[i];
+
+		const float length = std::sqrt(calculate_dot(vector, vector, args[0].type.components()));
+
+		if (name == "normalize")
+			for (unsigned int i = 0; i < num_components; ++i)
+				result.as_float[i] = vector.as_float[i] / length;
+		else
+			result.as_float[0] = length;
+	}
+	else if (name == "cross")
+	{
+		const float *const a = args[0].constant.as_float;
+		const float *const b = args[1].constant.as_float;
+		result.as_float[0] = a[1] * b[2] - a[2] * b[1];
+		result.as_float[1] = a[2] * b[0] - a[0] * b[2];
+		result.as_float[2] = a[0] * b[1] - a[1] * b[0];
+	}
+	else if (name == "reflect")
+	{
+		const float d = calculate_dot(args[1].constant, args[0].constant, num_components);
+		for (unsigned int i = 0; i < num_components; ++i)
+			result.as_float[i] = args[0].constant.as_float[i] - 2.0f * d * args[1].constant.as_float[i];
+	}
+	else if (name == "refract")
+	{
+		const float d = calculate_dot(args[1].constant, args[0].constant, num_components);
+		const float eta = args[2].constant.as_float[0];
+		const float k = 1.0f - eta * eta * (1.0f - d * d);
+		if (k >= 0.0f)
+			for (unsigned int i = 0; i < num_components; ++i)
+				result.as_float[i] = eta * args[0].constant.as_float[i] - (eta * d + std::sqrt(k)) * args[1].constant.as_float[i];
+	}
+	else if (name == "faceforward")
+	{
+		const float d = calculate_dot(args[2].constant, args[1].constant, num_components);
+		for (unsigned int i = 0; i < num_components; ++i)
+			result.as_float[i] = d < 0.0f ? args[0].constant.as_float[i] : -args[0].constant.as_float[i];
+	}
+	else if (name == "mul")
+	{
+		if (res_type.is_floating_point())
+			multiply(args[0].constant.as_float, args[0].type, args[1].constant.as_float, args[1].type, result.as_float);
+		else
+			multiply(args[0].constant.as_uint, args[0].type, args[1].constant.as_uint, args[1].type, result.as_uint);
+	}
+	else if (name == "transpose")
+	{
+		for (unsigned int row = 0; row < args[0].type.rows; ++row)
+			for (unsigned int col = 0; col < args[0].type.cols; ++col)
+				result.as_float[col * args[0].type.rows + row] = args[0].constant.as_float[row * args[0].type.cols + col];
+	}
+	else if (name == "determinant")
+	{
+		result.as_float[0] = calculate_determinant(args[0].constant.as_float, args[0].type.rows);
+	}
+	else
+	{
+		// All other intrinsics (texture access, derivatives, atomics, ...) cannot be evaluated at compile time
+		return false;
+	}
+
+	reset_to_rvalue_constant(loc, std::move(result), res_type);
+	return true;
+}
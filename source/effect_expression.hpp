@@ -247,5 +247,14 @@ namespace reshadefx
 		/// <param name="op">Binary operator to apply.</param>
 		/// <param name="rhs">Constant value to use as right-hand side of the binary operation.</param>
 		bool evaluate_constant_expression(reshadefx::tokenid op, const reshadefx::constant &rhs);
+		/// <summary>
+		/// Evaluates an intrinsic function call with constant arguments and initializes this expression to the resulting constant value.
+		/// </summary>
+		/// <param name="loc">Code location of the function call.</param>
+		/// <param name="name">Name of the intrinsic function to evaluate.</param>
+		/// <param name="args">Constant arguments to the intrinsic function, already converted to the parameter types.</param>
+		/// <param name="res_type">Return type of the intrinsic function.</param>
+		/// <returns><see langword="true"/> if the intrinsic function could be evaluated at compile time, <see langword="false"/> otherwise.</returns>
+		bool evaluate_constant_intrinsic(const reshadefx::location &loc, const std::string &name, const std::vector<expression> &args, const reshadefx::type &res_type);
 	};
 }
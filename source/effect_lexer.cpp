@@ -832,8 +832,8 @@ void reshadefx::lexer::skip_to_next_line()
 
 void reshadefx::lexer::reset_to_offset(size_t offset)
 {
-	assert(offset < _input.size());
-	_cur = _input.data() + offset;
+	assert(offset < _input->size());
+	_cur = _input->data() + offset;
 }
 
 void reshadefx::lexer::parse_identifier(token &tok) const
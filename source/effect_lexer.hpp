@@ -6,6 +6,9 @@
 #pragma once
 
 #include "effect_token.hpp"
+#include <memory> // std::make_shared, std::shared_ptr
+#include <cassert>
+#include <string_view>
 
 namespace reshadefx
 {
@@ -24,6 +27,26 @@ namespace reshadefx
 			bool ignore_keywords = false,
 			bool escape_string_literals = true,
 			const location &start_location = location()) :
+			lexer(
+				std::make_shared<const std::string>(std::move(input)),
+				ignore_comments,
+				ignore_whitespace,
+				ignore_pp_directives,
+				ignore_line_directives,
+				ignore_keywords,
+				escape_string_literals,
+				start_location)
+		{
+		}
+		explicit lexer(
+			std::shared_ptr<const std::string> input,
+			bool ignore_comments = true,
+			bool ignore_whitespace = true,
+			bool ignore_pp_directives = true,
+			bool ignore_line_directives = false,
+			bool ignore_keywords = false,
+			bool escape_string_literals = true,
+			const location &start_location = location()) :
 			_input(std::move(input)),
 			_cur_location(start_location),
 			_ignore_comments(ignore_comments),
@@ -33,37 +56,33 @@ namespace reshadefx
 			_ignore_keywords(ignore_keywords),
 			_escape_string_literals(escape_string_literals)
 		{
-			_cur = _input.data();
-			_end = _cur + _input.size();
+			assert(_input != nullptr);
+			_cur = _input->data();
+			_end = _cur + _input->size();
 		}
 
-		lexer(const lexer &lexer) { operator=(lexer); }
-		lexer &operator=(const lexer &lexer)
-		{
-			_input = lexer._input;
-			_cur_location = lexer._cur_location;
-			reset_to_offset(lexer._cur - lexer._input.data());
-			_end = _input.data() + _input.size();
-			_ignore_comments = lexer._ignore_comments;
-			_ignore_whitespace = lexer._ignore_whitespace;
-			_ignore_pp_directives = lexer._ignore_pp_directives;
-			_ignore_keywords = lexer._ignore_keywords;
-			_escape_string_literals = lexer._escape_string_literals;
-			_ignore_line_directives = lexer._ignore_line_directives;
-
-			return *this;
-		}
+		// The input string is immutable, so copies of a lexer can share it
+		lexer(const lexer &lexer) = default;
+		lexer &operator=(const lexer &lexer) = default;
 
 		/// <summary>
 		/// Gets the current position in the input string.
 		/// </summary>
-		size_t input_offset() const { return _cur - _input.data(); }
+		size_t input_offset() const { return _cur - _input->data(); }
 
 		/// <summary>
 		/// Gets the input string this lexical analyzer works on.
 		/// </summary>
 		/// <returns>Constant reference to the input string.</returns>
-		const std::string &input_string() const { return _input; }
+		const std::string &input_string() const { return *_input; }
+		/// <summary>
+		/// Gets the reference-counted buffer holding the input string, which can be used to keep slices of it alive after this lexical analyzer is destroyed.
+		/// </summary>
+		const std::shared_ptr<const std::string> &input_buffer() const { return _input; }
+		/// <summary>
+		/// Gets the characters of the input string the specified <paramref name="tok"/> was created from, without copying them.
+		/// </summary>
+		std::string_view token_data(const token &tok) const { return std::string_view(*_input).substr(tok.offset, tok.length); }
 
 		/// <summary>
 		/// Performs lexical analysis on the input string and return the next token in sequence.
@@ -98,7 +117,7 @@ namespace reshadefx
 		void parse_string_literal(token &tok, bool escape);
 		void parse_numeric_literal(token &tok) const;
 
-		std::string _input;
+		std::shared_ptr<const std::string> _input;
 		location _cur_location;
 		const std::string::value_type *_cur, *_end;
 
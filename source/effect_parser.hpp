@@ -6,6 +6,7 @@
 #pragma once
 
 #include "effect_symbol_table.hpp"
+#include <chrono>
 #include <memory> // std::unique_ptr
 
 namespace reshadefx
@@ -16,6 +17,12 @@ namespace reshadefx
 	class parser : symbol_table
 	{
 	public:
+		struct statistics
+		{
+			std::chrono::high_resolution_clock::duration duration = {};
+			size_t num_tokens = 0;
+		};
+
 		// Define constructor explicitly because lexer class is not included here
 		parser();
 		~parser();
@@ -33,6 +40,11 @@ namespace reshadefx
 		/// </summary>
 		const std::string &errors() const { return _errors; }
 
+		/// <summary>
+		/// Gets the time spent and tokens processed by the last call to <see cref="parse"/>.
+		/// </summary>
+		const statistics &stats() const { return _stats; }
+
 	private:
 		void error(const location &location, unsigned int code, const std::string &message);
 		void warning(const location &location, unsigned int code, const std::string &message);
@@ -70,11 +82,14 @@ namespace reshadefx
 		bool parse_expression_unary(expression &expression);
 		bool parse_expression_multary(expression &expression, unsigned int precedence = 0);
 		bool parse_expression_assignment(expression &expression);
+		bool parse_expression_discarded(bool (parser::*parse)(reshadefx::expression &), expression &expression);
 		bool parse_annotations(std::vector<annotation> &annotations);
 		bool parse_statement(bool scoped);
 		bool parse_statement_block(bool scoped);
+		bool parse_statement_discarded(bool scoped);
 
 		std::string _errors;
+		statistics _stats;
 
 		std::unique_ptr<class lexer> _lexer;
 		class codegen *_codegen = nullptr;
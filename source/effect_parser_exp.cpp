@@ -56,6 +56,8 @@ void reshadefx::parser::consume()
 {
 	_token = std::move(_token_next);
 	_token_next = _lexer->lex();
+
+	_stats.num_tokens++;
 }
 void reshadefx::parser::consume_until(tokenid tokid)
 {
@@ -1003,136 +1005,164 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 
 			assert(symbol.function != nullptr);
 
-			std::vector<expression> parameters(symbol.function->parameter_list.size());
-
-			// We need to allocate some temporary variables to pass in and load results from pointer parameters
-			for (size_t i = 0; i < arguments.size(); ++i)
+			// Evaluate intrinsic calls with only constant arguments at compile time, so that no code has to be generated for them
+			bool is_constant_call = symbol.op == symbol_type::intrinsic;
+			for (size_t i = 0; i < arguments.size() && is_constant_call; ++i)
 			{
 				const auto &param_type = symbol.function->parameter_list[i].type;
 
-				if (param_type.has(type::q_out) && (!arguments[i].is_lvalue || (arguments[i].type.has(type::q_const) && !arguments[i].type.is_object())))
-				{
-					error(arguments[i].location, 3025, "l-value specifies const object for an 'out' parameter");
-					return false;
-				}
+				// Casting floating-point constants to boolean truncates them, so leave those to the code generation
+				is_constant_call = arguments[i].is_constant && !param_type.has(type::q_out) && !param_type.is_object() && !(param_type.is_boolean() && arguments[i].type.is_floating_point());
+			}
 
-				if (arguments[i].type.components() > param_type.components())
-					warning(arguments[i].location, 3206, "implicit truncation of vector type");
+			if (is_constant_call)
+			{
+				std::vector<expression> constant_arguments = arguments;
+				for (size_t i = 0; i < arguments.size(); ++i)
+					constant_arguments[i].add_cast_operation(symbol.function->parameter_list[i].type);
+
+				is_constant_call = exp.evaluate_constant_intrinsic(location, identifier, constant_arguments, symbol.type);
+			}
 
-				if (symbol.op == symbol_type::function || param_type.has(type::q_out))
+			if (is_constant_call)
+			{
+				for (size_t i = 0; i < arguments.size(); ++i)
+					if (arguments[i].type.components() > symbol.function->parameter_list[i].type.components())
+						warning(arguments[i].location, 3206, "implicit truncation of vector type");
+			}
+			else
+			{
+				std::vector<expression> parameters(symbol.function->parameter_list.size());
+
+				// We need to allocate some temporary variables to pass in and load results from pointer parameters
+				for (size_t i = 0; i < arguments.size(); ++i)
 				{
-					if (param_type.is_object() || param_type.has(type::q_groupshared) /* Special case for atomic intrinsics */)
-					{
-						if (arguments[i].type != param_type)
-						{
-							error(location, 3004, "no matching intrinsic overload for '" + identifier + '\'');
-							return false;
-						}
+					const auto &param_type = symbol.function->parameter_list[i].type;
 
-						assert(arguments[i].is_lvalue);
+					if (param_type.has(type::q_out) && (!arguments[i].is_lvalue || (arguments[i].type.has(type::q_const) && !arguments[i].type.is_object())))
+					{
+						error(arguments[i].location, 3025, "l-value specifies const object for an 'out' parameter");
+						return false;
+					}
 
-						// Do not shadow object or pointer parameters to function calls
-						size_t chain_index = 0;
-						const codegen::id access_chain = _codegen->emit_access_chain(arguments[i], chain_index);
-						parameters[i].reset_to_lvalue(arguments[i].location, access_chain, param_type);
-						assert(chain_index == arguments[i].chain.size());
+					if (arguments[i].type.components() > param_type.components())
+						warning(arguments[i].location, 3206, "implicit truncation of vector type");
 
-						// This is referencing a l-value, but want to avoid copying below
-						parameters[i].is_lvalue = false;
+					if (symbol.op == symbol_type::function || param_type.has(type::q_out))
+					{
+						if (param_type.is_object() || param_type.has(type::q_groupshared) /* Special case for atomic intrinsics */)
+						{
+							if (arguments[i].type != param_type)
+							{
+								error(location, 3004, "no matching intrinsic overload for '" + identifier + '\'');
+								return false;
+							}
+
+							assert(arguments[i].is_lvalue);
+
+							// Do not shadow object or pointer parameters to function calls
+							size_t chain_index = 0;
+							const codegen::id access_chain = _codegen->emit_access_chain(arguments[i], chain_index);
+							parameters[i].reset_to_lvalue(arguments[i].location, access_chain, param_type);
+							assert(chain_index == arguments[i].chain.size());
+
+							// This is referencing a l-value, but want to avoid copying below
+							parameters[i].is_lvalue = false;
+						}
+						else
+						{
+							// All user-defined functions actually accept pointers as arguments, same applies to intrinsics with 'out' parameters
+							const codegen::id temp_variable = _codegen->define_variable(arguments[i].location, param_type);
+							parameters[i].reset_to_lvalue(arguments[i].location, temp_variable, param_type);
+						}
 					}
 					else
 					{
-						// All user-defined functions actually accept pointers as arguments, same applies to intrinsics with 'out' parameters
-						const codegen::id temp_variable = _codegen->define_variable(arguments[i].location, param_type);
-						parameters[i].reset_to_lvalue(arguments[i].location, temp_variable, param_type);
-					}
-				}
-				else
-				{
-					expression argument_exp = arguments[i];
-					argument_exp.add_cast_operation(param_type);
-					const codegen::id argument_value = _codegen->emit_load(argument_exp);
-					parameters[i].reset_to_rvalue(argument_exp.location, argument_value, param_type);
+						expression argument_exp = arguments[i];
+						argument_exp.add_cast_operation(param_type);
+						const codegen::id argument_value = _codegen->emit_load(argument_exp);
+						parameters[i].reset_to_rvalue(argument_exp.location, argument_value, param_type);
 
-					// Keep track of whether the parameter is a constant for code generation (this makes the expression invalid for all other uses)
-					parameters[i].is_constant = argument_exp.is_constant;
+						// Keep track of whether the parameter is a constant for code generation (this makes the expression invalid for all other uses)
+						parameters[i].is_constant = argument_exp.is_constant;
+					}
 				}
-			}
 
-			// Copy in parameters from the argument access chains to parameter variables
-			for (size_t i = 0; i < arguments.size(); ++i)
-			{
-				// Only do this for pointer parameters as discovered above
-				if (parameters[i].is_lvalue && parameters[i].type.has(type::q_in) && !parameters[i].type.is_object())
+				// Copy in parameters from the argument access chains to parameter variables
+				for (size_t i = 0; i < arguments.size(); ++i)
 				{
-					expression argument_exp = arguments[i];
-					argument_exp.add_cast_operation(parameters[i].type);
-					const codegen::id argument_value = _codegen->emit_load(argument_exp);
-					_codegen->emit_store(parameters[i], argument_value);
+					// Only do this for pointer parameters as discovered above
+					if (parameters[i].is_lvalue && parameters[i].type.has(type::q_in) && !parameters[i].type.is_object())
+					{
+						expression argument_exp = arguments[i];
+						argument_exp.add_cast_operation(parameters[i].type);
+						const codegen::id argument_value = _codegen->emit_load(argument_exp);
+						_codegen->emit_store(parameters[i], argument_value);
+					}
 				}
-			}
 
-			// Add remaining default arguments
-			for (size_t i = arguments.size(); i < parameters.size(); ++i)
-			{
-				assert(symbol.op == symbol_type::function);
+				// Add remaining default arguments
+				for (size_t i = arguments.size(); i < parameters.size(); ++i)
+				{
+					assert(symbol.op == symbol_type::function);
 
-				const auto &param = symbol.function->parameter_list[i];
-				assert(param.has_default_value || !_errors.empty());
+					const auto &param = symbol.function->parameter_list[i];
+					assert(param.has_default_value || !_errors.empty());
 
-				const codegen::id temp_variable = _codegen->define_variable(param.location, param.type);
-				parameters[i].reset_to_lvalue(param.location, temp_variable, param.type);
+					const codegen::id temp_variable = _codegen->define_variable(param.location, param.type);
+					parameters[i].reset_to_lvalue(param.location, temp_variable, param.type);
 
-				const codegen::id argument_value = _codegen->emit_constant(param.type, param.default_value);
-				_codegen->emit_store(parameters[i], argument_value);
-			}
+					const codegen::id argument_value = _codegen->emit_constant(param.type, param.default_value);
+					_codegen->emit_store(parameters[i], argument_value);
+				}
 
-			// Check if the call resolving found an intrinsic or function and invoke the corresponding code
-			const codegen::id result = (symbol.op == symbol_type::function) ?
-				_codegen->emit_call(location, symbol.id, symbol.type, parameters) :
-				_codegen->emit_call_intrinsic(location, symbol.id, symbol.type, parameters);
+				// Check if the call resolving found an intrinsic or function and invoke the corresponding code
+				const codegen::id result = (symbol.op == symbol_type::function) ?
+					_codegen->emit_call(location, symbol.id, symbol.type, parameters) :
+					_codegen->emit_call_intrinsic(location, symbol.id, symbol.type, parameters);
 
-			exp.reset_to_rvalue(location, result, symbol.type);
+				exp.reset_to_rvalue(location, result, symbol.type);
 
-			// Copy out parameters from parameter variables back to the argument access chains
-			for (size_t i = 0; i < arguments.size(); ++i)
-			{
-				// Only do this for pointer parameters as discovered above
-				if (parameters[i].is_lvalue && parameters[i].type.has(type::q_out) && !parameters[i].type.is_object())
+				// Copy out parameters from parameter variables back to the argument access chains
+				for (size_t i = 0; i < arguments.size(); ++i)
 				{
-					expression argument_exp = parameters[i];
-					argument_exp.add_cast_operation(arguments[i].type);
-					const codegen::id argument_value = _codegen->emit_load(argument_exp);
-					_codegen->emit_store(arguments[i], argument_value);
+					// Only do this for pointer parameters as discovered above
+					if (parameters[i].is_lvalue && parameters[i].type.has(type::q_out) && !parameters[i].type.is_object())
+					{
+						expression argument_exp = parameters[i];
+						argument_exp.add_cast_operation(arguments[i].type);
+						const codegen::id argument_value = _codegen->emit_load(argument_exp);
+						_codegen->emit_store(arguments[i], argument_value);
+					}
 				}
-			}
 
-			if (_codegen->_current_function != nullptr && symbol.op == symbol_type::function)
-			{
-				// Calling a function makes the caller inherit all sampler and storage object references from the callee
-				if (!symbol.function->referenced_samplers.empty())
-				{
-					std::vector<codegen::id> referenced_samplers;
-					referenced_samplers.reserve(_codegen->_current_function->referenced_samplers.size() + symbol.function->referenced_samplers.size());
-					std::set_union(_codegen->_current_function->referenced_samplers.begin(), _codegen->_current_function->referenced_samplers.end(), symbol.function->referenced_samplers.begin(), symbol.function->referenced_samplers.end(), std::back_inserter(referenced_samplers));
-					_codegen->_current_function->referenced_samplers = std::move(referenced_samplers);
-				}
-				if (!symbol.function->referenced_storages.empty())
+				if (_codegen->_current_function != nullptr && symbol.op == symbol_type::function)
 				{
-					std::vector<codegen::id> referenced_storages;
-					referenced_storages.reserve(_codegen->_current_function->referenced_storages.size() + symbol.function->referenced_storages.size());
-					std::set_union(_codegen->_current_function->referenced_storages.begin(), _codegen->_current_function->referenced_storages.end(), symbol.function->referenced_storages.begin(), symbol.function->referenced_storages.end(), std::back_inserter(referenced_storages));
-					_codegen->_current_function->referenced_storages = std::move(referenced_storages);
-				}
+					// Calling a function makes the caller inherit all sampler and storage object references from the callee
+					if (!symbol.function->referenced_samplers.empty())
+					{
+						std::vector<codegen::id> referenced_samplers;
+						referenced_samplers.reserve(_codegen->_current_function->referenced_samplers.size() + symbol.function->referenced_samplers.size());
+						std::set_union(_codegen->_current_function->referenced_samplers.begin(), _codegen->_current_function->referenced_samplers.end(), symbol.function->referenced_samplers.begin(), symbol.function->referenced_samplers.end(), std::back_inserter(referenced_samplers));
+						_codegen->_current_function->referenced_samplers = std::move(referenced_samplers);
+					}
+					if (!symbol.function->referenced_storages.empty())
+					{
+						std::vector<codegen::id> referenced_storages;
+						referenced_storages.reserve(_codegen->_current_function->referenced_storages.size() + symbol.function->referenced_storages.size());
+						std::set_union(_codegen->_current_function->referenced_storages.begin(), _codegen->_current_function->referenced_storages.end(), symbol.function->referenced_storages.begin(), symbol.function->referenced_storages.end(), std::back_inserter(referenced_storages));
+						_codegen->_current_function->referenced_storages = std::move(referenced_storages);
+					}
 
-				// Add callee and all its function references to the callers function references
-				{
-					std::vector<codegen::id> referenced_functions;
-					std::set_union(_codegen->_current_function->referenced_functions.begin(), _codegen->_current_function->referenced_functions.end(), symbol.function->referenced_functions.begin(), symbol.function->referenced_functions.end(), std::back_inserter(referenced_functions));
-					const auto it = std::lower_bound(referenced_functions.begin(), referenced_functions.end(), symbol.id);
-					if (it == referenced_functions.end() || *it != symbol.id)
-						referenced_functions.insert(it, symbol.id);
-					_codegen->_current_function->referenced_functions = std::move(referenced_functions);
+					// Add callee and all its function references to the callers function references
+					{
+						std::vector<codegen::id> referenced_functions;
+						std::set_union(_codegen->_current_function->referenced_functions.begin(), _codegen->_current_function->referenced_functions.end(), symbol.function->referenced_functions.begin(), symbol.function->referenced_functions.end(), std::back_inserter(referenced_functions));
+						const auto it = std::lower_bound(referenced_functions.begin(), referenced_functions.end(), symbol.id);
+						if (it == referenced_functions.end() || *it != symbol.id)
+							referenced_functions.insert(it, symbol.id);
+						_codegen->_current_function->referenced_functions = std::move(referenced_functions);
+					}
 				}
 			}
 		}
@@ -1627,10 +1657,22 @@ bool reshadefx::parser::parse_expression_multary(expression &lhs_exp, unsigned i
 			codegen::id false_block = _codegen->create_block();
 
 			_codegen->enter_block(true_block);
+#else
+			// Casting floating-point constants to boolean truncates them, so only select at compile time if the condition was not floating-point to begin with
+			const bool is_constant_condition = lhs_exp.is_constant && !lhs_exp.type.is_floating_point();
+
+			// A constant condition that selects the same side for all components allows skipping code generation for the other side entirely
+			bool is_uniform_condition = is_constant_condition;
+			for (unsigned int i = 1; i < lhs_exp.type.components() && is_uniform_condition; ++i)
+				is_uniform_condition = (lhs_exp.constant.as_uint[i] != 0) == (lhs_exp.constant.as_uint[0] != 0);
 #endif
 			// Parse the first part of the right hand side of the ternary operation
 			expression true_exp;
+#if RESHADEFX_SHORT_CIRCUIT
 			if (!parse_expression(true_exp))
+#else
+			if (!(is_uniform_condition && lhs_exp.constant.as_uint[0] == 0 ? parse_expression_discarded(&parser::parse_expression, true_exp) : parse_expression(true_exp)))
+#endif
 				return false;
 
 			if (!expect(':'))
@@ -1643,7 +1685,11 @@ bool reshadefx::parser::parse_expression_multary(expression &lhs_exp, unsigned i
 #endif
 			// Parse the second part of the right hand side of the ternary operation
 			expression false_exp;
+#if RESHADEFX_SHORT_CIRCUIT
 			if (!parse_expression_assignment(false_exp))
+#else
+			if (!(is_uniform_condition && lhs_exp.constant.as_uint[0] != 0 ? parse_expression_discarded(&parser::parse_expression_assignment, false_exp) : parse_expression_assignment(false_exp)))
+#endif
 				return false;
 
 			// Check that the condition dimension matches that of at least one side
@@ -1678,6 +1724,39 @@ bool reshadefx::parser::parse_expression_multary(expression &lhs_exp, unsigned i
 			true_exp.add_cast_operation(type);
 			false_exp.add_cast_operation(type);
 
+#if !RESHADEFX_SHORT_CIRCUIT
+			if (is_constant_condition)
+			{
+				if (is_uniform_condition)
+				{
+					// The other value was parsed without generating code for it above, so only the selected one has to be loaded
+					const expression &selected_exp = (lhs_exp.constant.as_uint[0] != 0) ? true_exp : false_exp;
+
+					if (selected_exp.is_constant)
+					{
+						lhs_exp.reset_to_rvalue_constant(lhs_exp.location, selected_exp.constant, type);
+					}
+					else
+					{
+						const codegen::id selected_value = _codegen->emit_load(selected_exp);
+						lhs_exp.reset_to_rvalue(lhs_exp.location, selected_value, type);
+					}
+					continue;
+				}
+
+				if (true_exp.is_constant && false_exp.is_constant && (type.is_scalar() || type.is_vector()))
+				{
+					// Select each component separately
+					reshadefx::constant result_constant = {};
+					for (unsigned int i = 0; i < type.components(); ++i)
+						result_constant.as_uint[i] = (lhs_exp.constant.as_uint[i] != 0) ? true_exp.constant.as_uint[i] : false_exp.constant.as_uint[i];
+
+					lhs_exp.reset_to_rvalue_constant(lhs_exp.location, std::move(result_constant), type);
+					continue;
+				}
+			}
+#endif
+
 			// Load condition value from expression
 			const codegen::id condition_value = _codegen->emit_load(lhs_exp);
 
@@ -1774,3 +1853,29 @@ bool reshadefx::parser::parse_expression_assignment(expression &lhs_exp)
 
 	return true;
 }
+
+bool reshadefx::parser::parse_expression_discarded(bool (parser::*parse)(reshadefx::expression &), expression &exp)
+{
+	// Expressions outside of functions (e.g. in global initializers) do not generate any code that would need to be discarded
+	if (!_codegen->is_in_block())
+		return (this->*parse)(exp);
+
+	// Object and function references made by the discarded expression should not end up in the current function
+	std::vector<codegen::id> referenced_samplers = _codegen->_current_function->referenced_samplers;
+	std::vector<codegen::id> referenced_storages = _codegen->_current_function->referenced_storages;
+	std::vector<codegen::id> referenced_functions = _codegen->_current_function->referenced_functions;
+
+	// Still parse the expression to determine its type and report errors, but generate its code into a separate block that is never linked into the control flow
+	const codegen::id previous_block = _codegen->set_block(0);
+	_codegen->enter_block(_codegen->create_block());
+
+	const bool success = (this->*parse)(exp);
+
+	_codegen->set_block(previous_block);
+
+	_codegen->_current_function->referenced_samplers = std::move(referenced_samplers);
+	_codegen->_current_function->referenced_storages = std::move(referenced_storages);
+	_codegen->_current_function->referenced_functions = std::move(referenced_functions);
+
+	return success;
+}
@@ -27,11 +27,14 @@ private:
 bool reshadefx::parser::parse(std::string input, codegen *backend)
 {
 	_lexer = std::make_unique<lexer>(std::move(input));
+	_stats = {};
 
 	// Set backend for subsequent code-generation
 	_codegen = backend;
 	assert(backend != nullptr);
 
+	const auto start_time = std::chrono::high_resolution_clock::now();
+
 	consume();
 
 	bool parse_success = true;
@@ -40,7 +43,10 @@ bool reshadefx::parser::parse(std::string input, codegen *backend)
 	while (!peek(tokenid::end_of_file))
 	{
 		if (!parse_top(current_success))
-			return false;
+		{
+			parse_success = false;
+			break;
+		}
 		if (!current_success)
 			parse_success = false;
 	}
@@ -48,6 +54,8 @@ bool reshadefx::parser::parse(std::string input, codegen *backend)
 	if (parse_success)
 		backend->optimize_bindings();
 
+	_stats.duration = std::chrono::high_resolution_clock::now() - start_time;
+
 	return parse_success;
 }
 
@@ -321,27 +329,70 @@ bool reshadefx::parser::parse_statement(bool scoped)
 				return false;
 			}
 
+			// Casting floating-point constants to boolean truncates them, so only consider conditions that were not floating-point to begin with
+			const bool is_constant_condition = condition_exp.is_constant && !condition_exp.type.is_floating_point();
+
 			// Load condition and convert to boolean value as required by 'OpBranchConditional' in SPIR-V
 			condition_exp.add_cast_operation({ type::t_bool, 1, 1 });
 
 			const codegen::id condition_value = _codegen->emit_load(condition_exp);
 			const codegen::id condition_block = _codegen->leave_block_and_branch_conditional(condition_value, true_block, false_block);
 
+			const bool is_true_branch_dead = is_constant_condition && condition_exp.constant.as_uint[0] == 0;
+			const bool is_false_branch_dead = is_constant_condition && condition_exp.constant.as_uint[0] != 0;
+			bool is_live_branch_terminated = false;
+
 			{ // Then block of the if statement
 				_codegen->enter_block(true_block);
 
-				if (!parse_statement(true))
+				// Skip code generation for a branch that can never be taken
+				if (!(is_true_branch_dead ? parse_statement_discarded(true) : parse_statement(true)))
 					return false;
 
-				true_block = _codegen->leave_block_and_branch(merge_block);
+				if (is_true_branch_dead)
+				{
+					// Keep the block of the dead branch open until it is known how the live branch ends (see below)
+					true_block = _codegen->set_block(0);
+				}
+				else
+				{
+					is_live_branch_terminated = !_codegen->is_in_block();
+					true_block = _codegen->leave_block_and_branch(merge_block);
+				}
 			}
 			{ // Else block of the if statement
 				_codegen->enter_block(false_block);
 
-				if (accept(tokenid::else_) && !parse_statement(true))
+				if (accept(tokenid::else_) && !(is_false_branch_dead ? parse_statement_discarded(true) : parse_statement(true)))
 					return false;
 
-				false_block = _codegen->leave_block_and_branch(merge_block);
+				if (is_false_branch_dead)
+				{
+					false_block = _codegen->set_block(0);
+				}
+				else
+				{
+					is_live_branch_terminated = !_codegen->is_in_block();
+					false_block = _codegen->leave_block_and_branch(merge_block);
+				}
+			}
+
+			if (is_constant_condition)
+			{
+				// The HLSL compiler does not take into account that a branch can never be taken, so if the live branch leaves the function, the dead branch has to as well
+				// Otherwise it may complain about not all control paths returning a value in case the if statement is the last statement of the function
+				codegen::id &dead_block = is_true_branch_dead ? true_block : false_block;
+				_codegen->set_block(dead_block);
+
+				if (is_live_branch_terminated)
+				{
+					const type &return_type = _codegen->_current_function->return_type;
+					dead_block = _codegen->leave_block_and_return(return_type.is_void() ? 0 : _codegen->emit_constant(return_type, constant()));
+				}
+				else
+				{
+					dead_block = _codegen->leave_block_and_branch(merge_block);
+				}
 			}
 
 			_codegen->enter_block(merge_block);
@@ -369,6 +420,9 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			// Load selector and convert to integral value as required by switch instruction
 			selector_exp.add_cast_operation({ type::t_int, 1, 1 });
 
+			// Cases that cannot match a constant selector are removed from the switch statement below
+			const bool is_constant_selector = selector_exp.is_constant;
+
 			const codegen::id selector_value = _codegen->emit_load(selector_exp);
 			const codegen::id selector_block = _codegen->leave_block_and_switch(selector_value, merge_block);
 
@@ -390,6 +444,12 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			std::vector<codegen::id> case_literal_and_labels, case_blocks;
 			size_t last_case_label_index = 0;
 
+			// Keep track of the object and function references before each case, so that those of cases that are removed can be reverted
+			std::vector<codegen::id> case_referenced_samplers = _codegen->_current_function->referenced_samplers;
+			std::vector<codegen::id> case_referenced_storages = _codegen->_current_function->referenced_storages;
+			std::vector<codegen::id> case_referenced_functions = _codegen->_current_function->referenced_functions;
+			bool has_matching_case = false;
+
 			// Enter first switch statement body block
 			_codegen->enter_block(current_label);
 
@@ -470,6 +530,26 @@ bool reshadefx::parser::parse_statement(bool scoped)
 					// This is different from 'current_label', since there may have been branching logic inside the case, which would have changed the active block
 					const codegen::id current_block = _codegen->leave_block_and_branch(next_label);
 
+					// A case can never be taken if none of its literals match a constant selector and it is not the default case (or a previous case already matched)
+					bool is_dead_case = is_constant_selector && (0 != default_block || has_matching_case);
+					for (size_t i = last_case_label_index; i < case_blocks.size() && is_dead_case; ++i)
+						is_dead_case = case_literal_and_labels[2 * i] != selector_exp.constant.as_uint[0];
+
+					if (is_dead_case)
+					{
+						_codegen->_current_function->referenced_samplers = case_referenced_samplers;
+						_codegen->_current_function->referenced_storages = case_referenced_storages;
+						_codegen->_current_function->referenced_functions = case_referenced_functions;
+					}
+					else
+					{
+						has_matching_case |= is_constant_selector && 0 != default_block;
+
+						case_referenced_samplers = _codegen->_current_function->referenced_samplers;
+						case_referenced_storages = _codegen->_current_function->referenced_storages;
+						case_referenced_functions = _codegen->_current_function->referenced_functions;
+					}
+
 					if (0 == default_block)
 						default_block = current_block;
 					for (size_t i = last_case_label_index; i < case_blocks.size(); ++i)
@@ -489,6 +569,31 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			if (case_literal_and_labels.empty() && default_label == merge_block)
 				warning(statement_location, 5002, "switch statement contains no 'case' or 'default' labels");
 
+			if (is_constant_selector)
+			{
+				// Only keep the case matching the selector, or fall back to the default case if there is none
+				std::vector<codegen::id> matching_case_literal_and_labels, matching_case_blocks;
+				for (size_t i = 0; i < case_blocks.size(); ++i)
+				{
+					if (case_literal_and_labels[2 * i] != selector_exp.constant.as_uint[0])
+						continue;
+
+					matching_case_literal_and_labels.push_back(case_literal_and_labels[2 * i + 0]);
+					matching_case_literal_and_labels.push_back(case_literal_and_labels[2 * i + 1]);
+					matching_case_blocks.push_back(case_blocks[i]);
+				}
+
+				// Make the matching case the default as well, so that the switch statement cannot fall through to the end without entering it (otherwise the HLSL compiler may complain about not all control paths returning a value if that case returns)
+				if (!matching_case_blocks.empty())
+				{
+					default_label = matching_case_literal_and_labels[1];
+					default_block = matching_case_blocks[0];
+				}
+
+				case_literal_and_labels = std::move(matching_case_literal_and_labels);
+				case_blocks = std::move(matching_case_blocks);
+			}
+
 			// Emit structured control flow for a switch statement and connect all basic blocks
 			_codegen->emit_switch(statement_location, selector_value, selector_block, default_label, default_block, case_literal_and_labels, case_blocks, selection_control);
 
@@ -936,6 +1041,28 @@ bool reshadefx::parser::parse_statement_block(bool scoped)
 	return expect('}');
 }
 
+bool reshadefx::parser::parse_statement_discarded(bool scoped)
+{
+	// Object and function references made by the discarded statement should not end up in the current function
+	std::vector<codegen::id> referenced_samplers = _codegen->_current_function->referenced_samplers;
+	std::vector<codegen::id> referenced_storages = _codegen->_current_function->referenced_storages;
+	std::vector<codegen::id> referenced_functions = _codegen->_current_function->referenced_functions;
+
+	// Still parse the statement to report errors, but generate its code into a separate block that is never linked into the control flow
+	const codegen::id previous_block = _codegen->set_block(0);
+	_codegen->enter_block(_codegen->create_block());
+
+	const bool success = parse_statement(scoped);
+
+	_codegen->set_block(previous_block);
+
+	_codegen->_current_function->referenced_samplers = std::move(referenced_samplers);
+	_codegen->_current_function->referenced_storages = std::move(referenced_storages);
+	_codegen->_current_function->referenced_functions = std::move(referenced_functions);
+
+	return success;
+}
+
 bool reshadefx::parser::parse_type(type &type)
 {
 	type.qualifiers = 0;
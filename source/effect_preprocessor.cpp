@@ -9,6 +9,7 @@
 #include <cstdio> // fclose, fopen, fread, fseek
 #include <cassert>
 #include <algorithm> // std::find_if
+#include <mutex> // std::unique_lock
 
 #ifndef _WIN32
 	// On Linux systems the native path encoding is UTF-8 already, so no conversion necessary
@@ -99,6 +100,44 @@ static bool read_file(const std::filesystem::path &path, std::string &file_data)
 	return true;
 }
 
+bool reshadefx::file_cache::read(const std::filesystem::path &path, std::shared_ptr<const std::string> &file_data)
+{
+	const std::string path_string = path.u8string();
+
+	{
+		const std::shared_lock<std::shared_mutex> lock(_mutex);
+
+		if (const auto file_it = _files.find(path_string);
+			file_it != _files.end())
+		{
+			file_data = file_it->second;
+			return true;
+		}
+	}
+
+	// Read outside the lock, so that other threads are not blocked on disk access (if two threads read the same file concurrently, the first one to finish wins)
+	std::string new_file_data;
+	if (!read_file(path, new_file_data))
+		return false;
+
+	const std::unique_lock<std::shared_mutex> lock(_mutex);
+	file_data = _files.emplace(path_string, std::make_shared<const std::string>(std::move(new_file_data))).first->second;
+	return true;
+}
+
+static bool read_file(const std::filesystem::path &path, std::shared_ptr<const std::string> &file_data, reshadefx::file_cache *cache)
+{
+	if (cache != nullptr)
+		return cache->read(path, file_data);
+
+	std::string new_file_data;
+	if (!read_file(path, new_file_data))
+		return false;
+
+	file_data = std::make_shared<const std::string>(std::move(new_file_data));
+	return true;
+}
+
 template <char ESCAPE_CHAR = '\\'>
 static std::string escape_string(std::string s)
 {
@@ -137,27 +176,37 @@ bool reshadefx::preprocessor::add_macro_definition(const std::string &name, cons
 
 bool reshadefx::preprocessor::append_file(const std::filesystem::path &path)
 {
-	std::string source_code;
-	if (!read_file(path, source_code))
+	std::shared_ptr<const std::string> source_code;
+	if (!read_file(path, source_code, _shared_file_cache.get()))
 		return false;
 
-	return append_string(std::move(source_code), path);
+	_stats.files[path.u8string()].size = source_code->size();
+
+	return append_buffer(std::move(source_code), path);
 }
 bool reshadefx::preprocessor::append_string(std::string source_code, const std::filesystem::path &path)
+{
+	return append_buffer(std::make_shared<const std::string>(std::move(source_code)), path);
+}
+bool reshadefx::preprocessor::append_buffer(std::shared_ptr<const std::string> source_code, const std::filesystem::path &path)
 {
 	// Enforce all input strings to end with a line feed
-	if (source_code.empty() || source_code.back() != '\n')
+	if (source_code->empty() || source_code->back() != '\n')
 		return false;
 
 	// Only consider new errors added below for the success of this call
 	const size_t errors_offset = _errors.length();
 
+	const auto start_time = std::chrono::high_resolution_clock::now();
+
 	// Give this push a name, so that lexer location starts at a new line
 	// This is necessary in case this string starts with a preprocessor directive, since the lexer only reports those as such if they appear at the beginning of a new line
 	// But without a name, the lexer location is set to the last token location, which most likely will not be at the start of the line
 	push(std::move(source_code), path.empty() ? "unknown" : path.u8string());
 	parse();
 
+	_stats.duration += std::chrono::high_resolution_clock::now() - start_time;
+
 	return _errors.find(": preprocessor error: ", errors_offset) == std::string::npos;
 }
 
@@ -165,10 +214,18 @@ std::vector<std::filesystem::path> reshadefx::preprocessor::included_files() con
 {
 	std::vector<std::filesystem::path> files;
 	files.reserve(_file_cache.size());
-	for (const std::pair<std::string, std::string> &cache_entry : _file_cache)
+	for (const std::pair<const std::string, std::shared_ptr<const std::string>> &cache_entry : _file_cache)
 		files.push_back(std::filesystem::u8path(cache_entry.first));
 	return files;
 }
+std::vector<std::filesystem::path> reshadefx::preprocessor::missing_files() const
+{
+	std::vector<std::filesystem::path> files;
+	files.reserve(_missing_files.size());
+	for (const std::string &file : _missing_files)
+		files.push_back(std::filesystem::u8path(file));
+	return files;
+}
 std::vector<std::pair<std::string, std::string>> reshadefx::preprocessor::used_macro_definitions() const
 {
 	std::vector<std::pair<std::string, std::string>> definitions;
@@ -201,6 +258,10 @@ void reshadefx::preprocessor::warning(const location &location, const std::strin
 }
 
 void reshadefx::preprocessor::push(std::string input, const std::string &name)
+{
+	push(std::make_shared<const std::string>(std::move(input)), name);
+}
+void reshadefx::preprocessor::push(std::shared_ptr<const std::string> input, const std::string &name)
 {
 	location start_location = !name.empty() ?
 		// Start at the beginning of the file when pushing a new file
@@ -262,11 +323,21 @@ void reshadefx::preprocessor::consume()
 		// Line number is increased before checking against next token in 'tokenid::end_of_line' handling in 'parse' function below, so compensate for that here
 		_output_location.line = input.next_token.location.line - 1;
 		_output_location.source = input.name;
+
+		_current_file_stats = &_stats.files[input.name];
 	}
 
+	_stats.num_tokens++;
+	if (_current_file_stats != nullptr)
+		_current_file_stats->num_tokens++;
+
 	// Set current token
 	_token = std::move(input.next_token);
-	_current_token_raw_data = input.lexer->input_string().substr(_token.offset, _token.length);
+	_current_token_raw_data = input.lexer->token_data(_token);
+
+	// Keep the input alive as long as the raw data of the current token references it, even if its input level is popped
+	if (_current_token_input != input.lexer->input_buffer())
+		_current_token_input = input.lexer->input_buffer();
 
 	// Get the next token
 	input.next_token = input.lexer->lex();
@@ -337,8 +408,8 @@ bool reshadefx::preprocessor::expect(tokenid tokid)
 		}
 		else
 		{
-			const std::string token_string = _input_stack[_next_input_index].lexer->input_string().substr(actual_token.offset, actual_token.length);
-			error(actual_token.location, "syntax error: unexpected token '" + token_string + '\'');
+			const std::string_view token_string = _input_stack[_next_input_index].lexer->token_data(actual_token);
+			error(actual_token.location, "syntax error: unexpected token '" + std::string(token_string) + '\'');
 		}
 
 		return false;
@@ -700,11 +771,11 @@ void reshadefx::preprocessor::parse_pragma()
 
 	if (pragma == "once")
 	{
-		// Clear file contents, so that future include statements simply push an empty string instead of these file contents again
+		// Replace file contents, so that future include statements simply push an empty string instead of these file contents again (without modifying the buffer, which may be shared)
 		if (const auto file_it = _file_cache.find(_output_location.source);
 			file_it != _file_cache.end())
 		{
-			file_it->second.clear();
+			file_it->second = std::make_shared<const std::string>();
 		}
 		return;
 	}
@@ -738,15 +809,10 @@ void reshadefx::preprocessor::parse_include()
 		return;
 	}
 
-	std::filesystem::path file_name = std::filesystem::u8path(_token.literal_as_string);
-	std::filesystem::path file_path = std::filesystem::u8path(_output_location.source);
-	file_path.replace_filename(file_name);
+	const std::filesystem::path file_name = std::filesystem::u8path(_token.literal_as_string);
 
-	std::error_code ec;
-	if (!std::filesystem::exists(file_path, ec))
-		for (const std::filesystem::path &include_path : _include_paths)
-			if (std::filesystem::exists(file_path = include_path / file_name, ec))
-				break;
+	std::filesystem::path file_path;
+	resolve_include_path(file_name, file_path);
 
 	const std::string file_path_string = file_path.u8string();
 
@@ -757,7 +823,7 @@ void reshadefx::preprocessor::parse_include()
 			}) != _input_stack.end())
 		return error(_token.location, "recursive #include");
 
-	std::string input;
+	std::shared_ptr<const std::string> input;
 
 	if (const auto file_it = _file_cache.find(file_path_string);
 		file_it != _file_cache.end())
@@ -766,10 +832,12 @@ void reshadefx::preprocessor::parse_include()
 	}
 	else
 	{
-		if (!read_file(file_path, input))
+		if (!read_file(file_path, input, _shared_file_cache.get()))
 			return error(keyword_location, "could not open included file '" + file_name.u8string() + '\'');
 
 		_file_cache.emplace(file_path_string, input);
+
+		_stats.files[file_path_string].size = input->size();
 	}
 
 	// Skip end of line character following the include statement before pushing, so that the line number is already pointing to the next line when popping out of it again
@@ -783,6 +851,27 @@ void reshadefx::preprocessor::parse_include()
 	push(std::move(input), file_path_string);
 }
 
+bool reshadefx::preprocessor::resolve_include_path(const std::filesystem::path &file_name, std::filesystem::path &file_path)
+{
+	// Search next to the current file first, then in all include paths in order
+	file_path = std::filesystem::u8path(_output_location.source);
+	file_path.replace_filename(file_name);
+
+	std::error_code ec;
+	for (size_t include_path_index = 0; !std::filesystem::exists(file_path, ec); ++include_path_index)
+	{
+		// Keep track of candidates that did not exist, since creating one of them later would change which file is resolved
+		_missing_files.insert(file_path.u8string());
+
+		if (include_path_index >= _include_paths.size())
+			return false;
+
+		file_path = _include_paths[include_path_index] / file_name;
+	}
+
+	return true;
+}
+
 bool reshadefx::preprocessor::evaluate_expression()
 {
 	struct rpn_token
@@ -935,20 +1024,13 @@ bool reshadefx::preprocessor::evaluate_expression()
 				if (!expect(tokenid::string_literal))
 					return false;
 
-				std::filesystem::path file_name = std::filesystem::u8path(_token.literal_as_string);
-				std::filesystem::path file_path = std::filesystem::u8path(_output_location.source);
-				file_path.replace_filename(file_name);
+				const std::filesystem::path file_name = std::filesystem::u8path(_token.literal_as_string);
 
 				if (has_parentheses && !expect(tokenid::parenthesis_close))
 					return false;
 
-				std::error_code ec;
-				if (!std::filesystem::exists(file_path, ec))
-					for (const std::filesystem::path &include_path : _include_paths)
-						if (std::filesystem::exists(file_path = include_path / file_name, ec))
-							break;
-
-				rpn[rpn_index++] = { std::filesystem::exists(file_path, ec) ? 1 : 0, false };
+				std::filesystem::path file_path;
+				rpn[rpn_index++] = { resolve_include_path(file_name, file_path) ? 1 : 0, false };
 				continue;
 			}
 			if (_token.literal_as_string == "defined")
@@ -1155,9 +1237,9 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 
 	if (!_input_stack.empty())
 	{
-		const std::unordered_set<std::string> &hidden_macros = _input_stack[_current_input_index].hidden_macros;
-		if (hidden_macros.find(_token.literal_as_string) != hidden_macros.end())
-			return false;
+		for (const hidden_macro *hidden_macro = _input_stack[_current_input_index].hidden_macros.get(); hidden_macro != nullptr; hidden_macro = hidden_macro->next.get())
+			if (hidden_macro->name == _token.literal_as_string)
+				return false;
 	}
 
 	const location macro_location = _token.location;
@@ -1233,6 +1315,10 @@ bool reshadefx::preprocessor::is_defined(const std::string &name) const
 
 void reshadefx::preprocessor::expand_macro(const std::string &name, const macro &definition, const std::vector<std::string> &arguments)
 {
+	_stats.num_macro_expansions++;
+	if (_current_file_stats != nullptr)
+		_current_file_stats->num_macro_expansions++;
+
 	if (definition.replacement_list.empty())
 		return;
 
@@ -1301,7 +1387,8 @@ void reshadefx::preprocessor::expand_macro(const std::string &name, const macro
 	push(std::move(input));
 
 	// Avoid expanding macros again that are referencing themselves
-	_input_stack[_current_input_index].hidden_macros.insert(name);
+	std::shared_ptr<const hidden_macro> &hidden_macros = _input_stack[_current_input_index].hidden_macros;
+	hidden_macros = std::make_shared<const hidden_macro>(hidden_macro { name, std::move(hidden_macros) });
 }
 
 void reshadefx::preprocessor::create_macro_replacement_list(macro &definition)
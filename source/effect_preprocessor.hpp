@@ -6,13 +6,35 @@
 #pragma once
 
 #include "effect_token.hpp"
-#include <memory> // std::unique_ptr
+#include <chrono>
+#include <memory> // std::shared_ptr, std::unique_ptr
+#include <string_view>
 #include <filesystem>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 
 namespace reshadefx
 {
+	/// <summary>
+	/// A thread-safe cache of file contents that can be shared between multiple preprocessor instances, so that files included by many effects are only read from disk once.
+	/// </summary>
+	class file_cache
+	{
+	public:
+		/// <summary>
+		/// Gets the contents of the specified file, reading it from disk if it is not in the cache yet.
+		/// </summary>
+		/// <param name="path">Path to the file to read.</param>
+		/// <param name="file_data">Reference filled with an immutable buffer holding the file contents, which is shared with all other readers of the same file.</param>
+		/// <returns><see langword="true"/> if the file was read successfully, <see langword="false"/> otherwise.</returns>
+		bool read(const std::filesystem::path &path, std::shared_ptr<const std::string> &file_data);
+
+	private:
+		std::shared_mutex _mutex;
+		std::unordered_map<std::string, std::shared_ptr<const std::string>> _files;
+	};
+
 	/// <summary>
 	/// A C-style preprocessor implementation.
 	/// </summary>
@@ -28,6 +50,20 @@ namespace reshadefx
 			bool is_function_like = false;
 		};
 
+		struct file_statistics
+		{
+			size_t size = 0;
+			size_t num_tokens = 0;
+			size_t num_macro_expansions = 0;
+		};
+		struct statistics
+		{
+			std::chrono::high_resolution_clock::duration duration = {};
+			size_t num_tokens = 0;
+			size_t num_macro_expansions = 0;
+			std::unordered_map<std::string, file_statistics> files;
+		};
+
 		// Define constructor explicitly because lexer class is not included here
 		preprocessor();
 		~preprocessor();
@@ -38,6 +74,12 @@ namespace reshadefx
 		/// <param name="path">Path to the directory to add.</param>
 		void add_include_path(const std::filesystem::path &path);
 
+		/// <summary>
+		/// Sets a file cache to read files from, instead of reading them from disk every time.
+		/// </summary>
+		/// <param name="cache">Cache shared with other preprocessor instances, or <see langword="nullptr"/> to disable.</param>
+		void set_file_cache(std::shared_ptr<file_cache> cache) { _shared_file_cache = std::move(cache); }
+
 		/// <summary>
 		/// Adds a new macro definition. This is equal to appending '#define name definition' to this preprocessor instance.
 		/// </summary>
@@ -83,6 +125,11 @@ namespace reshadefx
 		/// Gets a list of paths to all the included files.
 		/// </summary>
 		std::vector<std::filesystem::path> included_files() const;
+		/// <summary>
+		/// Gets a list of paths that were searched for an included file (or a file checked with 'exists') before it was found, but did not exist.
+		/// Creating any of these files would change which file is included, so they are part of the dependencies of the output as well.
+		/// </summary>
+		std::vector<std::filesystem::path> missing_files() const;
 
 		/// <summary>
 		/// Gets a list of all defines that were used in #ifdef and #ifndef lines.
@@ -94,6 +141,11 @@ namespace reshadefx
 		/// </summary>
 		std::vector<std::pair<std::string, std::string>> used_pragma_directives() const { return _used_pragmas; }
 
+		/// <summary>
+		/// Gets the time spent, tokens processed and macros expanded so far, in total and per file (tokens resulting from a macro expansion are attributed to the file the macro was expanded in).
+		/// </summary>
+		const statistics &stats() const { return _stats; }
+
 	private:
 		struct if_level
 		{
@@ -102,18 +154,27 @@ namespace reshadefx
 			token pp_token;
 			size_t input_index;
 		};
+		struct hidden_macro
+		{
+			std::string name;
+			std::shared_ptr<const hidden_macro> next;
+		};
 		struct input_level
 		{
 			std::string name;
 			std::unique_ptr<class lexer> lexer;
 			token next_token;
-			std::unordered_set<std::string> hidden_macros;
+			// Linked list of macros that may not be expanded in this input level, which is shared with the parent level it was inherited from
+			std::shared_ptr<const hidden_macro> hidden_macros;
 		};
 
 		void error(const location &location, const std::string &message);
 		void warning(const location &location, const std::string &message);
 
+		bool append_buffer(std::shared_ptr<const std::string> source_code, const std::filesystem::path &path);
+
 		void push(std::string input, const std::string &name = std::string());
+		void push(std::shared_ptr<const std::string> input, const std::string &name = std::string());
 
 		bool peek(tokenid tokid) const;
 		void consume();
@@ -135,6 +196,8 @@ namespace reshadefx
 		void parse_pragma();
 		void parse_include();
 
+		bool resolve_include_path(const std::filesystem::path &file_name, std::filesystem::path &file_path);
+
 		bool evaluate_expression();
 		bool evaluate_identifier_as_macro();
 
@@ -148,7 +211,9 @@ namespace reshadefx
 		size_t _next_input_index = 0;
 		size_t _current_input_index = 0;
 		reshadefx::token _token;
-		std::string _current_token_raw_data;
+		// Slice of the input the current token was created from, which stays valid until the next call to 'consume', since the input buffer is kept alive here
+		std::string_view _current_token_raw_data;
+		std::shared_ptr<const std::string> _current_token_input;
 		reshadefx::location _output_location;
 
 		unsigned short _recursion_count = 0;
@@ -160,6 +225,11 @@ namespace reshadefx
 		std::vector<std::pair<std::string, std::string>> _used_pragmas;
 
 		std::vector<std::filesystem::path> _include_paths;
-		std::unordered_map<std::string, std::string> _file_cache;
+		std::unordered_map<std::string, std::shared_ptr<const std::string>> _file_cache;
+		std::unordered_set<std::string> _missing_files;
+		std::shared_ptr<file_cache> _shared_file_cache;
+
+		statistics _stats;
+		file_statistics *_current_file_stats = nullptr;
 	};
 }
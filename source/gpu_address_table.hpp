@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <type_traits>
+#include <unordered_map>
+
+namespace reshade
+{
+	/// <summary>
+	/// Maps GPU virtual addresses to the buffer resources containing them, with lookups that do not take any locks.
+	/// Resources are identified by a handle of type <typeparamref name="T"/> (e.g. a pointer to the native resource object), which has to be cheap to copy and can never be zero for valid resources.
+	/// The address space is split into 64 KiB pages (the placement alignment of buffers), each of which references the last buffer registered to cover it through a radix tree that only ever grows.
+	/// Entries are recycled instead of freed and guarded by a sequence counter, so that a lookup racing with the removal of a buffer notices and fails, rather than returning stale data.
+	/// Lookups may fail for addresses that do belong to a buffer (e.g. when multiple buffers share a page), so callers should fall back to an exact search in that case.
+	/// Modifications are not synchronized and have to be serialized by the caller.
+	/// </summary>
+	template <typename T>
+	class gpu_address_table
+	{
+		static_assert(std::is_trivially_copyable_v<T>);
+
+		static constexpr unsigned int page_bits = 16;
+		static constexpr unsigned int leaf_bits = 12;
+		static constexpr unsigned int inner_bits = 12;
+		static constexpr unsigned int root_bits = 8;
+		static constexpr unsigned int address_bits = page_bits + leaf_bits + inner_bits + root_bits;
+		static_assert(address_bits == 48);
+
+		static constexpr uint32_t entries_per_block = 4096;
+		static constexpr uint32_t max_entry_blocks = 1024;
+
+		struct entry
+		{
+			std::atomic<uint32_t> sequence = 0; // Odd while the entry is being modified
+			std::atomic<uint64_t> start_address = 0;
+			std::atomic<uint64_t> size = 0;
+			std::atomic<T> resource = T {};
+			std::atomic<bool> acceleration_structure = false;
+		};
+
+		struct leaf_node
+		{
+			std::atomic<uint32_t> entries[1 << leaf_bits] = {}; // One-based entry index, or zero if no buffer covers the page
+		};
+		struct inner_node
+		{
+			std::atomic<leaf_node *> children[1 << inner_bits] = {};
+		};
+
+	public:
+		gpu_address_table() = default;
+		gpu_address_table(const gpu_address_table &) = delete;
+		~gpu_address_table()
+		{
+			for (std::atomic<inner_node *> &root_child : _root)
+			{
+				if (inner_node *const inner = root_child.load(std::memory_order_relaxed))
+				{
+					for (std::atomic<leaf_node *> &inner_child : inner->children)
+						delete inner_child.load(std::memory_order_relaxed);
+					delete inner;
+				}
+			}
+		}
+
+		gpu_address_table &operator=(const gpu_address_table &) = delete;
+
+		/// <summary>
+		/// Adds a buffer that occupies the specified address range, replacing any previous registration of the same <paramref name="resource"/>.
+		/// Pages already covered by another buffer are taken over, so that placed resources that alias older ones take precedence.
+		/// </summary>
+		/// <returns><see langword="true"/> if the buffer was added, or <see langword="false"/> if the address range is outside the covered address space (in which case lookups will fail and callers have to rely on their fallback).</returns>
+		bool insert(T resource, uint64_t address, uint64_t size, bool acceleration_structure)
+		{
+			assert(resource != T {});
+
+			erase(resource);
+
+			if (size == 0 || (address >> address_bits) != 0 || ((address + size - 1) >> address_bits) != 0)
+				return false;
+
+			uint32_t index;
+			if (!_free_entries.empty())
+			{
+				index = _free_entries.back();
+				_free_entries.pop_back();
+			}
+			else
+			{
+				if (_entry_count == entries_per_block * max_entry_blocks)
+					return false;
+				if (_entry_count % entries_per_block == 0)
+					_entry_blocks[_entry_count / entries_per_block] = std::make_unique<entry[]>(entries_per_block);
+				index = _entry_count++;
+			}
+
+			write_entry(get_entry(index), resource, address, size, acceleration_structure);
+
+			_resource_entries.emplace(resource, index);
+
+			for (uint64_t page = address >> page_bits, last_page = (address + size - 1) >> page_bits; page <= last_page; ++page)
+				get_page_slot(page)->store(index + 1, std::memory_order_release);
+
+			return true;
+		}
+
+		/// <summary>
+		/// Removes the buffer previously added with <see cref="insert"/>.
+		/// </summary>
+		void erase(T resource)
+		{
+			const auto it = _resource_entries.find(resource);
+			if (it == _resource_entries.end())
+				return;
+
+			const uint32_t index = it->second;
+			_resource_entries.erase(it);
+
+			entry &buffer = get_entry(index);
+
+			const uint64_t address = buffer.start_address.load(std::memory_order_relaxed);
+			const uint64_t size = buffer.size.load(std::memory_order_relaxed);
+
+			// Clear all pages that still reference this entry (some may have been taken over by another buffer since)
+			for (uint64_t page = address >> page_bits, last_page = (address + size - 1) >> page_bits; page <= last_page; ++page)
+			{
+				std::atomic<uint32_t> *const slot = get_page_slot(page);
+				if (slot->load(std::memory_order_relaxed) == index + 1)
+					slot->store(0, std::memory_order_release);
+			}
+
+			// Invalidate entry, so that concurrent lookups that already loaded its index fail
+			write_entry(buffer, T {}, 0, 0, false);
+
+			_free_entries.push_back(index);
+		}
+
+		/// <summary>
+		/// Finds the buffer containing the specified address. This may be called concurrently with modifications.
+		/// </summary>
+		bool find(uint64_t address, T &out_resource, uint64_t &out_offset, bool &out_acceleration_structure) const
+		{
+			if ((address >> address_bits) != 0)
+				return false;
+
+			const uint64_t page = address >> page_bits;
+
+			const inner_node *const inner = _root[page >> (leaf_bits + inner_bits)].load(std::memory_order_acquire);
+			if (inner == nullptr)
+				return false;
+			const leaf_node *const leaf = inner->children[(page >> leaf_bits) & ((1 << inner_bits) - 1)].load(std::memory_order_acquire);
+			if (leaf == nullptr)
+				return false;
+
+			const uint32_t index = leaf->entries[page & ((1 << leaf_bits) - 1)].load(std::memory_order_acquire);
+			if (index == 0)
+				return false;
+
+			const entry &buffer = get_entry(index - 1);
+
+			const uint32_t sequence = buffer.sequence.load(std::memory_order_acquire);
+			if ((sequence & 1) != 0)
+				return false;
+
+			const uint64_t start_address = buffer.start_address.load(std::memory_order_relaxed);
+			const uint64_t size = buffer.size.load(std::memory_order_relaxed);
+			const T resource = buffer.resource.load(std::memory_order_relaxed);
+			const bool acceleration_structure = buffer.acceleration_structure.load(std::memory_order_relaxed);
+
+			// Verify that the entry was not modified while reading it
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (buffer.sequence.load(std::memory_order_relaxed) != sequence)
+				return false;
+
+			// Verify that the address is actually within the address range of that resource (pages may be shared with other buffers)
+			const uint64_t address_offset = address - start_address;
+			if (resource == T {} || address < start_address || address_offset >= size)
+				return false;
+
+			out_resource = resource;
+			out_offset = address_offset;
+			out_acceleration_structure = acceleration_structure;
+			return true;
+		}
+
+	private:
+		entry &get_entry(uint32_t index) const
+		{
+			// Blocks are allocated before any page can reference an entry in them and never freed, so reading them here does not race with 'insert'
+			return _entry_blocks[index / entries_per_block][index % entries_per_block];
+		}
+
+		std::atomic<uint32_t> *get_page_slot(uint64_t page)
+		{
+			std::atomic<inner_node *> &root_child = _root[page >> (leaf_bits + inner_bits)];
+			inner_node *inner = root_child.load(std::memory_order_relaxed);
+			if (inner == nullptr)
+				root_child.store(inner = new inner_node(), std::memory_order_release);
+
+			std::atomic<leaf_node *> &inner_child = inner->children[(page >> leaf_bits) & ((1 << inner_bits) - 1)];
+			leaf_node *leaf = inner_child.load(std::memory_order_relaxed);
+			if (leaf == nullptr)
+				inner_child.store(leaf = new leaf_node(), std::memory_order_release);
+
+			return &leaf->entries[page & ((1 << leaf_bits) - 1)];
+		}
+
+		static void write_entry(entry &entry, T resource, uint64_t address, uint64_t size, bool acceleration_structure)
+		{
+			const uint32_t sequence = entry.sequence.load(std::memory_order_relaxed);
+			entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			entry.start_address.store(address, std::memory_order_relaxed);
+			entry.size.store(size, std::memory_order_relaxed);
+			entry.resource.store(resource, std::memory_order_relaxed);
+			entry.acceleration_structure.store(acceleration_structure, std::memory_order_relaxed);
+
+			entry.sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+		std::atomic<inner_node *> _root[1 << root_bits] = {};
+		std::unique_ptr<entry[]> _entry_blocks[max_entry_blocks];
+		uint32_t _entry_count = 0;
+		std::vector<uint32_t> _free_entries;
+		std::unordered_map<T, uint32_t> _resource_entries;
+	};
+}
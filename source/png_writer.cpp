@@ -0,0 +1,736 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "png_writer.hpp"
+#include "crc32_hash.hpp"
+#include <mutex>
+#include <memory>
+#include <cassert>
+#include <cstdlib> // std::abs
+#include <cstring> // std::memcpy
+#include <algorithm> // std::count_if, std::max, std::min, std::min_element, std::sort
+
+// Target amount of uncompressed data per stripe, which is large enough that the compression loss at stripe boundaries (where matches cannot reach into the previous stripe) is negligible
+static constexpr size_t stripe_size = 1 << 20;
+
+static constexpr uint32_t window_size = 32768;
+static constexpr uint32_t hash_bits = 15;
+static constexpr uint32_t max_chain_depth = 8;
+static constexpr uint32_t min_match_length = 4;
+static constexpr uint32_t max_match_length = 258;
+static constexpr size_t max_block_tokens = 16384;
+
+static constexpr uint16_t length_base[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static constexpr uint8_t length_extra_bits[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static constexpr uint16_t distance_base[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static constexpr uint8_t distance_extra_bits[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+static constexpr uint8_t code_length_order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+namespace
+{
+	struct symbol_tables
+	{
+		symbol_tables()
+		{
+			for (uint8_t code = 0; code < 29; ++code)
+				for (uint32_t length = length_base[code]; length < length_base[code] + (1u << length_extra_bits[code]) && length <= max_match_length; ++length)
+					length_code[length - 3] = code;
+
+			for (uint8_t code = 0; code < 30; ++code)
+			{
+				for (uint32_t distance = distance_base[code]; distance < distance_base[code] + (1u << distance_extra_bits[code]); ++distance)
+				{
+					if (distance <= 256)
+						distance_code_lo[distance - 1] = code;
+					else
+						distance_code_hi[(distance - 1) >> 7] = code;
+				}
+			}
+		}
+
+		uint8_t get_distance_code(uint32_t distance) const
+		{
+			return distance <= 256 ? distance_code_lo[distance - 1] : distance_code_hi[(distance - 1) >> 7];
+		}
+
+		uint8_t length_code[256];
+		uint8_t distance_code_lo[256];
+		uint8_t distance_code_hi[256];
+	};
+
+	struct token
+	{
+		uint16_t literal_or_length;
+		uint16_t distance; // Zero for literals
+	};
+
+	class bit_writer
+	{
+	public:
+		explicit bit_writer(std::vector<uint8_t> &data) : _data(data) {}
+
+		void put(uint32_t value, uint32_t length)
+		{
+			assert(length <= 32 && (length == 32 || (value >> length) == 0));
+
+			_bits |= static_cast<uint64_t>(value) << _count;
+			_count += length;
+
+			if (_count >= 32)
+			{
+				_data.push_back(static_cast<uint8_t>(_bits));
+				_data.push_back(static_cast<uint8_t>(_bits >> 8));
+				_data.push_back(static_cast<uint8_t>(_bits >> 16));
+				_data.push_back(static_cast<uint8_t>(_bits >> 24));
+				_bits >>= 32;
+				_count -= 32;
+			}
+		}
+
+		void align_to_byte()
+		{
+			while (_count != 0)
+			{
+				_data.push_back(static_cast<uint8_t>(_bits));
+				_bits >>= 8;
+				_count = _count > 8 ? _count - 8 : 0;
+			}
+			_bits = 0;
+		}
+
+	private:
+		std::vector<uint8_t> &_data;
+		uint64_t _bits = 0;
+		uint32_t _count = 0;
+	};
+}
+
+static void append_u32_be(std::vector<uint8_t> &data, uint32_t value)
+{
+	data.push_back(static_cast<uint8_t>(value >> 24));
+	data.push_back(static_cast<uint8_t>(value >> 16));
+	data.push_back(static_cast<uint8_t>(value >> 8));
+	data.push_back(static_cast<uint8_t>(value));
+}
+static void append_chunk(std::vector<uint8_t> &data, const char type[4], const uint8_t *chunk_data, uint32_t chunk_size)
+{
+	append_u32_be(data, chunk_size);
+	const size_t offset = data.size();
+	data.insert(data.end(), type, type + 4);
+	data.insert(data.end(), chunk_data, chunk_data + chunk_size);
+	// Checksum covers chunk type and chunk data
+	append_u32_be(data, compute_crc32(data.data() + offset, 4 + chunk_size));
+}
+
+static uint32_t compute_adler32(const uint8_t *data, size_t size)
+{
+	uint32_t a = 1, b = 0;
+	while (size != 0)
+	{
+		// Largest number of bytes that can be summed before 'b' can overflow
+		const size_t block_size = std::min(size, static_cast<size_t>(5552));
+		for (size_t i = 0; i < block_size; ++i)
+		{
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += block_size;
+		size -= block_size;
+	}
+	return (b << 16) | a;
+}
+static uint32_t combine_adler32(uint32_t adler1, uint32_t adler2, size_t size2)
+{
+	// See 'adler32_combine' in zlib
+	const uint32_t base = 65521;
+	const uint32_t rem = static_cast<uint32_t>(size2 % base);
+	uint32_t sum1 = adler1 & 0xFFFF;
+	uint32_t sum2 = (rem * sum1) % base;
+	sum1 += (adler2 & 0xFFFF) + base - 1;
+	sum2 += (adler1 >> 16) + (adler2 >> 16) + base - rem;
+	if (sum1 >= base)
+		sum1 -= base;
+	if (sum1 >= base)
+		sum1 -= base;
+	if (sum2 >= (base << 1))
+		sum2 -= (base << 1);
+	if (sum2 >= base)
+		sum2 -= base;
+	return sum1 | (sum2 << 16);
+}
+
+static void build_code_lengths(const uint32_t *frequencies, uint32_t count, uint32_t max_length, uint8_t *lengths)
+{
+	struct symbol
+	{
+		uint32_t frequency;
+		uint32_t index;
+	} symbols[288];
+	uint32_t num_symbols = 0;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		lengths[i] = 0;
+		if (frequencies[i] != 0)
+			symbols[num_symbols++] = { frequencies[i], i };
+	}
+
+	if (num_symbols == 0)
+		return;
+	if (num_symbols == 1)
+	{
+		lengths[symbols[0].index] = 1;
+		return;
+	}
+
+	std::sort(symbols, symbols + num_symbols, [](const symbol &lhs, const symbol &rhs) { return lhs.frequency < rhs.frequency || (lhs.frequency == rhs.frequency && lhs.index < rhs.index); });
+
+	// Compute optimal code lengths in place (see "In-Place Calculation of Minimum-Redundancy Codes" by Moffat and Katajainen)
+	uint32_t a[288];
+	for (uint32_t i = 0; i < num_symbols; ++i)
+		a[i] = symbols[i].frequency;
+	{
+		const int n = static_cast<int>(num_symbols);
+		int root = 0, leaf = 2;
+		a[0] += a[1];
+		for (int next = 1; next < n - 1; ++next)
+		{
+			if (leaf >= n || a[root] < a[leaf])
+				a[next] = a[root], a[root++] = next;
+			else
+				a[next] = a[leaf++];
+
+			if (leaf >= n || (root < next && a[root] < a[leaf]))
+				a[next] += a[root], a[root++] = next;
+			else
+				a[next] += a[leaf++];
+		}
+
+		a[n - 2] = 0;
+		for (int next = n - 3; next >= 0; --next)
+			a[next] = a[a[next]] + 1;
+
+		int available = 1, used = 0, depth = 0;
+		root = n - 2;
+		for (int next = n - 1; available > 0; available = 2 * used, used = 0, ++depth)
+		{
+			while (root >= 0 && static_cast<int>(a[root]) == depth)
+				used++, root--;
+			while (available > used)
+				a[next--] = depth, available--;
+		}
+	}
+
+	// Limit code lengths to the maximum by moving overlong codes up and then splitting shorter codes until the code is complete again
+	uint32_t num_codes[64] = {};
+	for (uint32_t i = 0; i < num_symbols; ++i)
+		num_codes[std::min(a[i], max_length + 1)]++;
+	num_codes[max_length] += num_codes[max_length + 1];
+
+	uint32_t total = 0;
+	for (uint32_t i = 1; i <= max_length; ++i)
+		total += num_codes[i] << (max_length - i);
+	for (; total != (1u << max_length); --total)
+	{
+		num_codes[max_length]--;
+		for (uint32_t i = max_length - 1; i > 0; --i)
+		{
+			if (num_codes[i] != 0)
+			{
+				num_codes[i]--;
+				num_codes[i + 1] += 2;
+				break;
+			}
+		}
+	}
+
+	// Assign the shortest codes to the most frequent symbols
+	for (uint32_t length = 1, i = num_symbols; length <= max_length; ++length)
+		for (uint32_t k = num_codes[length]; k != 0; --k)
+			lengths[symbols[--i].index] = static_cast<uint8_t>(length);
+}
+static void build_codes(const uint8_t *lengths, uint32_t count, uint16_t *codes)
+{
+	uint32_t num_codes[16] = {};
+	for (uint32_t i = 0; i < count; ++i)
+		num_codes[lengths[i]]++;
+	num_codes[0] = 0;
+
+	uint32_t next_code[16] = {};
+	for (uint32_t length = 1, code = 0; length < 16; ++length)
+		next_code[length] = code = (code + num_codes[length - 1]) << 1;
+
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const uint32_t length = lengths[i];
+		if (length == 0)
+			continue;
+
+		// Huffman codes are stored starting with the most significant bit, but the bit writer fills bytes starting with the least significant bit, so reverse them
+		uint32_t code = next_code[length]++, reversed_code = 0;
+		for (uint32_t k = 0; k < length; ++k, code >>= 1)
+			reversed_code = (reversed_code << 1) | (code & 1);
+		codes[i] = static_cast<uint16_t>(reversed_code);
+	}
+}
+
+static void write_dynamic_block(const symbol_tables &tables, const token *tokens, size_t num_tokens, bit_writer &out)
+{
+	uint32_t literal_frequencies[286] = {};
+	uint32_t distance_frequencies[30] = {};
+
+	for (size_t i = 0; i < num_tokens; ++i)
+	{
+		if (tokens[i].distance == 0)
+		{
+			literal_frequencies[tokens[i].literal_or_length]++;
+		}
+		else
+		{
+			literal_frequencies[257 + tables.length_code[tokens[i].literal_or_length - 3]]++;
+			distance_frequencies[tables.get_distance_code(tokens[i].distance)]++;
+		}
+	}
+
+	literal_frequencies[256] = 1; // End of block
+
+	// Some decoders reject codes that are not complete, so ensure there are always at least two distance codes
+	if (std::count_if(distance_frequencies, distance_frequencies + 30, [](uint32_t frequency) { return frequency != 0; }) < 2)
+		distance_frequencies[0] |= 1,
+		distance_frequencies[1] |= 1;
+
+	uint8_t literal_lengths[286], distance_lengths[30];
+	build_code_lengths(literal_frequencies, 286, 15, literal_lengths);
+	build_code_lengths(distance_frequencies, 30, 15, distance_lengths);
+
+	uint32_t num_literal_codes = 286;
+	while (num_literal_codes > 257 && literal_lengths[num_literal_codes - 1] == 0)
+		num_literal_codes--;
+	uint32_t num_distance_codes = 30;
+	while (num_distance_codes > 1 && distance_lengths[num_distance_codes - 1] == 0)
+		num_distance_codes--;
+
+	// Run-length encode the code lengths of both codes as one sequence
+	uint8_t all_lengths[286 + 30];
+	std::memcpy(all_lengths, literal_lengths, num_literal_codes);
+	std::memcpy(all_lengths + num_literal_codes, distance_lengths, num_distance_codes);
+	const uint32_t num_all_lengths = num_literal_codes + num_distance_codes;
+
+	struct code_length_symbol
+	{
+		uint8_t symbol;
+		uint8_t extra;
+	} code_length_symbols[286 + 30];
+	uint32_t num_code_length_symbols = 0;
+	uint32_t code_length_frequencies[19] = {};
+
+	const auto add_code_length_symbol = [&](uint8_t symbol, uint8_t extra) {
+		code_length_symbols[num_code_length_symbols++] = { symbol, extra };
+		code_length_frequencies[symbol]++;
+	};
+
+	for (uint32_t i = 0; i < num_all_lengths;)
+	{
+		const uint8_t length = all_lengths[i];
+		uint32_t run = 1;
+		while (i + run < num_all_lengths && all_lengths[i + run] == length)
+			run++;
+		i += run;
+
+		if (length == 0)
+		{
+			for (; run >= 11; run -= std::min(run, 138u))
+				add_code_length_symbol(18, static_cast<uint8_t>(std::min(run, 138u) - 11));
+			if (run >= 3)
+				add_code_length_symbol(17, static_cast<uint8_t>(run - 3)), run = 0;
+		}
+		else
+		{
+			add_code_length_symbol(length, 0), run--;
+			for (; run >= 3; run -= std::min(run, 6u))
+				add_code_length_symbol(16, static_cast<uint8_t>(std::min(run, 6u) - 3));
+		}
+
+		for (; run != 0; --run)
+			add_code_length_symbol(length, 0);
+	}
+
+	uint8_t code_length_lengths[19];
+	build_code_lengths(code_length_frequencies, 19, 7, code_length_lengths);
+	uint16_t code_length_codes[19] = {};
+	build_codes(code_length_lengths, 19, code_length_codes);
+
+	uint32_t num_code_length_codes = 19;
+	while (num_code_length_codes > 4 && code_length_lengths[code_length_order[num_code_length_codes - 1]] == 0)
+		num_code_length_codes--;
+
+	uint16_t literal_codes[286] = {}, distance_codes[30] = {};
+	build_codes(literal_lengths, 286, literal_codes);
+	build_codes(distance_lengths, 30, distance_codes);
+
+	// Block header (not final, compressed with dynamic Huffman codes)
+	out.put(0, 1);
+	out.put(2, 2);
+	out.put(num_literal_codes - 257, 5);
+	out.put(num_distance_codes - 1, 5);
+	out.put(num_code_length_codes - 4, 4);
+	for (uint32_t i = 0; i < num_code_length_codes; ++i)
+		out.put(code_length_lengths[code_length_order[i]], 3);
+
+	for (uint32_t i = 0; i < num_code_length_symbols; ++i)
+	{
+		const code_length_symbol &symbol = code_length_symbols[i];
+		out.put(code_length_codes[symbol.symbol], code_length_lengths[symbol.symbol]);
+
+		if (symbol.symbol == 16)
+			out.put(symbol.extra, 2);
+		else if (symbol.symbol == 17)
+			out.put(symbol.extra, 3);
+		else if (symbol.symbol == 18)
+			out.put(symbol.extra, 7);
+	}
+
+	for (size_t i = 0; i < num_tokens; ++i)
+	{
+		const token &token = tokens[i];
+
+		if (token.distance == 0)
+		{
+			out.put(literal_codes[token.literal_or_length], literal_lengths[token.literal_or_length]);
+		}
+		else
+		{
+			const uint32_t length_code = tables.length_code[token.literal_or_length - 3];
+			out.put(literal_codes[257 + length_code], literal_lengths[257 + length_code]);
+			out.put(token.literal_or_length - length_base[length_code], length_extra_bits[length_code]);
+
+			const uint32_t distance_code = tables.get_distance_code(token.distance);
+			out.put(distance_codes[distance_code], distance_lengths[distance_code]);
+			out.put(token.distance - distance_base[distance_code], distance_extra_bits[distance_code]);
+		}
+	}
+
+	out.put(literal_codes[256], literal_lengths[256]);
+}
+
+static void deflate_stripe(const uint8_t *data, size_t size, bit_writer &out)
+{
+	static const symbol_tables tables;
+
+	std::vector<int32_t> head(1 << hash_bits, -1);
+	std::vector<int32_t> prev(window_size);
+	std::vector<token> tokens;
+	tokens.reserve(max_block_tokens);
+
+	const auto hash = [data](size_t position) {
+		uint32_t value;
+		std::memcpy(&value, data + position, sizeof(value));
+		return (value * 2654435761u) >> (32 - hash_bits);
+	};
+	const auto insert = [&](size_t position) {
+		const uint32_t h = hash(position);
+		prev[position % window_size] = head[h];
+		head[h] = static_cast<int32_t>(position);
+	};
+
+	for (size_t position = 0; position < size;)
+	{
+		uint32_t best_length = 0;
+		uint32_t best_distance = 0;
+
+		if (position + min_match_length <= size)
+		{
+			const uint32_t max_length = static_cast<uint32_t>(std::min(size - position, static_cast<size_t>(max_match_length)));
+
+			int32_t candidate = head[hash(position)];
+			for (uint32_t depth = 0; candidate >= 0 && depth < max_chain_depth; ++depth)
+			{
+				const size_t distance = position - candidate;
+				if (distance > window_size)
+					break;
+
+				// Quickly reject candidates that cannot be longer than the current best match
+				if (data[candidate + best_length] == data[position + best_length])
+				{
+					uint32_t length = 0;
+					while (length < max_length && data[candidate + length] == data[position + length])
+						length++;
+
+					if (length > best_length)
+					{
+						best_length = length;
+						best_distance = static_cast<uint32_t>(distance);
+						if (length == max_length)
+							break;
+					}
+				}
+
+				// Entries in the chain may have been overwritten by newer positions, so stop once it no longer goes back in time
+				const int32_t next_candidate = prev[candidate % window_size];
+				if (next_candidate >= candidate)
+					break;
+				candidate = next_candidate;
+			}
+
+			insert(position);
+		}
+
+		if (best_length >= min_match_length)
+		{
+			tokens.push_back({ static_cast<uint16_t>(best_length), static_cast<uint16_t>(best_distance) });
+
+			for (size_t i = position + 1; i < position + best_length && i + min_match_length <= size; ++i)
+				insert(i);
+			position += best_length;
+		}
+		else
+		{
+			tokens.push_back({ data[position], 0 });
+			position += 1;
+		}
+
+		if (tokens.size() == max_block_tokens)
+		{
+			write_dynamic_block(tables, tokens.data(), tokens.size(), out);
+			tokens.clear();
+		}
+	}
+
+	if (!tokens.empty())
+		write_dynamic_block(tables, tokens.data(), tokens.size(), out);
+
+	// Finish with an empty stored block, so that the stripe ends on a byte boundary and can be followed by the next one (same as a "sync flush" in zlib)
+	out.put(0, 1);
+	out.put(0, 2);
+	out.align_to_byte();
+	out.put(0x0000, 16);
+	out.put(0xFFFF, 16);
+}
+
+static uint8_t paeth_predictor(int a, int b, int c)
+{
+	const int p = a + b - c;
+	const int pa = std::abs(p - a);
+	const int pb = std::abs(p - b);
+	const int pc = std::abs(p - c);
+	return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+static void filter_row(const uint8_t *row, const uint8_t *prev_row, size_t row_size, uint32_t bpp, uint8_t *out)
+{
+	// Choose the filter that minimizes the sum of absolute differences, which is a good heuristic for how well the row will compress
+	uint32_t costs[5] = {};
+	for (size_t i = 0; i < row_size; ++i)
+	{
+		const uint8_t a = i >= bpp ? row[i - bpp] : 0;
+		const uint8_t b = prev_row != nullptr ? prev_row[i] : 0;
+		const uint8_t c = prev_row != nullptr && i >= bpp ? prev_row[i - bpp] : 0;
+
+		costs[0] += std::abs(static_cast<int8_t>(row[i]));
+		costs[1] += std::abs(static_cast<int8_t>(row[i] - a));
+		costs[2] += std::abs(static_cast<int8_t>(row[i] - b));
+		costs[3] += std::abs(static_cast<int8_t>(row[i] - ((a + b) / 2)));
+		costs[4] += std::abs(static_cast<int8_t>(row[i] - paeth_predictor(a, b, c)));
+	}
+
+	const uint8_t filter = static_cast<uint8_t>(std::min_element(costs, costs + 5) - costs);
+
+	out[0] = filter;
+	for (size_t i = 0; i < row_size; ++i)
+	{
+		const uint8_t a = i >= bpp ? row[i - bpp] : 0;
+		const uint8_t b = prev_row != nullptr ? prev_row[i] : 0;
+		const uint8_t c = prev_row != nullptr && i >= bpp ? prev_row[i - bpp] : 0;
+
+		switch (filter)
+		{
+		case 0:
+			out[1 + i] = row[i];
+			break;
+		case 1:
+			out[1 + i] = static_cast<uint8_t>(row[i] - a);
+			break;
+		case 2:
+			out[1 + i] = static_cast<uint8_t>(row[i] - b);
+			break;
+		case 3:
+			out[1 + i] = static_cast<uint8_t>(row[i] - (a + b) / 2);
+			break;
+		case 4:
+			out[1 + i] = static_cast<uint8_t>(row[i] - paeth_predictor(a, b, c));
+			break;
+		}
+	}
+}
+
+namespace
+{
+	struct png_write_state
+	{
+		FILE *file;
+		uint32_t width;
+		uint32_t height;
+		uint32_t channels;
+		uint32_t rows_per_stripe;
+		std::vector<uint8_t> pixels;
+		std::function<void(bool success)> on_complete;
+
+		struct stripe
+		{
+			bool compressed = false;
+			uint32_t adler32 = 0;
+			size_t filtered_size = 0;
+			std::vector<uint8_t> chunk;
+		};
+
+		std::mutex mutex;
+		std::vector<stripe> stripes;
+		size_t num_stripes_compressed = 0;
+		size_t next_stripe_to_write = 0;
+		bool writing = false;
+		bool success = true;
+		uint32_t adler32 = 1;
+	};
+}
+
+static void write_completed_stripes(png_write_state &state, std::unique_lock<std::mutex> &lock)
+{
+	// Only one thread writes to the file at a time, all others just hand over their stripe and return
+	if (state.writing)
+		return;
+	state.writing = true;
+
+	while (state.next_stripe_to_write < state.stripes.size() && state.stripes[state.next_stripe_to_write].compressed)
+	{
+		png_write_state::stripe &stripe = state.stripes[state.next_stripe_to_write++];
+
+		state.adler32 = state.next_stripe_to_write == 1 ? stripe.adler32 : combine_adler32(state.adler32, stripe.adler32, stripe.filtered_size);
+
+		const std::vector<uint8_t> chunk = std::move(stripe.chunk);
+		const bool success = state.success;
+
+		lock.unlock();
+		const bool write_success = success && fwrite(chunk.data(), 1, chunk.size(), state.file) == chunk.size();
+		lock.lock();
+
+		state.success = state.success && write_success;
+	}
+
+	state.writing = false;
+
+	if (state.next_stripe_to_write != state.stripes.size())
+		return;
+
+	// Terminate the compressed data stream with an empty final block and its checksum
+	std::vector<uint8_t> trailer = { 0x03, 0x00 };
+	append_u32_be(trailer, state.adler32);
+
+	std::vector<uint8_t> end;
+	append_chunk(end, "IDAT", trailer.data(), static_cast<uint32_t>(trailer.size()));
+	append_chunk(end, "IEND", nullptr, 0);
+
+	bool success = state.success && fwrite(end.data(), 1, end.size(), state.file) == end.size();
+	if (ferror(state.file))
+		success = false;
+	fclose(state.file);
+	state.file = nullptr;
+
+	lock.unlock();
+	state.on_complete(success);
+}
+
+void reshade::write_png_async(thread_pool &pool, thread_pool::task_group &group, FILE *file, uint32_t width, uint32_t height, uint32_t channels, std::vector<uint8_t> &&pixels, std::function<void(bool success)> on_complete)
+{
+	assert(file != nullptr && (channels == 3 || channels == 4));
+
+	const size_t row_size = static_cast<size_t>(width) * channels;
+
+	if (width == 0 || height == 0 || pixels.size() < row_size * height)
+	{
+		fclose(file);
+		on_complete(false);
+		return;
+	}
+
+	const auto state = std::make_shared<png_write_state>();
+	state->file = file;
+	state->width = width;
+	state->height = height;
+	state->channels = channels;
+	state->rows_per_stripe = static_cast<uint32_t>(std::min(std::max(stripe_size / row_size, static_cast<size_t>(1)), static_cast<size_t>(height)));
+	state->pixels = std::move(pixels);
+	state->on_complete = std::move(on_complete);
+	state->stripes.resize((height + state->rows_per_stripe - 1) / state->rows_per_stripe);
+
+	std::vector<uint8_t> header = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	const uint8_t header_data[13] = {
+		static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16), static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+		static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16), static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+		8, // Bit depth
+		static_cast<uint8_t>(channels == 4 ? 6 : 2), // Color type (RGBA or RGB)
+		0, // Compression method
+		0, // Filter method
+		0, // Interlace method
+	};
+	append_chunk(header, "IHDR", header_data, sizeof(header_data));
+
+	if (fwrite(header.data(), 1, header.size(), file) != header.size())
+		state->success = false;
+
+	for (size_t stripe_index = 0; stripe_index < state->stripes.size(); ++stripe_index)
+	{
+		pool.submit(group, [state, stripe_index, row_size]() {
+			const uint32_t y_begin = static_cast<uint32_t>(stripe_index * state->rows_per_stripe);
+			const uint32_t y_end = std::min(y_begin + state->rows_per_stripe, state->height);
+
+			std::vector<uint8_t> filtered((row_size + 1) * (y_end - y_begin));
+			for (uint32_t y = y_begin; y < y_end; ++y)
+			{
+				const uint8_t *const row = state->pixels.data() + y * row_size;
+				// Filters may reference the last row of the previous stripe, since only the compression is split into independent parts
+				filter_row(row, y != 0 ? row - row_size : nullptr, row_size, state->channels, filtered.data() + (y - y_begin) * (row_size + 1));
+			}
+
+			std::vector<uint8_t> chunk(8); // Reserve space for chunk length and type
+			chunk.reserve(filtered.size() / 2);
+			{
+				bit_writer out(chunk);
+
+				// The first stripe starts the compressed data stream with its header
+				if (stripe_index == 0)
+					out.put(0x78, 8),
+					out.put(0x01, 8);
+
+				deflate_stripe(filtered.data(), filtered.size(), out);
+			}
+
+			const uint32_t chunk_size = static_cast<uint32_t>(chunk.size() - 8);
+			chunk[0] = static_cast<uint8_t>(chunk_size >> 24);
+			chunk[1] = static_cast<uint8_t>(chunk_size >> 16);
+			chunk[2] = static_cast<uint8_t>(chunk_size >> 8);
+			chunk[3] = static_cast<uint8_t>(chunk_size);
+			std::memcpy(chunk.data() + 4, "IDAT", 4);
+			append_u32_be(chunk, compute_crc32(chunk.data() + 4, 4 + chunk_size));
+
+			const uint32_t adler32 = compute_adler32(filtered.data(), filtered.size());
+
+			std::unique_lock<std::mutex> lock(state->mutex);
+
+			png_write_state::stripe &stripe = state->stripes[stripe_index];
+			stripe.compressed = true;
+			stripe.adler32 = adler32;
+			stripe.filtered_size = filtered.size();
+			stripe.chunk = std::move(chunk);
+
+			// Release the image data as soon as it is no longer needed by any stripe
+			if (++state->num_stripes_compressed == state->stripes.size())
+				std::vector<uint8_t>().swap(state->pixels);
+
+			write_completed_stripes(*state, lock);
+		});
+	}
+}
@@ -0,0 +1,29 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include "thread_pool.hpp"
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+#include <functional>
+
+namespace reshade
+{
+	/// <summary>
+	/// Encodes 8-bit RGB or RGBA image data to PNG and writes it to the specified <paramref name="file"/>.
+	/// The image is split into horizontal stripes that are filtered and compressed in parallel on the specified thread pool. Each stripe becomes a separate IDAT chunk, which is appended to the file as soon as all stripes before it were written, so that the encoded image is never held in memory in its entirety.
+	/// </summary>
+	/// <param name="pool">Thread pool to compress the stripes on.</param>
+	/// <param name="group">Task group to add the compression tasks to.</param>
+	/// <param name="file">File to write to. Ownership is transferred to the writer, which closes it once done.</param>
+	/// <param name="width">Width of the image in pixels.</param>
+	/// <param name="height">Height of the image in pixels.</param>
+	/// <param name="channels">Number of 8-bit channels per pixel, either 3 (RGB) or 4 (RGBA).</param>
+	/// <param name="pixels">Tightly packed image data, which is released as soon as all stripes were compressed.</param>
+	/// <param name="on_complete">Function that is called once the file was closed, with a value indicating whether the image was written successfully.</param>
+	void write_png_async(thread_pool &pool, thread_pool::task_group &group, FILE *file, uint32_t width, uint32_t height, uint32_t channels, std::vector<uint8_t> &&pixels, std::function<void(bool success)> on_complete);
+}
@@ -6,48 +6,90 @@
 #pragma once
 
 #include "reshade_api_device.hpp"
+#include "temp_mem_arena.hpp"
+#include <mutex>
+#include <atomic>
 #include <cassert>
+#include <cstring> // std::memcpy
+#include <algorithm> // std::all_of
+#include <iterator> // std::begin, std::end
+#include <type_traits>
 #include <unordered_map>
 
 namespace reshade::api
 {
-	template <typename T, typename... api_object_base>
-	class api_object_impl : public api_object_base...
+	/// <summary>
+	/// Assigns each GUID that is used to associate private data with API objects a small dense slot index, so that objects can store that data in an array rather than a hash map.
+	/// Only a handful of GUIDs are ever used (usually one per data type of each add-on), so finding the slot of a GUID is a short linear search that does not take any locks.
+	/// </summary>
+	class private_data_slots
 	{
-		static_assert(sizeof(T) <= sizeof(uint64_t));
-
 		struct guid_t
 		{
-			struct hash
-			{
-				auto operator()(const guid_t &key) const -> size_t
-				{
-#ifndef _WIN64
-					return key.a ^ key.b ^ ((key.c & 0xFF00) | (key.d & 0xFF));
-#else
-					return key.a ^ (key.b << 1);
-#endif
-				}
-			};
-			struct equal
-			{
-				bool operator()(const guid_t &lhs, const guid_t &rhs) const
-				{
-#ifndef _WIN64
-					return lhs.a == rhs.a && lhs.b == rhs.b && lhs.c == rhs.c && lhs.d == rhs.d;
-#else
-					return lhs.a == rhs.a && lhs.b == rhs.b;
-#endif
-				}
-			};
-
-#ifndef _WIN64
-			uint32_t a, b, c, d;
-#else
 			uint64_t a, b;
-#endif
 		};
 
+	public:
+		static constexpr uint32_t invalid_slot = UINT32_MAX;
+
+		/// <summary>
+		/// Finds the slot that was previously registered for the specified <paramref name="guid"/>.
+		/// </summary>
+		/// <returns>The slot index, or <see cref="invalid_slot"/> if no data was ever set with this GUID.</returns>
+		static uint32_t find(const uint8_t guid[16])
+		{
+			guid_t key;
+			std::memcpy(&key, guid, sizeof(key));
+
+			for (uint32_t slot = 0, count = s_count.load(std::memory_order_acquire); slot < count; ++slot)
+				if (s_guids[slot].a == key.a && s_guids[slot].b == key.b)
+					return slot;
+
+			return invalid_slot;
+		}
+
+		/// <summary>
+		/// Finds the slot for the specified <paramref name="guid"/>, or registers a new one if none exists yet.
+		/// </summary>
+		static uint32_t find_or_register(const uint8_t guid[16])
+		{
+			if (const uint32_t slot = find(guid);
+				slot != invalid_slot)
+				return slot;
+
+			const std::unique_lock<std::mutex> lock(s_mutex);
+
+			// Another thread may have registered this GUID in the meantime
+			if (const uint32_t slot = find(guid);
+				slot != invalid_slot)
+				return slot;
+
+			const uint32_t slot = s_count.load(std::memory_order_relaxed);
+			if (slot == max_slots)
+				return assert(false), invalid_slot;
+
+			std::memcpy(&s_guids[slot], guid, sizeof(guid_t));
+			s_count.store(slot + 1, std::memory_order_release);
+
+			return slot;
+		}
+
+	private:
+		static constexpr uint32_t max_slots = 4096;
+
+		static inline std::mutex s_mutex;
+		static inline std::atomic<uint32_t> s_count = 0;
+		static inline guid_t s_guids[max_slots] = {};
+	};
+
+	template <typename T, typename... api_object_base>
+	class api_object_impl : public api_object_base...
+	{
+		static_assert(sizeof(T) <= sizeof(uint64_t));
+
+		// Number of private data slots stored directly in the object, which covers all but the most extensive add-on setups
+		static constexpr uint32_t inline_private_data_slots = 8;
+
 	public:
 		api_object_impl(const api_object_impl &) = delete;
 		api_object_impl &operator=(const api_object_impl &) = delete;
@@ -56,24 +98,39 @@ namespace reshade::api
 		{
 			assert(data != nullptr);
 
-			if (_private_data.empty()) // Early-out to avoid crash when this is called after the object was destroyed
+			const uint32_t slot = private_data_slots::find(guid);
+
+			if (slot < inline_private_data_slots)
+			{
+				*data = _private_data[slot];
+				return;
+			}
+
+			if (slot == private_data_slots::invalid_slot || _private_data_overflow.empty())
 			{
 				*data = 0;
 				return;
 			}
 
-			if (const auto it = _private_data.find(*reinterpret_cast<const guid_t *>(guid));
-				it != _private_data.end())
+			if (const auto it = _private_data_overflow.find(slot);
+				it != _private_data_overflow.end())
 				*data = it->second;
 			else
 				*data = 0;
 		}
 		void set_private_data(const uint8_t guid[16], const uint64_t data)  final
 		{
-			if (data != 0)
-				_private_data[*reinterpret_cast<const guid_t *>(guid)] = data;
+			// Only register a slot when there is actually data to store
+			const uint32_t slot = (data != 0) ? private_data_slots::find_or_register(guid) : private_data_slots::find(guid);
+			if (slot == private_data_slots::invalid_slot)
+				return;
+
+			if (slot < inline_private_data_slots)
+				_private_data[slot] = data;
+			else if (data != 0)
+				_private_data_overflow[slot] = data;
 			else
-				_private_data.erase(*reinterpret_cast<const guid_t *>(guid));
+				_private_data_overflow.erase(slot);
 		}
 
 		uint64_t get_native() const final { return (uint64_t)_orig; }
@@ -86,27 +143,46 @@ namespace reshade::api
 		~api_object_impl()
 		{
 			// All user data should ideally have been removed before destruction, to avoid leaks
-			assert(_private_data.empty());
+			assert(std::all_of(std::begin(_private_data), std::end(_private_data), [](uint64_t data) { return data == 0; }) && _private_data_overflow.empty());
 		}
 
 	private:
-		std::unordered_map<guid_t, uint64_t, typename guid_t::hash, typename guid_t::equal> _private_data;
+		uint64_t _private_data[inline_private_data_slots] = {};
+		std::unordered_map<uint32_t, uint64_t> _private_data_overflow;
 	};
 }
 
 template <typename T, size_t STACK_ELEMENTS = 16>
 struct temp_mem
 {
+	// Memory from the arena is reused without running destructors, which is only valid for plain data
+	static_assert(std::is_trivially_destructible_v<T>);
+
 	explicit temp_mem(size_t elements = STACK_ELEMENTS) : p(stack)
 	{
 		if (elements > STACK_ELEMENTS)
+		{
+			if (elements <= SIZE_MAX / sizeof(T))
+			{
+				if (void *const arena_mem = reshade::temp_mem_arena::allocate(elements * sizeof(T), alignof(T), arena_mark))
+				{
+					p = static_cast<T *>(arena_mem);
+					for (size_t i = 0; i < elements; ++i)
+						new (p + i) T;
+					return;
+				}
+			}
+
 			p = new T[elements];
+		}
 	}
 	temp_mem(const temp_mem &) = delete;
 	temp_mem(temp_mem &&) = delete;
 	~temp_mem()
 	{
-		if (p != stack)
+		if (arena_mark != SIZE_MAX)
+			reshade::temp_mem_arena::release(arena_mark);
+		else if (p != stack)
 			delete[] p;
 	}
 
@@ -121,4 +197,7 @@ struct temp_mem
 	}
 
 	T *p, stack[STACK_ELEMENTS];
+
+private:
+	size_t arena_mark = SIZE_MAX;
 };
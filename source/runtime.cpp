@@ -8,6 +8,7 @@
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
+#include "effect_cache_archive.hpp"
 #include "version.h"
 #include "dll_log.hpp"
 #include "dll_resources.hpp"
@@ -18,6 +19,8 @@
 #include "com_ptr.hpp"
 #include "platform_utils.hpp"
 #include "reshade_api_object_impl.hpp"
+#include "format_conversion.hpp"
+#include "png_writer.hpp"
 #include <set>
 #include <thread>
 #include <cmath> // std::abs, std::fmod
@@ -36,6 +39,9 @@
 #include <d3dcompiler.h>
 #include <sk_hdr_png.hpp>
 
+// Maximum number of screenshots that can be in the process of being saved at the same time, before taking another one blocks until one of them finished
+static constexpr unsigned int max_pending_screenshot_saves = 4;
+
 bool resolve_path(std::filesystem::path &path, std::error_code &ec)
 {
 	// First convert path to an absolute path
@@ -173,6 +179,89 @@ static std::vector<std::filesystem::path> find_files(const std::vector<std::file
 	return files;
 }
 
+static size_t hash_file_contents(const std::filesystem::path &path)
+{
+	FILE *const file = _wfsopen(path.c_str(), L"rb", SH_DENYNO);
+	if (file == nullptr)
+		return 0;
+
+	fseek(file, 0, SEEK_END);
+	const size_t file_size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	std::string data(file_size, '\0');
+	const size_t file_size_read = fread(data.data(), 1, data.size(), file);
+	fclose(file);
+	data.resize(file_size_read);
+
+	return std::hash<std::string>()(data);
+}
+static void append_dependency_attributes(std::string &attributes, const std::string &dependencies)
+{
+	// Dependency list contains one UTF-8 file path per line, with paths that did not exist prefixed with a '?'
+	// Those are hashed the same way, which yields zero while they do not exist, so that the attributes change as soon as one is created
+	for (size_t offset = 0, next; offset < dependencies.size(); offset = next + 1)
+	{
+		next = dependencies.find('\n', offset);
+		if (next == std::string::npos)
+			next = dependencies.size();
+		if (next == offset)
+			continue;
+
+		const std::string line = dependencies.substr(offset, next - offset);
+
+		attributes += line;
+		attributes += '?';
+		attributes += std::to_string(hash_file_contents(std::filesystem::u8path(line[0] == '?' ? line.substr(1) : line)));
+		attributes += ';';
+	}
+}
+
+static bool is_transient_texture(const reshadefx::effect_module &module, const reshade::texture &tex)
+{
+	// Textures loaded from an image file or referencing a runtime resource have to keep their contents
+	if (!tex.semantic.empty() || !tex.render_target || tex.annotation_as_int("pooled") || !tex.annotation_as_string("source").empty())
+		return false;
+
+	const bool declared_transient = tex.annotation_as_int("transient") != 0;
+
+	const reshadefx::technique *owning_technique = nullptr;
+
+	for (const reshadefx::technique &tech : module.techniques)
+	{
+		for (const reshadefx::pass &pass : tech.passes)
+		{
+			const bool read = std::any_of(pass.texture_bindings.cbegin(), pass.texture_bindings.cend(),
+					[&module, &tex](const reshadefx::texture_binding &binding) { return module.samplers[binding.index].texture_name == tex.unique_name; }) ||
+				std::any_of(pass.storage_bindings.cbegin(), pass.storage_bindings.cend(),
+					[&module, &tex](const reshadefx::storage_binding &binding) { return module.storages[binding.index].texture_name == tex.unique_name; });
+			const bool written = std::find(std::begin(pass.render_target_names), std::end(pass.render_target_names), tex.unique_name) != std::end(pass.render_target_names);
+
+			if (!read && !written)
+				continue;
+
+			// Texture may be used to pass data between techniques
+			if (owning_technique != nullptr && owning_technique != &tech)
+				return false;
+			if (owning_technique != nullptr)
+				continue;
+
+			owning_technique = &tech;
+
+			// The first pass using the texture has to overwrite it entirely
+			// This can only be guaranteed by clearing it, since even a full-screen triangle may discard pixels or have its coverage limited by the vertex shader, unless the effect explicitly declared that the texture does not need to keep its contents
+			if (read || !written)
+				return false;
+			if (!pass.clear_render_targets && !declared_transient)
+				return false;
+			if (tex.levels > 1 && !pass.generate_mipmaps)
+				return false;
+		}
+	}
+
+	return owning_technique != nullptr;
+}
+
 reshade::runtime::runtime(api::swapchain *swapchain, api::command_queue *graphics_queue, const std::filesystem::path &config_path, bool is_vr) :
 	_swapchain(swapchain),
 	_device(swapchain->get_device()),
@@ -181,6 +270,12 @@ reshade::runtime::runtime(api::swapchain *swapchain, api::command_queue *graphic
 	_start_time(std::chrono::high_resolution_clock::now()),
 	_last_present_time(_start_time),
 	_last_frame_duration(std::chrono::milliseconds(1)),
+#ifndef _WIN64
+	// Limit number of threads in 32-bit due to the limited about of address space being available there and compilation being memory hungry
+	_worker_threads(std::min(std::max(std::thread::hardware_concurrency(), 2u) - 1, 4u)),
+#else
+	_worker_threads(std::max(std::thread::hardware_concurrency(), 2u) - 1),
+#endif
 	_effect_search_paths({ L".\\" }),
 	_texture_search_paths({ L".\\" }),
 	_config_path(config_path),
@@ -240,7 +335,7 @@ reshade::runtime::runtime(api::swapchain *swapchain, api::command_queue *graphic
 }
 reshade::runtime::~runtime()
 {
-	assert(_worker_threads.empty());
+	assert(_load_tasks.empty() && _save_tasks.empty());
 	assert(!_is_initialized && _techniques.empty() && _technique_sorting.empty());
 
 #if RESHADE_GUI
@@ -519,6 +614,11 @@ void reshade::runtime::on_reset()
 	// Already performs a wait for idle, so no need to do it again before destroying resources below
 	destroy_effects();
 
+	// Finish any pending screenshot or texture captures and make sure none are still being saved, since those access runtime state
+	update_texture_readbacks(true);
+	destroy_texture_readbacks();
+	_worker_threads.wait(_save_tasks);
+
 	_device->destroy_resource(_empty_tex);
 	_empty_tex = {};
 	_device->destroy_resource_view(_empty_srv);
@@ -614,6 +714,9 @@ void reshade::runtime::on_present()
 
 	_current_time = std::chrono::system_clock::now();
 
+	// Hand off captures from previous frames whose copies finished to the worker threads for saving
+	update_texture_readbacks();
+
 	if (_should_save_screenshot && _screenshot_save_before && _effects_enabled && !_effects_rendered_this_frame)
 		save_screenshot("Before");
 
@@ -900,6 +1003,8 @@ void reshade::runtime::load_config()
 	config_get("GENERAL", "NoDebugInfo", _no_debug_info);
 	config_get("GENERAL", "NoEffectCache", _no_effect_cache);
 	config_get("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config_get("GENERAL", "EffectCreationBudget", _effect_creation_budget);
+	config_get("GENERAL", "PackedEffectCache", _packed_effect_cache);
 
 	config_get("GENERAL", "EffectSearchPaths", _effect_search_paths);
 	config_get("GENERAL", "PerformanceMode", _performance_mode);
@@ -979,6 +1084,8 @@ void reshade::runtime::save_config() const
 	config.set("GENERAL", "NoDebugInfo", _no_debug_info);
 	config.set("GENERAL", "NoEffectCache", _no_effect_cache);
 	config.set("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config.set("GENERAL", "EffectCreationBudget", _effect_creation_budget);
+	config.set("GENERAL", "PackedEffectCache", _packed_effect_cache);
 
 	config.set("GENERAL", "EffectSearchPaths", _effect_search_paths);
 	config.set("GENERAL", "PerformanceMode", _performance_mode);
@@ -1441,52 +1548,30 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 	for (const std::pair<std::string, std::string> &definition : preprocessor_definitions)
 		attributes += definition.first + '=' + definition.second + ';';
 
-	std::error_code ec;
-	std::set<std::filesystem::path> include_paths;
-	if (source_file.is_absolute())
-		include_paths.emplace(source_file.parent_path());
-	for (std::filesystem::path include_path : _effect_search_paths)
-	{
-		const bool recursive_search = include_path.filename() == L"**";
-		if (recursive_search)
-			include_path.remove_filename();
-
-		if (resolve_path(include_path, ec))
-		{
-			include_paths.emplace(include_path);
-
-			if (recursive_search)
-			{
-				for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(include_path, std::filesystem::directory_options::skip_permission_denied, ec))
-					if (entry.is_directory(ec))
-						include_paths.emplace(entry);
-			}
-		}
-	}
+	// Search paths are only resolved when preprocessing below, but changing them may change which files are included, so add them to the attributes as well
+	for (const std::filesystem::path &include_path : _effect_search_paths)
+		attributes += include_path.u8string() + ';';
 
+	// Identify files by a hash of their contents rather than their modification time, so that touching a file without changing it does not invalidate the cache
 	attributes += effect_name;
 	attributes += '?';
-	attributes += std::to_string(std::filesystem::last_write_time(source_file, ec).time_since_epoch().count());
+	attributes += std::to_string(hash_file_contents(source_file));
 	attributes += ';';
 
-	// The actual included files are not known at this point, so detect changes to any ".fxh" files in the search paths
-	for (const std::filesystem::path &include_path : include_paths)
-	{
-		for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(include_path, std::filesystem::directory_options::skip_permission_denied, ec))
-		{
-			if (entry.path().extension() == L".fxh")
-			{
-				attributes += entry.path().filename().u8string();
-				attributes += '?';
-				attributes += std::to_string(entry.last_write_time(ec).time_since_epoch().count());
-				attributes += ';';
-			}
-		}
-	}
+	const std::string cache_id_prefix = source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-';
+
+	// The actual included files are not known at this point, so use the list that was recorded the last time this effect was preprocessed with the same attributes
+	// This way only effects whose included files changed are invalidated, rather than all effects whenever any header in the search paths changes
+	const std::string dependencies_cache_id = cache_id_prefix + std::to_string(std::hash<std::string>()(attributes));
+
+	std::string dependencies;
+	std::string dependency_attributes = attributes;
+	if (load_effect_cache(dependencies_cache_id, "dep", dependencies))
+		append_dependency_attributes(dependency_attributes, dependencies);
 
 	effect &effect = _effects[effect_index];
 
-	const size_t source_hash = std::hash<std::string>()(attributes);
+	size_t source_hash = std::hash<std::string>()(dependency_attributes);
 	if (permutation_index == 0 && (source_file != effect.source_file || source_hash != effect.source_hash))
 	{
 		if (effect.created)
@@ -1538,8 +1623,31 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 	std::string source;
 	std::string errors;
 
-	if (!preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(source_hash), "i", source)) == false))
+	if (!preprocessed && (preprocess_required || (source_cached = load_effect_cache(cache_id_prefix + std::to_string(source_hash), "i", source)) == false))
 	{
+		std::error_code ec;
+		std::set<std::filesystem::path> include_paths;
+		if (source_file.is_absolute())
+			include_paths.emplace(source_file.parent_path());
+		for (std::filesystem::path include_path : _effect_search_paths)
+		{
+			const bool recursive_search = include_path.filename() == L"**";
+			if (recursive_search)
+				include_path.remove_filename();
+
+			if (resolve_path(include_path, ec))
+			{
+				include_paths.emplace(include_path);
+
+				if (recursive_search)
+				{
+					for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(include_path, std::filesystem::directory_options::skip_permission_denied, ec))
+						if (entry.is_directory(ec))
+							include_paths.emplace(entry);
+				}
+			}
+		}
+
 		reshadefx::preprocessor pp;
 		pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
 		pp.add_macro_definition("__RESHADE_PERMUTATION__", permutation_index != 0 ? "1" : "0");
@@ -1586,10 +1694,37 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		// Append preprocessor errors to the error list
 		errors += pp.errors();
 
+		// Keep track of included files
+		std::vector<std::filesystem::path> included_files = pp.included_files();
+		std::sort(included_files.begin(), included_files.end()); // Sort file names alphabetically
+
 		if (preprocessed)
 		{
 			source = pp.output();
 
+			// Record the included files, so that the next load can detect changes to exactly those files
+			std::string new_dependencies;
+			for (const std::filesystem::path &included_file : included_files)
+				new_dependencies += included_file.u8string() + '\n';
+
+			// Also record the paths that were searched before an included file was found, so that adding a file that would shadow it invalidates the cache as well
+			std::vector<std::filesystem::path> missing_files = pp.missing_files();
+			std::sort(missing_files.begin(), missing_files.end());
+
+			for (const std::filesystem::path &missing_file : missing_files)
+				new_dependencies += '?' + missing_file.u8string() + '\n';
+
+			if (new_dependencies != dependencies && save_effect_cache(dependencies_cache_id, "dep", new_dependencies))
+			{
+				dependency_attributes = attributes;
+				append_dependency_attributes(dependency_attributes, new_dependencies);
+
+				// Update hash to match what the next load will compute from the recorded dependency list
+				source_hash = std::hash<std::string>()(dependency_attributes);
+				if (permutation_index == 0)
+					effect.source_hash = source_hash;
+			}
+
 			for (const std::pair<std::string, std::string> &pragma : pp.used_pragma_directives())
 			{
 				if (pragma.first == "reshade")
@@ -1625,24 +1760,32 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 
 			// Do not cache if any special pragma directives were used, to ensure they are read again next time
 			if (!skip_optimization)
-				source_cached = save_effect_cache(source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(source_hash), "i", source);
+				source_cached = save_effect_cache(cache_id_prefix + std::to_string(source_hash), "i", source);
 		}
 
 		if (permutation_index == 0)
 		{
 			effect.definitions = std::move(preprocessor_definitions);
 
-			// Keep track of included files
-			effect.included_files = pp.included_files();
-			std::sort(effect.included_files.begin(), effect.included_files.end()); // Sort file names alphabetically
+			effect.included_files = std::move(included_files);
 
 			effect.preprocessed = preprocessed;
+
+			effect.statistics.preprocess_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(pp.stats().duration).count();
+			effect.statistics.num_preprocessed_tokens = pp.stats().num_tokens;
+			effect.statistics.num_macro_expansions = pp.stats().num_macro_expansions;
 		}
 	}
 	else
 	{
 		if (permutation_index == 0 && !source.empty())
 		{
+			// Restore list of included files from the recorded dependencies
+			effect.included_files.clear();
+			for (size_t offset = 0, next; (next = dependencies.find('\n', offset)) != std::string::npos; offset = next + 1)
+				if (dependencies[offset] != '?') // Skip paths that did not exist
+					effect.included_files.push_back(std::filesystem::u8path(dependencies.substr(offset, next - offset)));
+
 			effect.definitions.clear();
 
 			// Read used preprocessor definitions and pragmas from the cached source
@@ -1702,17 +1845,29 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 
 		// Write result to effect module
 		permutation.module = codegen->module();
+
+		const auto codegen_start = std::chrono::high_resolution_clock::now();
 		if (_device->get_api() != api::device_api::vulkan)
 			permutation.generated_code = codegen->finalize_code();
 
+		if (permutation_index == 0)
+		{
+			effect.statistics.parse_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(parser.stats().duration).count();
+			effect.statistics.codegen_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - codegen_start).count();
+			effect.statistics.num_parsed_tokens = parser.stats().num_tokens;
+			effect.statistics.num_instructions = codegen->num_instructions();
+		}
+
 		if (compiled)
 		{
 			if (permutation_index == 0)
 			{
 				effect.uniforms.clear();
+				effect.special_uniform_updates.clear();
 
 				// Create space for all variables (aligned to 16 bytes)
 				effect.uniform_data_storage.resize((permutation.module.total_uniform_size + 15) & ~15);
+				effect.mark_uniform_data_dirty(0, effect.uniform_data_storage.size());
 
 				for (uniform variable : permutation.module.uniforms)
 				{
@@ -1759,6 +1914,59 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 
 					effect.uniforms.push_back(std::move(variable));
 				}
+
+				// Compile list of special uniform variables that need to be updated every frame
+				for (size_t uniform_index = 0; uniform_index < effect.uniforms.size(); ++uniform_index)
+				{
+					const uniform &variable = effect.uniforms[uniform_index];
+
+					effect::special_uniform_update update;
+					update.special = variable.special;
+					update.uniform_index = uniform_index;
+
+					switch (variable.special)
+					{
+					case special_uniform::none:
+					case special_uniform::unknown:
+#if !RESHADE_GUI
+					case special_uniform::overlay_open:
+					case special_uniform::overlay_active:
+					case special_uniform::overlay_hovered:
+#endif
+						continue;
+					case special_uniform::random:
+						update.int_range[0] = variable.annotation_as_int("min", 0, 0);
+						update.int_range[1] = variable.annotation_as_int("max", 0, RAND_MAX);
+						break;
+					case special_uniform::ping_pong:
+						update.float_range[0] = variable.annotation_as_float("min", 0, 0.0f);
+						update.float_range[1] = variable.annotation_as_float("max", 0, 1.0f);
+						update.step[0] = variable.annotation_as_float("step", 0);
+						update.step[1] = variable.annotation_as_float("step", 1);
+						update.smoothing = variable.annotation_as_float("smoothing");
+						break;
+					case special_uniform::key:
+					case special_uniform::mouse_button:
+						update.keycode = variable.annotation_as_int("keycode");
+						if (variable.special == special_uniform::key ? (update.keycode <= 7 || update.keycode >= 256) : (update.keycode < 0 || update.keycode >= 5))
+							continue; // Ignore variables with an invalid key code, since they are never updated
+						if (const std::string_view mode = variable.annotation_as_string("mode");
+							mode == "toggle" || variable.annotation_as_int("toggle"))
+							update.mode = effect::special_uniform_update::input_mode::toggle;
+						else if (mode == "press")
+							update.mode = effect::special_uniform_update::input_mode::press;
+						break;
+					case special_uniform::mouse_wheel:
+						update.float_range[0] = variable.annotation_as_float("min");
+						update.float_range[1] = variable.annotation_as_float("max");
+						update.step[0] = variable.annotation_as_float("step");
+						if (update.step[0] == 0.0f)
+							update.step[0] = 1.0f;
+						break;
+					}
+
+					effect.special_uniform_updates.push_back(update);
+				}
 			}
 			else
 			{
@@ -2126,6 +2334,7 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		for (texture new_texture : permutation.module.textures)
 		{
 			new_texture.effect_index = effect_index;
+			new_texture.transient = is_transient_texture(permutation.module, new_texture);
 
 			if (!new_texture.semantic.empty() && (new_texture.render_target || new_texture.storage_access))
 			{
@@ -2187,6 +2396,10 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 				if (std::find(existing_texture->shared.begin(), existing_texture->shared.end(), effect_index) == existing_texture->shared.end())
 					existing_texture->shared.push_back(effect_index);
 
+				// Contents of a texture shared with another effect may be used to pass data between effects, so need to persist
+				if (existing_texture->effect_index != new_texture.effect_index || !new_texture.transient)
+					existing_texture->transient = false;
+
 				// Update render target and storage access flags of the existing shared texture, in case they are used as such in this effect
 				existing_texture->render_target |= new_texture.render_target;
 				existing_texture->storage_access |= new_texture.storage_access;
@@ -2279,6 +2492,13 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 
 	const std::chrono::high_resolution_clock::time_point time_load_finished = std::chrono::high_resolution_clock::now();
 
+	// Remember how long loading took, so that this effect can be scheduled accordingly the next time
+	if (permutation_index == 0)
+	{
+		const std::unique_lock<std::shared_mutex> lock(_reload_mutex);
+		_last_load_durations[source_file] = time_load_finished - time_load_started;
+	}
+
 	if (_reload_remaining_effects != std::numeric_limits<size_t>::max())
 	{
 		assert(_reload_remaining_effects != 0);
@@ -2325,10 +2545,11 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 		if (tex.resource != 0)
 		{
 			if (!(tex.render_target && tex.rtv[0] == 0) &&
-				!(tex.storage_access && tex.uav.empty()))
+				!(tex.storage_access && tex.uav.empty()) &&
+				!(!tex.transient && is_texture_aliased(tex)))
 				continue;
 
-			// Update texture if usage has changed since it was last created (e.g. because a pooled texture is now used with storage access when it was not before)
+			// Update texture if usage has changed since it was last created (e.g. because a pooled texture is now used with storage access when it was not before, or a transient texture is now shared with another effect and can no longer alias memory with other textures)
 			destroy_texture(tex);
 
 			// This also requires the descriptors to be updated in all effects referencing this texture, so simply recreate them
@@ -2487,6 +2708,9 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 			}
 
 			_device->set_resource_name(effect.cb, "ReShade constant buffer");
+
+			// Newly created constant buffer has undefined contents, so needs a full upload
+			effect.mark_uniform_data_dirty(0, effect.uniform_data_storage.size());
 		}
 		else
 		{
@@ -2534,6 +2758,29 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 		}
 	}
 
+	// Pipeline descriptions are collected first and only turned into pipelines after all passes were initialized, so that this can happen in parallel
+	struct pipeline_desc
+	{
+		const technique *tech = nullptr;
+		size_t pass_index = 0;
+		technique::pass *pass = nullptr;
+		bool succeeded = false;
+
+		api::shader_desc cs_desc = {};
+		api::shader_desc vs_desc = {};
+		api::shader_desc ps_desc = {};
+		api::format render_target_formats[8] = {};
+		api::primitive_topology topology = api::primitive_topology::undefined;
+		api::blend_desc blend_state = {};
+		api::rasterizer_desc rasterizer_state = {};
+		api::depth_stencil_desc depth_stencil_state = {};
+		std::vector<api::pipeline_subobject> subobjects;
+	};
+
+	// Reserve space up front, since the subobjects reference the descriptions by pointer
+	std::vector<pipeline_desc> pipeline_descs;
+	pipeline_descs.reserve(total_pass_count);
+
 	// Initialize techniques and passes
 	for (size_t tech_index = 0, pass_index_in_effect = 0, query_base_index = 0; tech_index < _techniques.size(); ++tech_index)
 	{
@@ -2557,11 +2804,17 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 			pass.texture_table = shader_resource_view_tables[pass_index_in_effect];
 			pass.storage_table = unordered_access_view_tables[pass_index_in_effect];
 
-			std::vector<api::pipeline_subobject> subobjects;
+			assert(pipeline_descs.size() < pipeline_descs.capacity());
+			pipeline_desc &pass_pipeline_desc = pipeline_descs.emplace_back();
+			pass_pipeline_desc.tech = &tech;
+			pass_pipeline_desc.pass_index = pass_index;
+			pass_pipeline_desc.pass = &pass;
+
+			std::vector<api::pipeline_subobject> &subobjects = pass_pipeline_desc.subobjects;
 
 			if (!pass.cs_entry_point.empty())
 			{
-				api::shader_desc cs_desc = {};
+				api::shader_desc &cs_desc = pass_pipeline_desc.cs_desc;
 				const std::string &cs = permutation.assembly.at(pass.cs_entry_point);
 				cs_desc.code = cs.data();
 				cs_desc.code_size = cs.size();
@@ -2574,18 +2827,10 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 				}
 
 				subobjects.push_back({ api::pipeline_subobject_type::compute_shader, 1, &cs_desc });
-
-				if (!_device->create_pipeline(permutation.layout, static_cast<uint32_t>(subobjects.size()), subobjects.data(), &pass.pipeline))
-				{
-					effect.errors += "error: internal compiler error";
-
-					log::message(log::level::error, "Failed to create compute pipeline for pass %zu in technique '%s' in '%s'!", pass_index, tech.name.c_str(), effect.source_file.u8string().c_str());
-					return false;
-				}
 			}
 			else
 			{
-				api::shader_desc vs_desc = {};
+				api::shader_desc &vs_desc = pass_pipeline_desc.vs_desc;
 				if (!pass.vs_entry_point.empty())
 				{
 					const std::string &vs = permutation.assembly.at(pass.vs_entry_point);
@@ -2602,7 +2847,7 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 					subobjects.push_back({ api::pipeline_subobject_type::vertex_shader, 1, &vs_desc });
 				}
 
-				api::shader_desc ps_desc = {};
+				api::shader_desc &ps_desc = pass_pipeline_desc.ps_desc;
 				if (!pass.ps_entry_point.empty())
 				{
 					const std::string &ps = permutation.assembly.at(pass.ps_entry_point);
@@ -2619,7 +2864,7 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 					subobjects.push_back({ api::pipeline_subobject_type::pixel_shader, 1, &ps_desc });
 				}
 
-				api::format render_target_formats[8] = {};
+				api::format *const render_target_formats = pass_pipeline_desc.render_target_formats;
 				if (pass.render_target_names[0].empty())
 				{
 					pass.viewport_width = _effect_permutations[permutation_index].width;
@@ -2670,8 +2915,8 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 
 				subobjects.push_back({ api::pipeline_subobject_type::max_vertex_count, 1, &pass.num_vertices });
 
-				api::primitive_topology topology = static_cast<api::primitive_topology>(pass.topology);
-				subobjects.push_back({ api::pipeline_subobject_type::primitive_topology, 1, &topology });
+				pass_pipeline_desc.topology = static_cast<api::primitive_topology>(pass.topology);
+				subobjects.push_back({ api::pipeline_subobject_type::primitive_topology, 1, &pass_pipeline_desc.topology });
 
 				const auto convert_blend_op = [](reshadefx::blend_op value) {
 					switch (value)
@@ -2701,7 +2946,7 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 				};
 
 				// Technically should check for 'api::device_caps::independent_blend' support, but render target write masks are supported in D3D9, when rest is not, so just always set ...
-				api::blend_desc blend_state = {};
+				api::blend_desc &blend_state = pass_pipeline_desc.blend_state;
 				for (int i = 0; i < 8; ++i)
 				{
 					blend_state.blend_enable[i] = pass.blend_enable[i];
@@ -2716,7 +2961,7 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 
 				subobjects.push_back({ api::pipeline_subobject_type::blend_state, 1, &blend_state });
 
-				api::rasterizer_desc rasterizer_state = {};
+				api::rasterizer_desc &rasterizer_state = pass_pipeline_desc.rasterizer_state;
 				rasterizer_state.cull_mode = api::cull_mode::none;
 
 				subobjects.push_back({ api::pipeline_subobject_type::rasterizer_state, 1, &rasterizer_state });
@@ -2749,7 +2994,7 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 					}
 				};
 
-				api::depth_stencil_desc depth_stencil_state = {};
+				api::depth_stencil_desc &depth_stencil_state = pass_pipeline_desc.depth_stencil_state;
 				depth_stencil_state.depth_enable = false;
 				depth_stencil_state.depth_write_mask = false;
 				depth_stencil_state.depth_func = api::compare_op::always;
@@ -2768,14 +3013,6 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 				depth_stencil_state.back_stencil_pass_op = depth_stencil_state.front_stencil_pass_op;
 
 				subobjects.push_back({ api::pipeline_subobject_type::depth_stencil_state, 1, &depth_stencil_state });
-
-				if (!_device->create_pipeline(permutation.layout, static_cast<uint32_t>(subobjects.size()), subobjects.data(), &pass.pipeline))
-				{
-					effect.errors += "error: internal compiler error";
-
-					log::message(log::level::error, "Failed to create graphics pipeline for pass %zu in technique '%s' in '%s'!", pass_index, tech.name.c_str(), effect.source_file.u8string().c_str());
-					return false;
-				}
 			}
 
 			for (const reshadefx::sampler_binding &binding : pass.sampler_bindings)
@@ -2869,7 +3106,8 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 				if (!sampler_texture->semantic.empty())
 				{
 					if (sampler_texture->semantic == "COLOR")
-						srv = _effect_permutations[permutation_index].color_srv[binding.srgb];
+						srv = _effect_permutations[permutation_index].color_srv[binding.srgb],
+						pass.samples_back_buffer = true;
 					else if (const auto it = _texture_semantic_bindings.find(sampler_texture->semantic); it != _texture_semantic_bindings.end())
 						srv = binding.srgb ? it->second.second : it->second.first;
 					else
@@ -2925,6 +3163,36 @@ bool reshade::runtime::create_effect(size_t effect_index, size_t permutation_ind
 		tech.permutations[permutation_index].created = true;
 	}
 
+	// Pipeline creation is the most expensive part of effect creation, so spread it across worker threads where the device allows creating objects concurrently
+	const bool create_pipelines_in_parallel = pipeline_descs.size() > 1 && (_device->get_api() == api::device_api::d3d12 || _device->get_api() == api::device_api::vulkan);
+
+	for (pipeline_desc &desc : pipeline_descs)
+	{
+		const auto create_pipeline = [this, layout = permutation.layout, &desc]() {
+			desc.succeeded = _device->create_pipeline(layout, static_cast<uint32_t>(desc.subobjects.size()), desc.subobjects.data(), &desc.pass->pipeline);
+		};
+
+		if (create_pipelines_in_parallel)
+			_worker_threads.submit(_create_tasks, create_pipeline);
+		else
+			create_pipeline();
+	}
+
+	// Worker threads may be busy saving screenshots or compiling effects, so help out with creating the pipelines rather than waiting for them to get to it
+	if (create_pipelines_in_parallel)
+		_worker_threads.wait_and_execute(_create_tasks);
+
+	for (const pipeline_desc &desc : pipeline_descs)
+	{
+		if (!desc.succeeded)
+		{
+			effect.errors += "error: internal compiler error";
+
+			log::message(log::level::error, "Failed to create %s pipeline for pass %zu in technique '%s' in '%s'!", desc.pass->cs_entry_point.empty() ? "graphics" : "compute", desc.pass_index, desc.tech->name.c_str(), effect.source_file.u8string().c_str());
+			return false;
+		}
+	}
+
 	if (!descriptor_writes.empty())
 		_device->update_descriptor_tables(static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data());
 
@@ -3223,6 +3491,31 @@ bool reshade::runtime::create_texture(texture &tex)
 	if (!tex.semantic.empty())
 		return true;
 
+	// Transient textures whose lifetimes cannot overlap can share the same resource
+	if (tex.transient)
+	{
+		for (const texture &other_tex : _textures)
+		{
+			if (&other_tex == &tex || !other_tex.transient || other_tex.resource == 0 || !other_tex.matches_description(tex) || other_tex.render_target != tex.render_target || other_tex.storage_access != tex.storage_access)
+				continue;
+
+			// Lifetimes may overlap if any texture already aliasing this resource is used by the same effect
+			if (std::any_of(_textures.cbegin(), _textures.cend(),
+					[&tex, resource = other_tex.resource](const texture &item) {
+						return item.resource == resource && std::find_first_of(item.shared.cbegin(), item.shared.cend(), tex.shared.cbegin(), tex.shared.cend()) != item.shared.cend();
+					}))
+				continue;
+
+			tex.resource = other_tex.resource;
+			tex.srv[0] = other_tex.srv[0];
+			tex.srv[1] = other_tex.srv[1];
+			tex.rtv[0] = other_tex.rtv[0];
+			tex.rtv[1] = other_tex.rtv[1];
+			tex.uav = other_tex.uav;
+			return true;
+		}
+	}
+
 	api::resource_type type = api::resource_type::unknown;
 	api::resource_view_type view_type = api::resource_view_type::unknown;
 
@@ -3414,6 +3707,18 @@ void reshade::runtime::destroy_texture(texture &tex)
 		_preview_texture.handle = 0;
 #endif
 
+	// Only release the reference if other textures still alias the same resource
+	if (is_texture_aliased(tex))
+	{
+		tex.resource = {};
+		tex.srv[0] = {};
+		tex.srv[1] = {};
+		tex.rtv[0] = {};
+		tex.rtv[1] = {};
+		tex.uav.clear();
+		return;
+	}
+
 	_device->destroy_resource(tex.resource);
 	tex.resource = {};
 
@@ -3434,6 +3739,12 @@ void reshade::runtime::destroy_texture(texture &tex)
 	tex.uav.clear();
 }
 
+bool reshade::runtime::is_texture_aliased(const texture &tex) const
+{
+	return tex.resource != 0 && std::any_of(_textures.cbegin(), _textures.cend(),
+		[&tex](const texture &item) { return &item != &tex && item.resource == tex.resource; });
+}
+
 void reshade::runtime::enable_technique(technique &tech)
 {
 	assert(tech.effect_index < _effects.size());
@@ -3561,27 +3872,53 @@ void reshade::runtime::load_effects(bool force_load_all)
 	for (const std::filesystem::path &effect_file : effect_files)
 		preset.get(effect_file.filename().u8string(), "PreprocessorDefinitions", _preset_preprocessor_definitions[effect_file.filename().u8string()]);
 
+	// Open packed effect cache before any threads are spawned that may access it
+	if (_packed_effect_cache && !_no_effect_cache && _effect_cache_archive == nullptr)
+	{
+		_effect_cache_archive = std::make_unique<effect_cache_archive>();
+		if (!_effect_cache_archive->open(g_reshade_base_path / _effect_cache_path / std::filesystem::u8path("reshade-" + std::to_string(_renderer_id) + ".cache")))
+			_effect_cache_archive.reset(); // Fall back to loose cache files
+	}
+
 	// Allocate space for effects which are placed in this array during the 'load_effect' call
 	const size_t offset = _effects.size();
 	_effects.resize(offset + effect_files.size());
 	_reload_remaining_effects = effect_files.size();
 
 	// Now that we have a list of files, load them in parallel
-	// Split workload into batches instead of launching a thread for every file to avoid launch overhead and stutters due to too many threads being in flight
-	size_t num_splits = std::min(effect_files.size(), static_cast<size_t>(std::max(std::thread::hardware_concurrency(), 2u) - 1));
-#ifndef _WIN64
-	// Limit number of threads in 32-bit due to the limited about of address space being available there and compilation being memory hungry
-	num_splits = std::min(num_splits, static_cast<size_t>(4));
-#endif
+	// Submit those that took the longest to load the last time first (or those that were not loaded before, largest file first), so that they do not end up delaying completion of the entire batch
+	std::vector<std::pair<std::chrono::high_resolution_clock::duration::rep, size_t>> load_order;
+	load_order.reserve(effect_files.size());
+	for (size_t i = 0; i < effect_files.size(); ++i)
+	{
+		std::chrono::high_resolution_clock::duration::rep cost;
+		if (const auto it = _last_load_durations.find(effect_files[i]);
+			it != _last_load_durations.end())
+		{
+			cost = it->second.count();
+		}
+		else
+		{
+			std::error_code ec;
+			const uintmax_t file_size = std::filesystem::file_size(effect_files[i], ec);
+			cost = std::numeric_limits<std::chrono::high_resolution_clock::duration::rep>::max() / 2 + (ec ? 0 : static_cast<std::chrono::high_resolution_clock::duration::rep>(file_size));
+		}
+
+		load_order.emplace_back(cost, i);
+	}
+
+	std::sort(load_order.begin(), load_order.end(), std::greater<>());
 
-	// Keep track of the spawned threads, so the runtime cannot be destroyed while they are still running
-	for (size_t n = 0; n < num_splits; ++n)
-		_worker_threads.emplace_back([this, effect_files, offset, num_splits, n, &preset, force_load_all]() {
+	for (const std::pair<std::chrono::high_resolution_clock::duration::rep, size_t> &item : load_order)
+	{
+		const size_t i = item.second;
+
+		_worker_threads.submit(_load_tasks, [this, source_file = effect_files[i], effect_index = offset + i, &preset, force_load = force_load_all || effect_files[i].extension() == L".addonfx"]() {
 			// Abort loading when initialization state changes (indicating that 'on_reset' was called in the meantime)
-			for (size_t i = 0; i < effect_files.size() && _is_initialized; ++i)
-				if (i * num_splits / effect_files.size() == n)
-					load_effect(effect_files[i], preset, offset + i, 0, force_load_all || effect_files[i].extension() == L".addonfx");
+			if (_is_initialized)
+				load_effect(source_file, preset, effect_index, 0, force_load);
 		});
+	}
 }
 bool reshade::runtime::reload_effect(size_t effect_index)
 {
@@ -3629,10 +3966,10 @@ void reshade::runtime::reload_effects(bool force_load_all)
 void reshade::runtime::destroy_effects()
 {
 	// Make sure no threads are still accessing effect data
-	for (std::thread &thread : _worker_threads)
-		if (thread.joinable())
-			thread.join();
-	_worker_threads.clear();
+	_worker_threads.wait(_load_tasks);
+
+	// Close packed effect cache after all threads finished, so that it is mapped again with any newly appended data on the next load
+	_effect_cache_archive.reset();
 
 #if RESHADE_GUI
 	_effect_filter[0] = '\0';
@@ -3640,6 +3977,7 @@ void reshade::runtime::destroy_effects()
 
 	// Reset the effect creation queue
 	_reload_create_queue.clear();
+	_reload_created_effects = 0;
 	_reload_required_effects.clear();
 	_reload_remaining_effects = std::numeric_limits<size_t>::max();
 
@@ -3674,6 +4012,9 @@ bool reshade::runtime::load_effect_cache(const std::string &id, const std::strin
 	if (_no_effect_cache)
 		return false;
 
+	if (_effect_cache_archive != nullptr)
+		return _effect_cache_archive->read(id + '.' + type, data);
+
 	std::filesystem::path path = g_reshade_base_path / _effect_cache_path;
 	path /= std::filesystem::u8path("reshade-" + id + '.' + type);
 
@@ -3695,6 +4036,9 @@ bool reshade::runtime::save_effect_cache(const std::string &id, const std::strin
 	if (_no_effect_cache)
 		return false;
 
+	if (_effect_cache_archive != nullptr)
+		return _effect_cache_archive->write(id + '.' + type, data);
+
 	std::filesystem::path path = g_reshade_base_path / _effect_cache_path;
 	path /= std::filesystem::u8path("reshade-" + id + '.' + type);
 
@@ -3710,6 +4054,10 @@ void reshade::runtime::clear_effect_cache()
 {
 	std::error_code ec;
 
+	// The packed effect cache cannot be deleted while it is open, so clear its contents instead
+	if (_effect_cache_archive != nullptr)
+		_effect_cache_archive->clear();
+
 	// Find all cached effect files and delete them
 	for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(g_reshade_base_path / _effect_cache_path, std::filesystem::directory_options::skip_permission_denied, ec))
 	{
@@ -3718,7 +4066,9 @@ void reshade::runtime::clear_effect_cache()
 
 		const std::filesystem::path filename = entry.path().filename();
 		const std::filesystem::path extension = entry.path().extension();
-		if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != L".i" && extension != L".cso" && extension != L".asm"))
+		if (filename.native().compare(0, 8, L"reshade-") != 0 || (extension != L".i" && extension != L".dep" && extension != L".cso" && extension != L".asm" && extension != L".cache"))
+			continue;
+		if (_effect_cache_archive != nullptr && filename == std::filesystem::u8path("reshade-" + std::to_string(_renderer_id) + ".cache"))
 			continue;
 
 		std::filesystem::remove(entry, ec);
@@ -3840,8 +4190,9 @@ void reshade::runtime::update_effects()
 
 				_reload_remaining_effects += 1;
 
-				_worker_threads.emplace_back([this, effect_index, permutation_index]() {
-						load_effect(_effects[effect_index].source_file, ini_file::load_cache(_current_preset_path), effect_index, permutation_index, true);
+				_worker_threads.submit(_load_tasks, [this, effect_index = effect_index, permutation_index = permutation_index]() {
+						if (_is_initialized)
+							load_effect(_effects[effect_index].source_file, ini_file::load_cache(_current_preset_path), effect_index, permutation_index, true);
 					});
 			}
 
@@ -3856,11 +4207,8 @@ void reshade::runtime::update_effects()
 
 	if (_reload_remaining_effects == 0)
 	{
-		// Clear the thread list now that they all have finished
-		for (std::thread &thread : _worker_threads)
-			if (thread.joinable())
-				thread.join(); // Threads have exited, but still need to join them prior to destruction
-		_worker_threads.clear();
+		// All effects have finished loading, but the tasks may still be returning, so wait for them before accessing effect data
+		_worker_threads.wait(_load_tasks);
 
 		// Finished loading effects, so apply preset to figure out which ones need compiling
 		load_current_preset();
@@ -3899,48 +4247,60 @@ void reshade::runtime::update_effects()
 	if (_reload_remaining_effects != std::numeric_limits<size_t>::max() || _reload_create_queue.empty())
 		return;
 
-	// Pop an effect from the queue
-	const auto [effect_index, permutation_index] = _reload_create_queue.back();
-	_reload_create_queue.pop_back();
-	effect &effect = _effects[effect_index];
+	// Create as many effects as fit into the time budget for this frame, but always at least one, so that progress is made even if a single effect takes longer
+	const std::chrono::high_resolution_clock::time_point time_creation_started = std::chrono::high_resolution_clock::now();
 
-	if (!create_effect(effect_index, permutation_index))
+	do
 	{
-		_graphics_queue->wait_idle();
+		// Pop an effect from the queue
+		const auto [effect_index, permutation_index] = _reload_create_queue.back();
+		_reload_create_queue.pop_back();
+		effect &effect = _effects[effect_index];
 
-		// Destroy all textures belonging to this effect
-		for (texture &tex : _textures)
-			if (tex.effect_index == effect_index && tex.shared.size() <= 1)
-				destroy_texture(tex);
-		// Disable all techniques belonging to this effect
-		for (technique &tech : _techniques)
-			if (tech.effect_index == effect_index)
-				disable_technique(tech);
+		if (!create_effect(effect_index, permutation_index))
+		{
+			_graphics_queue->wait_idle();
+
+			// Destroy all textures belonging to this effect
+			for (texture &tex : _textures)
+				if (tex.effect_index == effect_index && tex.shared.size() <= 1)
+					destroy_texture(tex);
+			// Disable all techniques belonging to this effect
+			for (technique &tech : _techniques)
+				if (tech.effect_index == effect_index)
+					disable_technique(tech);
+
+			effect.compiled = false;
+			_last_reload_successful = false;
+		}
 
-		effect.compiled = false;
-		_last_reload_successful = false;
-	}
+		_reload_created_effects++;
 
 #if RESHADE_GUI
-	// Update assembly in all code editors after a reload
-	for (editor_instance &instance : _editors)
-	{
-		if (!instance.generated || instance.entry_point_name.empty() || instance.permutation_index != permutation_index || instance.file_path != effect.source_file)
-			continue;
+		// Update assembly in all code editors after a reload
+		for (editor_instance &instance : _editors)
+		{
+			if (!instance.generated || instance.entry_point_name.empty() || instance.permutation_index != permutation_index || instance.file_path != effect.source_file)
+				continue;
 
-		assert(instance.effect_index == effect_index);
+			assert(instance.effect_index == effect_index);
 
-		const effect::permutation &permutation = effect.permutations[permutation_index];
+			const effect::permutation &permutation = effect.permutations[permutation_index];
 
-		if (permutation.assembly_text.find(instance.entry_point_name) != permutation.assembly_text.end())
-			open_code_editor(instance);
-	}
+			if (permutation.assembly_text.find(instance.entry_point_name) != permutation.assembly_text.end())
+				open_code_editor(instance);
+		}
 #endif
+	} while (!_reload_create_queue.empty() && (std::chrono::high_resolution_clock::now() - time_creation_started) < std::chrono::milliseconds(_effect_creation_budget));
 
-#if RESHADE_ADDON
 	if (_reload_create_queue.empty())
+	{
+		_reload_created_effects = 0;
+
+#if RESHADE_ADDON
 		invoke_addon_event<addon_event::reshade_reloaded_effects>(this);
 #endif
+	}
 }
 void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource_view rtv, api::resource_view rtv_srgb)
 {
@@ -3965,18 +4325,26 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 		input_lock = _input->lock();
 
 	// Update special uniform variables
+	const float frame_time = _last_frame_duration.count() * 1e-6f;
+	const float frame_time_seconds = _last_frame_duration.count() * 1e-9f;
+	const unsigned int timer_ms = static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::milliseconds>(_last_present_time - _start_time).count());
+	int date[4] = {};
+	bool date_resolved = false;
+
 	for (effect &effect : _effects)
 	{
 		if (!effect.rendering || (!_effects_enabled && !effect.addon))
 			continue;
 
-		for (uniform &variable : effect.uniforms)
+		for (const effect::special_uniform_update &update : effect.special_uniform_updates)
 		{
-			switch (variable.special)
+			uniform &variable = effect.uniforms[update.uniform_index];
+
+			switch (update.special)
 			{
 				case special_uniform::frame_time:
 				{
-					set_uniform_value(variable, _last_frame_duration.count() * 1e-6f);
+					set_uniform_value(variable, frame_time);
 					break;
 				}
 				case special_uniform::frame_count:
@@ -3989,26 +4357,26 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 				}
 				case special_uniform::random:
 				{
-					const int min = variable.annotation_as_int("min", 0, 0);
-					const int max = variable.annotation_as_int("max", 0, RAND_MAX);
+					const int min = update.int_range[0];
+					const int max = update.int_range[1];
 					set_uniform_value(variable, min + (std::rand() % (std::abs(max - min) + 1)));
 					break;
 				}
 				case special_uniform::ping_pong:
 				{
-					const float min = variable.annotation_as_float("min", 0, 0.0f);
-					const float max = variable.annotation_as_float("max", 0, 1.0f);
-					const float step_min = variable.annotation_as_float("step", 0);
-					const float step_max = variable.annotation_as_float("step", 1);
+					const float min = update.float_range[0];
+					const float max = update.float_range[1];
+					const float step_min = update.step[0];
+					const float step_max = update.step[1];
 					float increment = step_max == 0 ? step_min : (step_min + std::fmod(static_cast<float>(std::rand()), step_max - step_min + 1));
-					const float smoothing = variable.annotation_as_float("smoothing");
+					const float smoothing = update.smoothing;
 
 					float value[2] = { 0, 0 };
 					get_uniform_value(variable, value, 2);
 					if (value[1] >= 0)
 					{
 						increment = std::max(increment - std::max(0.0f, smoothing - (max - value[0])), 0.05f);
-						increment *= _last_frame_duration.count() * 1e-9f;
+						increment *= frame_time_seconds;
 
 						if ((value[0] += increment) >= max)
 							value[0] = max, value[1] = -1;
@@ -4016,7 +4384,7 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 					else
 					{
 						increment = std::max(increment - std::max(0.0f, smoothing - (value[0] - min)), 0.05f);
-						increment *= _last_frame_duration.count() * 1e-9f;
+						increment *= frame_time_seconds;
 
 						if ((value[0] -= increment) <= min)
 							value[0] = min, value[1] = +1;
@@ -4026,22 +4394,23 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 				}
 				case special_uniform::date:
 				{
-					const std::time_t t = std::chrono::system_clock::to_time_t(_current_time);
-					struct tm tm; localtime_s(&tm, &t);
-
-					const int value[4] = {
-						tm.tm_year + 1900,
-						tm.tm_mon + 1,
-						tm.tm_mday,
-						tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec
-					};
-					set_uniform_value(variable, value, 4);
+					if (!date_resolved)
+					{
+						const std::time_t t = std::chrono::system_clock::to_time_t(_current_time);
+						struct tm tm; localtime_s(&tm, &t);
+
+						date[0] = tm.tm_year + 1900;
+						date[1] = tm.tm_mon + 1;
+						date[2] = tm.tm_mday;
+						date[3] = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+						date_resolved = true;
+					}
+					set_uniform_value(variable, date, 4);
 					break;
 				}
 				case special_uniform::timer:
 				{
-					const unsigned long long timer_ms = std::chrono::duration_cast<std::chrono::milliseconds>(_last_present_time - _start_time).count();
-					set_uniform_value(variable, static_cast<unsigned int>(timer_ms));
+					set_uniform_value(variable, timer_ms);
 					break;
 				}
 				case special_uniform::key:
@@ -4049,21 +4418,22 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 					if (_input == nullptr)
 						break;
 
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode > 7 && keycode < 256)
+					switch (update.mode)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
+					case effect::special_uniform_update::input_mode::toggle:
+						if (_input->is_key_pressed(update.keycode))
 						{
 							bool current_value = false;
 							get_uniform_value(variable, &current_value);
-							if (_input->is_key_pressed(keycode))
-								set_uniform_value(variable, !current_value);
+							set_uniform_value(variable, !current_value);
 						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_key_pressed(keycode));
-						else
-							set_uniform_value(variable, _input->is_key_down(keycode));
+						break;
+					case effect::special_uniform_update::input_mode::press:
+						set_uniform_value(variable, _input->is_key_pressed(update.keycode));
+						break;
+					default:
+						set_uniform_value(variable, _input->is_key_down(update.keycode));
+						break;
 					}
 					break;
 				}
@@ -4088,21 +4458,22 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 					if (_input == nullptr)
 						break;
 
-					if (const int keycode = variable.annotation_as_int("keycode");
-						keycode >= 0 && keycode < 5)
+					switch (update.mode)
 					{
-						if (const std::string_view mode = variable.annotation_as_string("mode");
-							mode == "toggle" || variable.annotation_as_int("toggle"))
+					case effect::special_uniform_update::input_mode::toggle:
+						if (_input->is_mouse_button_pressed(update.keycode))
 						{
 							bool current_value = false;
 							get_uniform_value(variable, &current_value);
-							if (_input->is_mouse_button_pressed(keycode))
-								set_uniform_value(variable, !current_value);
+							set_uniform_value(variable, !current_value);
 						}
-						else if (mode == "press")
-							set_uniform_value(variable, _input->is_mouse_button_pressed(keycode));
-						else
-							set_uniform_value(variable, _input->is_mouse_button_down(keycode));
+						break;
+					case effect::special_uniform_update::input_mode::press:
+						set_uniform_value(variable, _input->is_mouse_button_pressed(update.keycode));
+						break;
+					default:
+						set_uniform_value(variable, _input->is_mouse_button_down(update.keycode));
+						break;
 					}
 					break;
 				}
@@ -4111,16 +4482,13 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 					if (_input == nullptr)
 						break;
 
-					const float min = variable.annotation_as_float("min");
-					const float max = variable.annotation_as_float("max");
-					float step = variable.annotation_as_float("step");
-					if (step == 0.0f)
-						step  = 1.0f;
+					const float min = update.float_range[0];
+					const float max = update.float_range[1];
 
 					float value[2] = { 0, 0 };
 					get_uniform_value(variable, value, 2);
 					value[1] = _input->mouse_wheel_delta();
-					value[0] = value[0] + value[1] * step;
+					value[0] = value[0] + value[1] * update.step[0];
 					if (min != max)
 					{
 						value[0] = std::max(value[0], min);
@@ -4191,6 +4559,10 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 	cmd_list->begin_debug_event("ReShade effects");
 #endif
 
+	// Application may have changed constant registers and the back buffer since effects were last rendered
+	_last_pushed_uniforms_effect_index = std::numeric_limits<size_t>::max();
+	_back_buffer_copy_up_to_date = false;
+
 	// Render all enabled techniques
 	for (size_t technique_index : _technique_sorting)
 	{
@@ -4232,7 +4604,7 @@ void reshade::runtime::render_effects(api::command_list *cmd_list, api::resource
 }
 void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_list, api::resource back_buffer_resource, api::resource_view back_buffer_rtv, api::resource_view back_buffer_rtv_srgb, size_t permutation_index)
 {
-	const effect &effect = _effects[tech.effect_index];
+	effect &effect = _effects[tech.effect_index];
 	const effect::permutation &permutation = effect.permutations[permutation_index];
 
 #ifndef NDEBUG
@@ -4269,25 +4641,67 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 #endif
 
 	// Update shader constants
-	if (void *mapped_uniform_data;
-		effect.cb != 0 && _device->map_buffer_region(effect.cb, 0, effect.uniform_data_storage.size(), api::map_access::write_discard, &mapped_uniform_data))
+	if (effect.cb != 0)
 	{
-		std::memcpy(mapped_uniform_data, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
-		_device->unmap_buffer_region(effect.cb);
+		// Only upload when data changed since the last upload (which may have happened for a previous technique of the same effect)
+		if (effect.uniform_data_dirty_begin != effect.uniform_data_dirty_end)
+		{
+			size_t offset = effect.uniform_data_dirty_begin;
+			size_t size = effect.uniform_data_dirty_end - effect.uniform_data_dirty_begin;
+			api::map_access access = api::map_access::write_only;
+
+			// Dynamic buffers in D3D10/D3D11 can only be mapped with discard, which throws away the previous contents, so always need to write everything there
+			// Same in OpenGL, where mapping a range of a buffer that is still in use by previous draws without invalidating it would stall until the GPU finished with it, while discarding lets the driver orphan the buffer instead
+			if (_device->get_api() == api::device_api::d3d10 || _device->get_api() == api::device_api::d3d11 || _device->get_api() == api::device_api::opengl)
+			{
+				offset = 0;
+				size = effect.uniform_data_storage.size();
+				access = api::map_access::write_discard;
+			}
+
+			if (void *mapped_uniform_data;
+				_device->map_buffer_region(effect.cb, offset, size, access, &mapped_uniform_data))
+			{
+				std::memcpy(mapped_uniform_data, effect.uniform_data_storage.data() + offset, size);
+				_device->unmap_buffer_region(effect.cb);
+
+				effect.uniform_data_dirty_begin = effect.uniform_data_dirty_end = 0;
+			}
+		}
 	}
-	else if (_device->get_api() == api::device_api::d3d9)
+	else if (_device->get_api() == api::device_api::d3d9 && !effect.uniform_data_storage.empty())
 	{
-		cmd_list->push_constants(api::shader_stage::all, permutation.layout, 0, 0, static_cast<uint32_t>(effect.uniform_data_storage.size() / 4), effect.uniform_data_storage.data());
+		// Constant registers are shared with the application and other effects, so can only skip the upload when they were last set for this effect in the current pass over the techniques
+		if (_last_pushed_uniforms_effect_index != tech.effect_index)
+		{
+			cmd_list->push_constants(api::shader_stage::all, permutation.layout, 0, 0, static_cast<uint32_t>(effect.uniform_data_storage.size() / 4), effect.uniform_data_storage.data());
+			_last_pushed_uniforms_effect_index = tech.effect_index;
+		}
+		else if (effect.uniform_data_dirty_begin != effect.uniform_data_dirty_end)
+		{
+			cmd_list->push_constants(api::shader_stage::all, permutation.layout, 0, static_cast<uint32_t>(effect.uniform_data_dirty_begin / 4), static_cast<uint32_t>((effect.uniform_data_dirty_end - effect.uniform_data_dirty_begin) / 4), effect.uniform_data_storage.data() + effect.uniform_data_dirty_begin);
+		}
+
+		effect.uniform_data_dirty_begin = effect.uniform_data_dirty_end = 0;
 	}
 
 	const bool sampler_with_resource_view = _device->check_capability(api::device_caps::sampler_with_resource_view);
 
 	bool is_effect_stencil_cleared = false;
-	bool needs_implicit_back_buffer_copy = true; // First pass always needs the back buffer updated
 
 	for (size_t pass_index = 0; pass_index < tech.permutations[permutation_index].passes.size(); ++pass_index)
 	{
-		if (needs_implicit_back_buffer_copy)
+		const technique::pass &pass = tech.permutations[permutation_index].passes[pass_index];
+
+		const uint32_t num_barriers = static_cast<uint32_t>(pass.modified_resources.size());
+
+		// Transitions for the resources modified by this pass, prefixed by the transitions that restore the state after the back buffer copy (if any), so that both can be submitted in a single barrier
+		uint32_t num_entry_barriers = 0;
+		temp_mem<api::resource> entry_resources(2 + num_barriers);
+		temp_mem<api::resource_usage> entry_state_old(2 + num_barriers), entry_state_new(2 + num_barriers);
+
+		// Only need to update the copy of the back buffer when this pass actually samples it and it was modified since the last copy (by the application or a previous pass)
+		if (pass.samples_back_buffer && !_back_buffer_copy_up_to_date)
 		{
 			// Save back buffer of previous pass
 			const api::resource resources[2] = { back_buffer_resource, _effect_permutations[permutation_index].color_tex};
@@ -4296,10 +4710,24 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 
 			cmd_list->barrier(2, resources, state_old, state_new);
 			cmd_list->copy_texture_region(back_buffer_resource, 0, nullptr, _effect_permutations[permutation_index].color_tex, 0, nullptr);
-			cmd_list->barrier(2, resources, state_new, state_old);
+
+			for (; num_entry_barriers < 2; ++num_entry_barriers)
+			{
+				entry_resources[num_entry_barriers] = resources[num_entry_barriers];
+				entry_state_old[num_entry_barriers] = state_new[num_entry_barriers];
+				entry_state_new[num_entry_barriers] = state_old[num_entry_barriers];
+			}
+
+			_back_buffer_copy_up_to_date = true;
 		}
 
-		const technique::pass &pass = tech.permutations[permutation_index].passes[pass_index];
+		const api::resource_usage pass_usage = pass.cs_entry_point.empty() ? api::resource_usage::render_target : api::resource_usage::unordered_access;
+		for (uint32_t i = 0; i < num_barriers; ++i, ++num_entry_barriers)
+		{
+			entry_resources[num_entry_barriers] = pass.modified_resources[i];
+			entry_state_old[num_entry_barriers] = api::resource_usage::shader_resource;
+			entry_state_new[num_entry_barriers] = pass_usage;
+		}
 
 #ifndef NDEBUG
 		cmd_list->begin_debug_event((pass.name.empty() ? "Pass " + std::to_string(pass_index) : pass.name).c_str());
@@ -4310,19 +4738,15 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 			cmd_list->end_query(effect.query_heap, api::query_type::timestamp, query_base_index + static_cast<uint32_t>((1 + pass_index) * 2));
 #endif
 
-		const uint32_t num_barriers = static_cast<uint32_t>(pass.modified_resources.size());
-
 		if (!pass.cs_entry_point.empty())
 		{
-			// Compute shaders do not write to the back buffer, so no update necessary
-			needs_implicit_back_buffer_copy = false;
-
+			// Compute shaders do not write to the back buffer, so the copy of it stays valid
 			cmd_list->bind_pipeline(api::pipeline_stage::all_compute, pass.pipeline);
 
 			temp_mem<api::resource_usage> state_old, state_new;
 			std::fill_n(state_old.p, num_barriers, api::resource_usage::shader_resource);
 			std::fill_n(state_new.p, num_barriers, api::resource_usage::unordered_access);
-			cmd_list->barrier(num_barriers, pass.modified_resources.data(), state_old.p, state_new.p);
+			cmd_list->barrier(num_entry_barriers, entry_resources.p, entry_state_old.p, entry_state_new.p);
 
 			// Reset bindings on every pass (since they get invalidated by the call to 'generate_mipmaps' below)
 			if (effect.cb != 0)
@@ -4347,7 +4771,7 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 			temp_mem<api::resource_usage> state_old, state_new;
 			std::fill_n(state_old.p, num_barriers, api::resource_usage::shader_resource);
 			std::fill_n(state_new.p, num_barriers, api::resource_usage::render_target);
-			cmd_list->barrier(num_barriers, pass.modified_resources.data(), state_old.p, state_new.p);
+			cmd_list->barrier(num_entry_barriers, entry_resources.p, entry_state_old.p, entry_state_new.p);
 
 			// Setup render targets
 			uint32_t render_target_count = 0;
@@ -4356,15 +4780,14 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 
 			if (pass.render_target_names[0].empty())
 			{
-				needs_implicit_back_buffer_copy = true;
+				// Writing to the back buffer invalidates the copy of it
+				_back_buffer_copy_up_to_date = false;
 
 				render_target[0].view = pass.srgb_write_enable ? back_buffer_rtv_srgb : back_buffer_rtv;
 				render_target_count = 1;
 			}
 			else
 			{
-				needs_implicit_back_buffer_copy = false;
-
 				for (int i = 0; i < 8 && pass.render_target_views[i] != 0; ++i, ++render_target_count)
 					render_target[i].view = pass.render_target_views[i];
 			}
@@ -4489,6 +4912,13 @@ void reshade::runtime::render_technique(technique &tech, api::command_list *cmd_
 	_is_in_api_call = true;
 	invoke_addon_event<addon_event::reshade_render_technique>(const_cast<runtime *>(this), api::effect_technique { reinterpret_cast<uintptr_t>(&tech) }, cmd_list, back_buffer_rtv, back_buffer_rtv_srgb);
 	_is_in_api_call = false;
+
+	// Add-ons may have changed constant registers or rendered to the back buffer, but only if any are actually listening to this event
+	if (has_addon_event<addon_event::reshade_render_technique>())
+	{
+		_last_pushed_uniforms_effect_index = std::numeric_limits<size_t>::max();
+		_back_buffer_copy_up_to_date = false;
+	}
 #endif
 }
 
@@ -4507,52 +4937,54 @@ void reshade::runtime::save_texture(const texture &tex)
 
 	_last_screenshot_save_successful = true;
 
-	if (std::vector<uint8_t> pixels(static_cast<size_t>(tex.width) * static_cast<size_t>(tex.height) * 4);
-		get_texture_data(tex.resource, api::resource_usage::shader_resource, pixels.data()))
-	{
-		_worker_threads.emplace_back([this, screenshot_path, pixels = std::move(pixels), width = tex.width, height = tex.height]() mutable {
-			// Default to a save failure unless it is reported to succeed below
-			bool save_success = false;
+	// The texture data is read back asynchronously and only saved once the copy finished in a later frame, to avoid stalling rendering
+	queue_texture_readback(tex.resource, api::resource_usage::shader_resource, [this, screenshot_path, width = tex.width, height = tex.height](std::vector<uint8_t> &&pixels) {
+			if (pixels.empty())
+				return;
 
-			if (FILE *const file = _wfsopen(screenshot_path.c_str(), L"wb", SH_DENYNO))
-			{
-				const auto write_callback = [](void *context, void *data, int size) {
-					fwrite(data, 1, size, static_cast<FILE *>(context));
-				};
+			_worker_threads.submit(_save_tasks, [this, screenshot_path, pixels = std::move(pixels), width, height]() {
+				// Default to a save failure unless it is reported to succeed below
+				bool save_success = false;
 
-				switch (_screenshot_format)
+				if (FILE *const file = _wfsopen(screenshot_path.c_str(), L"wb", SH_DENYNO))
 				{
-				case 0:
-					save_success = stbi_write_bmp_to_func(write_callback, file, width, height, 4, pixels.data()) != 0;
-					break;
-				case 1:
+					const auto write_callback = [](void *context, void *data, int size) {
+						fwrite(data, 1, size, static_cast<FILE *>(context));
+					};
+
+					switch (_screenshot_format)
+					{
+					case 0:
+						save_success = stbi_write_bmp_to_func(write_callback, file, width, height, 4, pixels.data()) != 0;
+						break;
+					case 1:
 #if 1
-					if (std::vector<uint8_t> encoded_data;
-						fpng::fpng_encode_image_to_memory(pixels.data(), width, height, 4, encoded_data))
-						save_success = fwrite(encoded_data.data(), 1, encoded_data.size(), file) == encoded_data.size();
+						if (std::vector<uint8_t> encoded_data;
+							fpng::fpng_encode_image_to_memory(pixels.data(), width, height, 4, encoded_data))
+							save_success = fwrite(encoded_data.data(), 1, encoded_data.size(), file) == encoded_data.size();
 #else
-					save_success = stbi_write_png_to_func(write_callback, file, width, height, 4, pixels.data(), 0) != 0;
+						save_success = stbi_write_png_to_func(write_callback, file, width, height, 4, pixels.data(), 0) != 0;
 #endif
-					break;
-				case 2:
-					save_success = stbi_write_jpg_to_func(write_callback, file, width, height, 4, pixels.data(), _screenshot_jpeg_quality) != 0;
-					break;
-				}
+						break;
+					case 2:
+						save_success = stbi_write_jpg_to_func(write_callback, file, width, height, 4, pixels.data(), _screenshot_jpeg_quality) != 0;
+						break;
+					}
 
-				if (ferror(file))
-					save_success = false;
+					if (ferror(file))
+						save_success = false;
 
-				fclose(file);
-			}
+					fclose(file);
+				}
 
-			if (_last_screenshot_save_successful)
-			{
-				_last_screenshot_time = std::chrono::high_resolution_clock::now();
-				_last_screenshot_file = screenshot_path;
-				_last_screenshot_save_successful = save_success;
-			}
+				if (_last_screenshot_save_successful)
+				{
+					_last_screenshot_time = std::chrono::high_resolution_clock::now();
+					_last_screenshot_file = screenshot_path;
+					_last_screenshot_save_successful = save_success;
+				}
+			});
 		});
-	}
 }
 void reshade::runtime::update_texture(texture &tex, uint32_t width, uint32_t height, uint32_t depth, const void *pixels)
 {
@@ -4648,7 +5080,9 @@ void reshade::runtime::reset_uniform_value(uniform &variable)
 {
 	if (variable.special != reshade::special_uniform::none)
 	{
-		std::memset(_effects[variable.effect_index].uniform_data_storage.data() + variable.offset, 0, variable.size);
+		effect &effect = _effects[variable.effect_index];
+		std::memset(effect.uniform_data_storage.data() + variable.offset, 0, variable.size);
+		effect.mark_uniform_data_dirty(variable.offset, variable.size);
 		return;
 	}
 
@@ -4790,21 +5224,30 @@ void reshade::runtime::set_uniform_value_data(uniform &variable, const uint8_t *
 	size = std::min(size, static_cast<size_t>(variable.size));
 	assert(data != nullptr && (size % 4) == 0);
 
-	std::vector<uint8_t> &data_storage = _effects[variable.effect_index].uniform_data_storage;
+	effect &effect = _effects[variable.effect_index];
+	std::vector<uint8_t> &data_storage = effect.uniform_data_storage;
 	assert(variable.offset + size <= data_storage.size());
 
 	const size_t array_length = (variable.type.is_array() ? variable.type.array_length : 1u);
 	if (assert(base_index < array_length); base_index >= array_length)
 		return;
 
+	// Only write values that actually changed, so that unchanged data does not need to be uploaded again
+	const auto update_data = [&effect, &data_storage](size_t offset, const uint8_t *value, size_t value_size) {
+		if (std::memcmp(data_storage.data() + offset, value, value_size) == 0)
+			return;
+		std::memcpy(data_storage.data() + offset, value, value_size);
+		effect.mark_uniform_data_dirty(offset, value_size);
+	};
+
 	if (variable.type.is_matrix())
 	{
 		for (size_t a = base_index, i = 0; a < array_length; ++a)
 			// Each row of a matrix is 16-byte aligned, so needs special handling
 			for (size_t row = 0; row < variable.type.rows; ++row)
 				for (size_t col = 0; i < (size / 4) && col < variable.type.cols; ++col, ++i)
-					std::memcpy(
-						data_storage.data() + variable.offset + (a * variable.type.rows * 4 + (row * 4 + col)) * 4,
+					update_data(
+						variable.offset + (a * variable.type.rows * 4 + (row * 4 + col)) * 4,
 						data + ((a - base_index) * variable.type.components() + (row * variable.type.cols + col)) * 4, 4);
 	}
 	else if (array_length > 1)
@@ -4812,13 +5255,13 @@ void reshade::runtime::set_uniform_value_data(uniform &variable, const uint8_t *
 		for (size_t a = base_index, i = 0; a < array_length; ++a)
 			// Each element in the array is 16-byte aligned, so needs special handling
 			for (size_t row = 0; i < (size / 4) && row < variable.type.rows; ++row, ++i)
-				std::memcpy(
-					data_storage.data() + variable.offset + (a * 4 + row) * 4,
+				update_data(
+					variable.offset + (a * 4 + row) * 4,
 					data + ((a - base_index) * variable.type.components() + row) * 4, 4);
 	}
 	else
 	{
-		std::memcpy(data_storage.data() + variable.offset, data, size);
+		update_data(variable.offset, data, size);
 	}
 }
 
@@ -5023,104 +5466,130 @@ void reshade::runtime::save_screenshot(const std::string_view postfix)
 
 	_last_screenshot_save_successful = true;
 
-	if (std::vector<uint8_t> pixels(static_cast<size_t>(_width) * static_cast<size_t>(_height) * (_back_buffer_format == api::format::r16g16b16a16_float ? 8 : 4));
-		capture_screenshot(pixels.data()))
-	{
-		const bool include_preset =
-			_screenshot_include_preset &&
-			postfix != "Before" && postfix != "Overlay" &&
-			ini_file::flush_cache(_current_preset_path);
+	const bool include_preset =
+		_screenshot_include_preset &&
+		postfix != "Before" && postfix != "Overlay" &&
+		ini_file::flush_cache(_current_preset_path);
+
+	// The back buffer data is read back asynchronously and only saved once the copy finished in a later frame, to avoid stalling rendering
+	if (queue_texture_readback(
+			_back_buffer_resolved != 0 ? _back_buffer_resolved : _swapchain->get_current_back_buffer(),
+			_back_buffer_resolved != 0 ? api::resource_usage::render_target : api::resource_usage::present,
+			[this, screenshot_count, screenshot_format, screenshot_path, postfix, include_preset](std::vector<uint8_t> &&pixels) {
+				// Pending save was already accounted for when the readback was handed off, so have to finish it even on failure
+				if (pixels.empty())
+				{
+					finish_screenshot_save(screenshot_path, screenshot_count, postfix, include_preset, false);
+					return;
+				}
 
-		// Play screenshot sound
-		if (!_screenshot_sound_path.empty())
-			utils::play_sound_async(g_reshade_base_path / _screenshot_sound_path);
+				_worker_threads.submit(_save_tasks, [this, screenshot_count, screenshot_format, screenshot_path, postfix, pixels = std::move(pixels), include_preset]() mutable {
+					// Remove alpha channel
+					int comp = 4;
+					if (_screenshot_clear_alpha && screenshot_format != 3)
+					{
+						comp = 3;
+						format_conversion::strip_alpha_rgba8(pixels.data(), pixels.data(), static_cast<size_t>(_width) * static_cast<size_t>(_height));
+					}
 
-		_worker_threads.emplace_back([this, screenshot_count, screenshot_format, screenshot_path, postfix, pixels = std::move(pixels), include_preset]() mutable {
-			// Remove alpha channel
-			int comp = 4;
-			if (_screenshot_clear_alpha && screenshot_format != 3)
-			{
-				comp = 3;
-				for (size_t i = 0; i < static_cast<size_t>(_width) * static_cast<size_t>(_height); ++i)
-					*reinterpret_cast<uint32_t *>(pixels.data() + 3 * i) = *reinterpret_cast<const uint32_t *>(pixels.data() + 4 * i);
-			}
+					// Create screenshot directory if it does not exist
+					std::error_code ec;
+					_screenshot_directory_creation_successful = true;
+					if (!std::filesystem::exists(screenshot_path.parent_path(), ec))
+						if (!(_screenshot_directory_creation_successful = std::filesystem::create_directories(screenshot_path.parent_path(), ec)))
+							log::message(log::level::error, "Failed to create screenshot directory '%s' with error code %d!", screenshot_path.parent_path().u8string().c_str(), ec.value());
 
-			// Create screenshot directory if it does not exist
-			std::error_code ec;
-			_screenshot_directory_creation_successful = true;
-			if (!std::filesystem::exists(screenshot_path.parent_path(), ec))
-				if (!(_screenshot_directory_creation_successful = std::filesystem::create_directories(screenshot_path.parent_path(), ec)))
-					log::message(log::level::error, "Failed to create screenshot directory '%s' with error code %d!", screenshot_path.parent_path().u8string().c_str(), ec.value());
+					const auto on_complete = [this, screenshot_count, screenshot_path, postfix, include_preset](bool save_success) {
+						finish_screenshot_save(screenshot_path, screenshot_count, postfix, include_preset, save_success);
+					};
 
-			// Default to a save failure unless it is reported to succeed below
-			bool save_success = false;
+					FILE *const file = _wfsopen(screenshot_path.c_str(), L"wb", SH_DENYNO);
+					if (file == nullptr)
+					{
+						on_complete(false);
+						return;
+					}
 
-			if (FILE *const file = _wfsopen(screenshot_path.c_str(), L"wb", SH_DENYNO))
-			{
-				const auto write_callback = [](void *context, void *data, int size) {
-					fwrite(data, 1, size, static_cast<FILE *>(context));
-				};
+					// PNG encoding is split up into stripes that are compressed in parallel and streamed to the file, which completes asynchronously
+					if (screenshot_format == 1)
+					{
+						write_png_async(_worker_threads, _save_tasks, file, _width, _height, comp, std::move(pixels), on_complete);
+						return;
+					}
 
-				switch (screenshot_format)
-				{
-				case 0:
-					save_success = stbi_write_bmp_to_func(write_callback, file, _width, _height, comp, pixels.data()) != 0;
-					break;
-				case 1:
-#if 1
-					if (std::vector<uint8_t> encoded_data;
-						fpng::fpng_encode_image_to_memory(pixels.data(), _width, _height, comp, encoded_data))
-						save_success = fwrite(encoded_data.data(), 1, encoded_data.size(), file) == encoded_data.size();
-#else
-					save_success = stbi_write_png_to_func(write_callback, file, _width, _height, comp, pixels.data(), 0) != 0;
-#endif
-					break;
-				case 2:
-					save_success = stbi_write_jpg_to_func(write_callback, file, _width, _height, comp, pixels.data(), _screenshot_jpeg_quality) != 0;
-					break;
-				// Implicit HDR PNG when running in HDR
-				case 3:
-					save_success = sk_hdr_png::write_image_to_disk(screenshot_path.c_str(), _width, _height, pixels.data(), _screenshot_hdr_bits, _back_buffer_format);
-					break;
-				}
+					// Default to a save failure unless it is reported to succeed below
+					bool save_success = false;
 
-				if (ferror(file))
-					save_success = false;
+					const auto write_callback = [](void *context, void *data, int size) {
+						fwrite(data, 1, size, static_cast<FILE *>(context));
+					};
 
-				fclose(file);
-			}
+					switch (screenshot_format)
+					{
+					case 0:
+						save_success = stbi_write_bmp_to_func(write_callback, file, _width, _height, comp, pixels.data()) != 0;
+						break;
+					case 2:
+						save_success = stbi_write_jpg_to_func(write_callback, file, _width, _height, comp, pixels.data(), _screenshot_jpeg_quality) != 0;
+						break;
+					// Implicit HDR PNG when running in HDR
+					case 3:
+						save_success = sk_hdr_png::write_image_to_disk(screenshot_path.c_str(), _width, _height, pixels.data(), _screenshot_hdr_bits, _back_buffer_format);
+						break;
+					}
 
-			if (save_success)
-			{
-				execute_screenshot_post_save_command(screenshot_path, screenshot_count, postfix);
+					if (ferror(file))
+						save_success = false;
 
-				if (include_preset)
-				{
-					std::filesystem::path screenshot_preset_path = screenshot_path;
-					screenshot_preset_path.replace_extension(L".ini");
+					fclose(file);
 
-					// Preset was flushed to disk, so can just copy it over to the new location
-					if (!std::filesystem::copy_file(_current_preset_path, screenshot_preset_path, std::filesystem::copy_options::overwrite_existing, ec))
-						log::message(log::level::error, "Failed to copy preset file for screenshot to '%s' with error code %d!", screenshot_preset_path.u8string().c_str(), ec.value());
-				}
+					on_complete(save_success);
+				});
+			},
+			true))
+	{
+		// Play screenshot sound
+		if (!_screenshot_sound_path.empty())
+			utils::play_sound_async(g_reshade_base_path / _screenshot_sound_path);
+	}
+}
+void reshade::runtime::finish_screenshot_save(const std::filesystem::path &screenshot_path, unsigned int screenshot_count, std::string_view postfix, bool include_preset, bool save_success)
+{
+	if (save_success)
+	{
+		execute_screenshot_post_save_command(screenshot_path, screenshot_count, postfix);
+
+		if (include_preset)
+		{
+			std::filesystem::path screenshot_preset_path = screenshot_path;
+			screenshot_preset_path.replace_extension(L".ini");
+
+			// Preset was flushed to disk, so can just copy it over to the new location
+			if (std::error_code ec; !std::filesystem::copy_file(_current_preset_path, screenshot_preset_path, std::filesystem::copy_options::overwrite_existing, ec))
+				log::message(log::level::error, "Failed to copy preset file for screenshot to '%s' with error code %d!", screenshot_preset_path.u8string().c_str(), ec.value());
+		}
 
 #if RESHADE_ADDON
-				invoke_addon_event<addon_event::reshade_screenshot>(this, screenshot_path.u8string().c_str());
+		invoke_addon_event<addon_event::reshade_screenshot>(this, screenshot_path.u8string().c_str());
 #endif
-			}
-			else
-			{
-				log::message(log::level::error, "Failed to write screenshot to '%s'!", screenshot_path.u8string().c_str());
-			}
+	}
+	else
+	{
+		log::message(log::level::error, "Failed to write screenshot to '%s'!", screenshot_path.u8string().c_str());
+	}
 
-			if (_last_screenshot_save_successful)
-			{
-				_last_screenshot_time = std::chrono::high_resolution_clock::now();
-				_last_screenshot_file = screenshot_path;
-				_last_screenshot_save_successful = save_success;
-			}
-		});
+	if (_last_screenshot_save_successful)
+	{
+		_last_screenshot_time = std::chrono::high_resolution_clock::now();
+		_last_screenshot_file = screenshot_path;
+		_last_screenshot_save_successful = save_success;
 	}
+
+	{
+		const std::unique_lock<std::mutex> lock(_screenshot_save_mutex);
+		_screenshot_saves_pending--;
+	}
+	_screenshot_save_cv.notify_all();
 }
 bool reshade::runtime::execute_screenshot_post_save_command(const std::filesystem::path &screenshot_path, unsigned int screenshot_count, std::string_view postfix)
 {
@@ -5169,6 +5638,41 @@ bool reshade::runtime::execute_screenshot_post_save_command(const std::filesyste
 }
 
 bool reshade::runtime::get_texture_data(api::resource resource, api::resource_usage state, uint8_t *pixels)
+{
+	bool success = false;
+
+	texture_readback *const readback = queue_texture_readback(resource, state,
+		[pixels, &success](std::vector<uint8_t> &&data) {
+			if (data.empty())
+				return;
+			std::memcpy(pixels, data.data(), data.size());
+			success = true;
+		});
+	if (readback == nullptr)
+		return false;
+
+	// Callers expect the data to be available on return, so have to wait for the copy to finish here (but only for this one, not any other pending captures)
+	if (readback->fence != 0 && _device->get_completed_fence_value(readback->fence) < readback->fence_value)
+		if (!_device->wait(readback->fence, readback->fence_value))
+			_graphics_queue->wait_idle();
+
+	if (!_device->map_texture_region(readback->intermediate, 0, nullptr, api::map_access::read_only, &readback->mapped_data))
+		readback->mapped_data = {};
+
+	readback->state = texture_readback_state::processing;
+	process_texture_readback(*readback);
+
+	if (readback->mapped_data.data != nullptr)
+	{
+		_device->unmap_texture_region(readback->intermediate, 0);
+		readback->mapped_data = {};
+	}
+
+	readback->state = texture_readback_state::idle;
+
+	return success;
+}
+auto reshade::runtime::queue_texture_readback(api::resource resource, api::resource_usage state, std::function<void(std::vector<uint8_t> &&pixels)> callback, bool screenshot) -> texture_readback *
 {
 	const api::resource_desc desc = _device->get_resource_desc(resource);
 
@@ -5184,110 +5688,239 @@ bool reshade::runtime::get_texture_data(api::resource resource, api::resource_us
 		view_format != api::format::r16g16b16a16_float)
 	{
 		log::message(log::level::error, "Screenshots are not supported for format %u!", static_cast<uint32_t>(desc.texture.format));
-		return false;
+		return nullptr;
 	}
 
-	// Copy back buffer data into system memory buffer
-	api::resource intermediate;
-	if (!_device->create_resource(api::resource_desc(desc.texture.width, desc.texture.height, 1, 1, view_format, 1, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest), nullptr, api::resource_usage::copy_dest, &intermediate))
+	const api::resource_desc intermediate_desc(desc.texture.width, desc.texture.height, 1, 1, view_format, 1, api::memory_heap::gpu_to_cpu, api::resource_usage::copy_dest);
+
+	const auto find_idle_readback = [this, &intermediate_desc]() -> texture_readback * {
+		texture_readback *result = nullptr;
+		for (texture_readback &readback : _texture_readbacks)
+		{
+			if (readback.state != texture_readback_state::idle)
+				continue;
+			// Prefer an intermediate texture that can be reused as is
+			if (readback.intermediate != 0 &&
+				readback.intermediate_desc.texture.width == intermediate_desc.texture.width &&
+				readback.intermediate_desc.texture.height == intermediate_desc.texture.height &&
+				readback.intermediate_desc.texture.format == intermediate_desc.texture.format)
+				return &readback;
+			if (result == nullptr)
+				result = &readback;
+		}
+		return result;
+	};
+
+	texture_readback *readback = find_idle_readback();
+	if (readback == nullptr)
 	{
-		log::message(log::level::error, "Failed to create system memory texture for screenshot capture!");
-		return false;
+		// All intermediate textures are in use, so have to wait for pending captures to finish
+		update_texture_readbacks(true);
+		readback = find_idle_readback();
+		assert(readback != nullptr);
 	}
 
-	_device->set_resource_name(intermediate, "ReShade screenshot texture");
+	if (readback->intermediate != 0 && (
+		readback->intermediate_desc.texture.width != intermediate_desc.texture.width ||
+		readback->intermediate_desc.texture.height != intermediate_desc.texture.height ||
+		readback->intermediate_desc.texture.format != intermediate_desc.texture.format))
+	{
+		_device->destroy_resource(readback->intermediate);
+		readback->intermediate = {};
+	}
+
+	if (readback->intermediate == 0)
+	{
+		if (!_device->create_resource(intermediate_desc, nullptr, api::resource_usage::copy_dest, &readback->intermediate))
+		{
+			log::message(log::level::error, "Failed to create system memory texture for screenshot capture!");
+			return nullptr;
+		}
+
+		_device->set_resource_name(readback->intermediate, "ReShade screenshot texture");
+
+		readback->intermediate_desc = intermediate_desc;
+	}
+
+	if (readback->fence == 0 && !_device->create_fence(0, api::fence_flags::none, &readback->fence))
+		readback->fence = {};
 
 	api::command_list *const cmd_list = _graphics_queue->get_immediate_command_list();
 	cmd_list->barrier(resource, state, api::resource_usage::copy_source);
-	cmd_list->copy_texture_region(resource, 0, nullptr, intermediate, 0, nullptr);
+	cmd_list->copy_texture_region(resource, 0, nullptr, readback->intermediate, 0, nullptr);
 	cmd_list->barrier(resource, api::resource_usage::copy_source, state);
 
-	api::fence copy_sync_fence = {};
-	if (!_device->create_fence(0, api::fence_flags::none, &copy_sync_fence) || !_graphics_queue->signal(copy_sync_fence, 1) || !_device->wait(copy_sync_fence, 1))
+	// Signal a fence after the copy, so that its completion can be polled for in a later frame instead of stalling the present here
+	if (readback->fence == 0 || !_graphics_queue->signal(readback->fence, ++readback->fence_value))
+	{
+		if (readback->fence != 0)
+			readback->fence_value--; // Wait on the last value that was signaled successfully instead
 		_graphics_queue->wait_idle();
-	_device->destroy_fence(copy_sync_fence);
+	}
+
+	readback->submit_index = ++_texture_readback_submit_index;
+	readback->callback = std::move(callback);
+	readback->screenshot = screenshot;
+	readback->state = texture_readback_state::copying;
+
+	return readback;
+}
+void reshade::runtime::update_texture_readbacks(bool wait_for_completion)
+{
+	// Only D3D12 and Vulkan allow mapping resources concurrently with rendering, the other APIs map through the immediate context, which must only be used on the render thread
+	const bool map_on_worker_thread = _device->get_api() == api::device_api::d3d12 || _device->get_api() == api::device_api::vulkan;
+
+	const auto release_processed_readbacks = [this]() {
+		for (texture_readback &readback : _texture_readbacks)
+		{
+			if (readback.state != texture_readback_state::processed)
+				continue;
+
+			if (readback.mapped_data.data != nullptr)
+			{
+				_device->unmap_texture_region(readback.intermediate, 0);
+				readback.mapped_data = {};
+			}
+
+			readback.state = texture_readback_state::idle;
+		}
+	};
+
+	release_processed_readbacks();
+
+	while (true)
+	{
+		// Hand off captures in the order they were queued in
+		texture_readback *readback = nullptr;
+		for (texture_readback &pending_readback : _texture_readbacks)
+			if (pending_readback.state == texture_readback_state::copying && (readback == nullptr || pending_readback.submit_index < readback->submit_index))
+				readback = &pending_readback;
+
+		if (readback == nullptr)
+			break;
+
+		// Only poll the fence here, everything else happens on a worker thread, to avoid stalling the present
+		if (readback->fence != 0 && _device->get_completed_fence_value(readback->fence) < readback->fence_value)
+		{
+			if (!wait_for_completion)
+				break;
+
+			if (!_device->wait(readback->fence, readback->fence_value))
+				_graphics_queue->wait_idle();
+		}
+
+		// Each screenshot that is being saved holds on to a full copy of the back buffer, so limit how many can be pending at once to keep memory usage in check with very large captures
+		// Screenshots beyond that limit stay queued here until a save finished, rather than blocking the render thread
+		if (readback->screenshot)
+		{
+			std::unique_lock<std::mutex> lock(_screenshot_save_mutex);
+			if (_screenshot_saves_pending >= max_pending_screenshot_saves)
+			{
+				if (!wait_for_completion)
+					break;
+
+				_screenshot_save_cv.wait(lock, [this]() { return _screenshot_saves_pending < max_pending_screenshot_saves; });
+			}
+
+			_screenshot_saves_pending++;
+		}
+
+		assert(readback->mapped_data.data == nullptr);
+		if (!map_on_worker_thread &&
+			!_device->map_texture_region(readback->intermediate, 0, nullptr, api::map_access::read_only, &readback->mapped_data))
+			readback->mapped_data = {};
+
+		// The entry stays in use until the worker thread is done with it, so that the intermediate texture is not reused or destroyed while it is being read
+		readback->state = texture_readback_state::processing;
+
+		_worker_threads.submit(_save_tasks, [this, readback]() {
+			process_texture_readback(*readback);
+		});
+	}
+
+	if (wait_for_completion)
+	{
+		{
+			std::unique_lock<std::mutex> lock(_texture_readback_mutex);
+			_texture_readback_cv.wait(lock, [this]() {
+				return std::none_of(std::begin(_texture_readbacks), std::end(_texture_readbacks),
+					[](const texture_readback &readback) { return readback.state == texture_readback_state::processing; });
+			});
+		}
+
+		release_processed_readbacks();
+	}
+}
+void reshade::runtime::process_texture_readback(texture_readback &readback)
+{
+	assert(readback.state == texture_readback_state::processing);
+
+	const api::format view_format = readback.intermediate_desc.texture.format;
+	const uint32_t width = readback.intermediate_desc.texture.width;
+	const uint32_t height = readback.intermediate_desc.texture.height;
+
+	// Intermediate texture was either already mapped on the render thread, or has to be mapped here
+	api::subresource_data mapped_data = readback.mapped_data;
+	const bool map_here = mapped_data.data == nullptr && (_device->get_api() == api::device_api::d3d12 || _device->get_api() == api::device_api::vulkan);
+	if (map_here && !_device->map_texture_region(readback.intermediate, 0, nullptr, api::map_access::read_only, &mapped_data))
+		mapped_data = {};
+
+	std::vector<uint8_t> pixels;
 
 	// Copy data from intermediate image into output buffer
-	api::subresource_data mapped_data = {};
-	if (_device->map_texture_region(intermediate, 0, nullptr, api::map_access::read_only, &mapped_data))
+	if (mapped_data.data != nullptr)
 	{
+		// Output is always RGBA, with 8-bit channels, except for HDR formats
+		const uint32_t pixels_row_pitch = width * (view_format == api::format::r16g16b16a16_float ? 8 : 4);
+		pixels.resize(static_cast<size_t>(pixels_row_pitch) * static_cast<size_t>(height));
+
+		uint8_t *row_pixels = pixels.data();
 		auto mapped_pixels = static_cast<const uint8_t *>(mapped_data.data);
-		const uint32_t pixels_row_pitch = api::format_row_pitch(view_format, desc.texture.width);
 
-		for (size_t y = 0; y < desc.texture.height; ++y, pixels += pixels_row_pitch, mapped_pixels += mapped_data.row_pitch)
+		for (size_t y = 0; y < height; ++y, row_pixels += pixels_row_pitch, mapped_pixels += mapped_data.row_pitch)
 		{
-			switch (view_format)
+			// HDR10: Keep the original data, do not convert to 8-bpc
+			// FP16: Is implicitly always scRGB, so keep the original data as well
+			if (view_format == api::format::r16g16b16a16_float ||
+				((view_format == api::format::r10g10b10a2_unorm || view_format == api::format::b10g10r10a2_unorm) && _back_buffer_color_space == api::color_space::hdr10_st2084))
 			{
-			case api::format::r8_unorm:
-				for (size_t x = 0; x < desc.texture.width; ++x)
-				{
-					pixels[x * 4 + 0] = mapped_pixels[x];
-					pixels[x * 4 + 1] = 0;
-					pixels[x * 4 + 2] = 0;
-					pixels[x * 4 + 3] = 0xFF;
-				}
-				break;
-			case api::format::r8g8_unorm:
-				for (size_t x = 0; x < desc.texture.width; ++x)
-				{
-					pixels[x * 4 + 0] = mapped_pixels[x * 2 + 0];
-					pixels[x * 4 + 1] = mapped_pixels[x * 2 + 1];
-					pixels[x * 4 + 2] = 0;
-					pixels[x * 4 + 3] = 0xFF;
-				}
-				break;
-			case api::format::r8g8b8a8_unorm:
-			case api::format::r8g8b8x8_unorm:
-				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
-				if (view_format == api::format::r8g8b8x8_unorm)
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-						pixels[x + 3] = 0xFF;
-				break;
-			case api::format::b8g8r8a8_unorm:
-			case api::format::b8g8r8x8_unorm:
-				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
-				// Format is BGRA, but output should be RGBA, so flip channels
-				for (size_t x = 0; x < pixels_row_pitch; x += 4)
-					std::swap(pixels[x + 0], pixels[x + 2]);
-				if (view_format == api::format::b8g8r8x8_unorm)
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-						pixels[x + 3] = 0xFF;
-				break;
-			case api::format::r10g10b10a2_unorm:
-			case api::format::b10g10r10a2_unorm:
-				// SDR: Quantize the image down to 8-bpc for compatibility with standard screenshot formats
-				if (_back_buffer_color_space != api::color_space::hdr10_st2084)
-				{
-					for (size_t x = 0; x < pixels_row_pitch; x += 4)
-					{
-						const uint32_t rgba = *reinterpret_cast<const uint32_t *>(mapped_pixels + x);
-						// Divide by 4 to get 10-bit range (0-1023) into 8-bit range (0-255)
-						pixels[x + 0] = (( rgba & 0x000003FF)        /  4) & 0xFF;
-						pixels[x + 1] = (((rgba & 0x000FFC00) >> 10) /  4) & 0xFF;
-						pixels[x + 2] = (((rgba & 0x3FF00000) >> 20) /  4) & 0xFF;
-						pixels[x + 3] = (((rgba & 0xC0000000) >> 30) * 85) & 0xFF;
-						if (view_format == api::format::b10g10r10a2_unorm)
-							std::swap(pixels[x + 0], pixels[x + 2]);
-					}
-				}
-				// HDR10: Keep the original data, do not convert to 8-bpc
-				else
-				{
-					std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
-				}
-				break;
-			case api::format::r16g16b16a16_float:
-				// FP16 is implicitly always scRGB
-				assert(_back_buffer_color_space == api::color_space::extended_srgb_linear);
-				std::memcpy(pixels, mapped_pixels, pixels_row_pitch);
-				break;
+				assert(view_format != api::format::r16g16b16a16_float || _back_buffer_color_space == api::color_space::extended_srgb_linear);
+				std::memcpy(row_pixels, mapped_pixels, pixels_row_pitch);
+			}
+			// SDR: Quantize the image down to 8-bpc RGBA for compatibility with standard screenshot formats
+			else
+			{
+				format_conversion::convert_row_to_rgba8(view_format, mapped_pixels, row_pixels, width);
 			}
 		}
 
-		_device->unmap_texture_region(intermediate, 0);
+		if (map_here)
+			_device->unmap_texture_region(readback.intermediate, 0);
 	}
 
-	_device->destroy_resource(intermediate);
+	const std::function<void(std::vector<uint8_t> &&pixels)> callback = std::move(readback.callback);
+	readback.callback = nullptr;
 
-	return mapped_data.data != nullptr;
+	// Release the entry before invoking the callback, since the intermediate texture is no longer needed
+	{
+		const std::unique_lock<std::mutex> lock(_texture_readback_mutex);
+		readback.state = texture_readback_state::processed;
+	}
+	_texture_readback_cv.notify_all();
+
+	callback(std::move(pixels));
+}
+void reshade::runtime::destroy_texture_readbacks()
+{
+	for (texture_readback &readback : _texture_readbacks)
+	{
+		assert(readback.state == texture_readback_state::idle && readback.mapped_data.data == nullptr);
+
+		_device->destroy_resource(readback.intermediate);
+		readback.intermediate = {};
+		readback.intermediate_desc = {};
+		_device->destroy_fence(readback.fence);
+		readback.fence = {};
+		readback.fence_value = 0;
+	}
 }
@@ -8,8 +8,10 @@
 #include "reshade_api.hpp"
 #include "state_block.hpp"
 #include "imgui_code_editor.hpp"
+#include "thread_pool.hpp"
 #include <chrono>
 #include <memory>
+#include <map>
 #include <filesystem>
 #include <atomic>
 #include <shared_mutex>
@@ -23,6 +25,7 @@ namespace reshade
 	struct uniform;
 	struct texture;
 	struct technique;
+	class effect_cache_archive;
 
 	/// <summary>
 	/// The main ReShade post-processing effect runtime.
@@ -189,6 +192,7 @@ namespace reshade
 		void load_textures(size_t effect_index);
 		bool create_texture(texture &texture);
 		void destroy_texture(texture &texture);
+		bool is_texture_aliased(const texture &texture) const;
 
 		void enable_technique(technique &technique);
 		void disable_technique(technique &technique);
@@ -233,8 +237,15 @@ namespace reshade
 
 		bool get_preprocessor_definition(const std::string &effect_name, const std::string &name, int scope_mask, std::vector<std::pair<std::string, std::string>> *&scope, std::vector<std::pair<std::string, std::string>>::iterator &value) const;
 
+		struct texture_readback;
+
 		bool get_texture_data(api::resource resource, api::resource_usage state, uint8_t *pixels);
+		texture_readback *queue_texture_readback(api::resource resource, api::resource_usage state, std::function<void(std::vector<uint8_t> &&pixels)> callback, bool screenshot = false);
+		void update_texture_readbacks(bool wait_for_completion = false);
+		void process_texture_readback(texture_readback &readback);
+		void destroy_texture_readbacks();
 
+		void finish_screenshot_save(const std::filesystem::path &screenshot_path, unsigned int screenshot_count, std::string_view postfix, bool include_preset, bool save_success);
 		bool execute_screenshot_post_save_command(const std::filesystem::path &screenshot_path, unsigned int screenshot_count, std::string_view postfix);
 
 		api::swapchain *const _swapchain;
@@ -270,6 +281,8 @@ namespace reshade
 
 		bool _effects_enabled = true;
 		bool _effects_rendered_this_frame = false;
+		size_t _last_pushed_uniforms_effect_index = std::numeric_limits<size_t>::max();
+		bool _back_buffer_copy_up_to_date = false;
 		unsigned int _effects_key_data[4] = {};
 
 		std::chrono::system_clock::time_point _current_time;
@@ -281,9 +294,11 @@ namespace reshade
 		#pragma region Effect Loading
 		bool _no_debug_info = true;
 		bool _no_effect_cache = false;
+		bool _packed_effect_cache = false;
 		bool _no_reload_on_init = false;
 		bool _performance_mode = false;
 		bool _effect_load_skipping = false;
+		unsigned int _effect_creation_budget = 10;
 		unsigned int _reload_key_data[4] = {};
 		unsigned int _performance_mode_key_data[4] = {};
 
@@ -292,12 +307,14 @@ namespace reshade
 		std::vector<std::pair<size_t, size_t>> _reload_required_effects;
 
 		std::filesystem::path _effect_cache_path;
+		std::unique_ptr<effect_cache_archive> _effect_cache_archive;
 		std::vector<std::filesystem::path> _effect_search_paths;
 		std::vector<std::filesystem::path> _texture_search_paths;
 
 		std::atomic<bool> _last_reload_successful = true;
 		std::shared_mutex _reload_mutex;
 		std::vector<std::pair<size_t, size_t>> _reload_create_queue;
+		size_t _reload_created_effects = 0;
 		std::atomic<size_t> _reload_remaining_effects = std::numeric_limits<size_t>::max();
 		void *_d3d_compiler_module = nullptr;
 
@@ -306,7 +323,11 @@ namespace reshade
 		std::vector<technique> _techniques;
 		std::vector<size_t> _technique_sorting;
 
-		std::vector<std::thread> _worker_threads;
+		thread_pool _worker_threads;
+		thread_pool::task_group _load_tasks;
+		thread_pool::task_group _save_tasks;
+		thread_pool::task_group _create_tasks;
+		std::map<std::filesystem::path, std::chrono::high_resolution_clock::duration> _last_load_durations;
 		std::chrono::high_resolution_clock::time_point _last_reload_time;
 		#pragma endregion
 
@@ -369,6 +390,35 @@ namespace reshade
 		bool _screenshot_directory_creation_successful = true;
 		std::filesystem::path _last_screenshot_file;
 		std::chrono::high_resolution_clock::time_point _last_screenshot_time;
+		std::mutex _screenshot_save_mutex;
+		std::condition_variable _screenshot_save_cv;
+		unsigned int _screenshot_saves_pending = 0;
+
+		enum class texture_readback_state
+		{
+			idle,
+			copying, // Waiting for the copy to the intermediate texture to finish on the GPU
+			processing, // Worker thread is reading the intermediate texture
+			processed // Worker thread finished reading, but the intermediate texture still has to be unmapped on the render thread
+		};
+		struct texture_readback
+		{
+			api::resource intermediate = {};
+			api::resource_desc intermediate_desc;
+			api::fence fence = {};
+			uint64_t fence_value = 0;
+			uint64_t submit_index = 0;
+			api::subresource_data mapped_data = {};
+			bool screenshot = false; // Counts towards the limit of pending screenshot saves once handed off
+			std::atomic<texture_readback_state> state = texture_readback_state::idle;
+			std::function<void(std::vector<uint8_t> &&pixels)> callback;
+		};
+		// Keep a small ring of intermediate textures around, so that bursts of captures neither have to create new resources nor wait on each other
+		// This is a fixed array, since worker threads reference the entries while they are being processed
+		texture_readback _texture_readbacks[8];
+		uint64_t _texture_readback_submit_index = 0;
+		std::mutex _texture_readback_mutex;
+		std::condition_variable _texture_readback_cv;
 		#pragma endregion
 
 		#pragma region Preset Switching
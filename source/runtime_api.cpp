@@ -1360,6 +1360,9 @@ void reshade::runtime::render_technique(api::effect_technique handle, api::comma
 	_is_in_api_call = true;
 #endif
 
+	_last_pushed_uniforms_effect_index = std::numeric_limits<size_t>::max();
+	_back_buffer_copy_up_to_date = false;
+
 	render_technique(*tech, cmd_list, back_buffer_resource, rtv, rtv_srgb, permutation_index);
 
 #if RESHADE_ADDON
@@ -1160,6 +1160,12 @@ void reshade::runtime::draw_gui()
 					"This might take a while. The application could become unresponsive for some time."),
 					_reload_remaining_effects.load());
 			}
+			else if (!_reload_create_queue.empty() && _reload_remaining_effects == std::numeric_limits<size_t>::max())
+			{
+				ImGui::ProgressBar(_reload_created_effects / float(_reload_created_effects + _reload_create_queue.size()), ImVec2(ImGui::GetContentRegionAvail().x, 0), "");
+				ImGui::SameLine(15);
+				ImGui::Text(_("Creating (%zu effects remaining) ..."), _reload_create_queue.size());
+			}
 			else
 			{
 				ImGui::ProgressBar(0.0f, ImVec2(ImGui::GetContentRegionAvail().x, 0), "");
@@ -2753,6 +2759,44 @@ void reshade::runtime::draw_gui_statistics()
 		ImGui::EndGroup();
 	}
 
+	if (ImGui::CollapsingHeader(_("Effect Compilation")) && !is_loading())
+	{
+		ImGui::BeginGroup();
+
+		for (const effect &effect : _effects)
+			if (!effect.skipped)
+				ImGui::TextUnformatted(effect.source_file.filename().u8string().c_str());
+
+		ImGui::EndGroup();
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.33333333f);
+		ImGui::BeginGroup();
+
+		for (const effect &effect : _effects)
+			if (!effect.skipped)
+				ImGui::Text("%7.3f | %7.3f | %7.3f ms",
+					effect.statistics.preprocess_duration * 1e-6f,
+					effect.statistics.parse_duration * 1e-6f,
+					effect.statistics.codegen_duration * 1e-6f);
+
+		ImGui::EndGroup();
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip(_("Time spent preprocessing, parsing and generating code (zero if loaded from cache)"));
+		ImGui::SameLine(ImGui::GetWindowWidth() * 0.66666666f);
+		ImGui::BeginGroup();
+
+		for (const effect &effect : _effects)
+			if (!effect.skipped)
+				ImGui::Text("%zu | %zu | %zu | %zu",
+					effect.statistics.num_preprocessed_tokens,
+					effect.statistics.num_macro_expansions,
+					effect.statistics.num_parsed_tokens,
+					effect.statistics.num_instructions);
+
+		ImGui::EndGroup();
+		if (ImGui::IsItemHovered())
+			ImGui::SetTooltip(_("Preprocessed tokens, macro expansions, parsed tokens and emitted instructions"));
+	}
+
 	if (ImGui::CollapsingHeader(_("Render Targets & Textures"), ImGuiTreeNodeFlags_DefaultOpen) && !is_loading())
 	{
 		const auto texture_format_info = [](reshadefx::texture_format format) -> std::pair<const char *, int> {
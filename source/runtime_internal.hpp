@@ -7,6 +7,7 @@
 
 #include "effect_module.hpp"
 #include "moving_average.hpp"
+#include <algorithm>
 
 namespace reshade
 {
@@ -72,6 +73,8 @@ namespace reshade
 
 		std::vector<size_t> shared;
 		bool loaded = false;
+		// Texture is only used within a single technique and always fully overwritten there before it is read, so its contents do not need to persist and its memory can be aliased with other transient textures
+		bool transient = false;
 
 		api::resource resource = {};
 		api::resource_view srv[2] = {};
@@ -195,6 +198,7 @@ namespace reshade
 			api::descriptor_table storage_table = {};
 			std::vector<api::resource> modified_resources;
 			std::vector<api::resource_view> generate_mipmap_views;
+			bool samples_back_buffer = false;
 
 			moving_average<uint64_t, 60> average_gpu_duration;
 		};
@@ -224,10 +228,65 @@ namespace reshade
 		std::vector<std::filesystem::path> included_files;
 		std::vector<std::pair<std::string, std::string>> definitions;
 
+		struct compile_statistics
+		{
+			uint64_t preprocess_duration = 0;
+			uint64_t parse_duration = 0;
+			uint64_t codegen_duration = 0;
+			size_t num_preprocessed_tokens = 0;
+			size_t num_macro_expansions = 0;
+			size_t num_parsed_tokens = 0;
+			size_t num_instructions = 0;
+		};
+
+		// Only updated for the phases that were actually run, rather than loaded from the effect cache
+		compile_statistics statistics;
+
 		std::vector<uniform> uniforms;
 		std::vector<uint8_t> uniform_data_storage;
+		// Byte range of the uniform data storage that changed since it was last uploaded
+		size_t uniform_data_dirty_begin = 0;
+		size_t uniform_data_dirty_end = 0;
 		api::resource cb = {};
 
+		void mark_uniform_data_dirty(size_t offset, size_t size)
+		{
+			if (uniform_data_dirty_begin == uniform_data_dirty_end)
+			{
+				uniform_data_dirty_begin = offset;
+				uniform_data_dirty_end = offset + size;
+			}
+			else
+			{
+				uniform_data_dirty_begin = std::min(uniform_data_dirty_begin, offset);
+				uniform_data_dirty_end = std::max(uniform_data_dirty_end, offset + size);
+			}
+		}
+
+		struct special_uniform_update
+		{
+			enum class input_mode
+			{
+				down,
+				press,
+				toggle
+			};
+
+			special_uniform special = special_uniform::none;
+			size_t uniform_index = 0;
+
+			// Annotation values are resolved once when the effect is loaded, so they do not have to be looked up every frame
+			int keycode = 0;
+			input_mode mode = input_mode::down;
+			int int_range[2] = {};
+			float float_range[2] = {};
+			float step[2] = {};
+			float smoothing = 0.0f;
+		};
+
+		// Flat list of the special uniform variables in this effect that are updated every frame
+		std::vector<special_uniform_update> special_uniform_updates;
+
 		struct binding
 		{
 			std::string semantic;
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm> // std::max, std::find
+
+namespace reshade
+{
+	/// <summary>
+	/// Linear per-thread allocator for short-lived temporary arrays, so that hooks do not need to call into the heap while the application is recording commands.
+	/// Allocations have to be released in reverse order (which scoped objects like <see cref="temp_mem"/> guarantee), so the arena rewinds on its own once the outermost allocation of a call was released and never needs to be reset explicitly.
+	/// Requests that do not fit into the remaining space of the arena fail, in which case callers should fall back to the heap.
+	/// </summary>
+	class temp_mem_arena
+	{
+	public:
+		static constexpr size_t capacity = 256 * 1024;
+
+		struct statistics
+		{
+			uint64_t arena_allocations;
+			uint64_t heap_allocations;
+			size_t peak_usage;
+		};
+
+		/// <summary>
+		/// Allocates <paramref name="size"/> bytes with the specified <paramref name="alignment"/> from the arena of the calling thread.
+		/// </summary>
+		/// <param name="mark">Receives the position to pass to <see cref="release"/> to free this allocation again.</param>
+		/// <returns>Pointer to the allocated memory, or <see langword="nullptr"/> if the arena is exhausted.</returns>
+		static void *allocate(size_t size, size_t alignment, size_t &mark)
+		{
+			thread_arena &arena = s_thread_arena;
+
+			// The arena memory is only allocated once a thread actually needs it, since most threads in an application never call into a hook
+			if (arena.base == nullptr && !arena.initialize())
+			{
+				increment(arena.heap_allocations);
+				return nullptr;
+			}
+
+			// Align the actual address rather than the offset, since the arena memory itself is only aligned for fundamental types
+			const uintptr_t base_address = reinterpret_cast<uintptr_t>(arena.base);
+			const size_t offset = ((base_address + arena.top + alignment - 1) & ~(alignment - 1)) - base_address;
+			if (offset > capacity || size > capacity - offset)
+			{
+				increment(arena.heap_allocations);
+				return nullptr;
+			}
+
+			mark = arena.top;
+			arena.top = offset + size;
+
+			increment(arena.arena_allocations);
+			if (arena.top > arena.peak_usage.load(std::memory_order_relaxed))
+				arena.peak_usage.store(arena.top, std::memory_order_relaxed);
+
+			return arena.base + offset;
+		}
+
+		/// <summary>
+		/// Frees an allocation previously made with <see cref="allocate"/> on the same thread, along with any allocations made after it.
+		/// </summary>
+		static void release(size_t mark)
+		{
+			s_thread_arena.top = mark;
+		}
+
+		/// <summary>
+		/// Gets statistics about how often temporary allocations were served from the arena or had to fall back to the heap, accumulated across all threads (including those that already exited).
+		/// </summary>
+		static statistics get_statistics()
+		{
+			arena_registry &registry = get_registry();
+			const std::lock_guard<std::mutex> lock(registry.mutex);
+
+			statistics stats = registry.retired_statistics;
+			for (const thread_arena *const arena : registry.live_arenas)
+				arena->add_statistics(stats);
+			return stats;
+		}
+
+	private:
+		// Counters are only ever written by the thread owning the arena, so that allocations do not contend on shared cache lines, but are atomic so that other threads can read them while collecting statistics
+		struct thread_arena
+		{
+			~thread_arena()
+			{
+				if (base == nullptr)
+					return;
+
+				{
+					arena_registry &registry = get_registry();
+					const std::lock_guard<std::mutex> lock(registry.mutex);
+
+					add_statistics(registry.retired_statistics);
+					registry.live_arenas.erase(std::find(registry.live_arenas.begin(), registry.live_arenas.end(), this));
+				}
+
+				::operator delete(base);
+			}
+
+			bool initialize()
+			{
+				base = static_cast<uint8_t *>(::operator new(capacity, std::nothrow));
+				if (base == nullptr)
+					return false;
+
+				arena_registry &registry = get_registry();
+				const std::lock_guard<std::mutex> lock(registry.mutex);
+				registry.live_arenas.push_back(this);
+				return true;
+			}
+
+			void add_statistics(statistics &stats) const
+			{
+				stats.arena_allocations += arena_allocations.load(std::memory_order_relaxed);
+				stats.heap_allocations += heap_allocations.load(std::memory_order_relaxed);
+				stats.peak_usage = std::max(stats.peak_usage, peak_usage.load(std::memory_order_relaxed));
+			}
+
+			uint8_t *base = nullptr;
+			size_t top = 0;
+			std::atomic<uint64_t> arena_allocations = 0;
+			std::atomic<uint64_t> heap_allocations = 0;
+			std::atomic<size_t> peak_usage = 0;
+		};
+
+		struct arena_registry
+		{
+			std::mutex mutex;
+			std::vector<const thread_arena *> live_arenas;
+			statistics retired_statistics = {};
+		};
+
+		static arena_registry &get_registry()
+		{
+			// This is never destroyed, since threads may still exit (and unregister their arena) after static destructors ran
+			static arena_registry *const registry = new arena_registry();
+			return *registry;
+		}
+
+		static void increment(std::atomic<uint64_t> &counter)
+		{
+			// Only the owning thread writes the counter, so a plain load and store is enough and avoids a locked read-modify-write instruction
+			counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		static thread_local thread_arena s_thread_arena;
+	};
+
+	inline thread_local temp_mem_arena::thread_arena temp_mem_arena::s_thread_arena;
+}
@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause OR MIT
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <algorithm> // std::max, std::find_if
+#include <functional>
+#include <condition_variable>
+
+/// <summary>
+/// A bounded pool of worker threads that execute queued tasks.
+/// Each worker has its own task queue, which it processes front to back, and idle workers steal tasks from the back of the queues of busy workers.
+/// </summary>
+class thread_pool
+{
+public:
+	/// <summary>
+	/// Keeps track of the number of tasks submitted to a pool that did not finish yet, so that these can be waited on separately from other tasks.
+	/// </summary>
+	class task_group
+	{
+		friend class thread_pool;
+
+	public:
+		bool empty() const { return _pending == 0; }
+
+	private:
+		std::atomic<size_t> _pending = 0;
+	};
+
+	/// <summary>
+	/// Creates a pool with the specified maximum number of worker threads.
+	/// Threads are only launched when the first task is submitted.
+	/// </summary>
+	explicit thread_pool(size_t num_threads) :
+		_queues(std::max(num_threads, static_cast<size_t>(1)))
+	{
+	}
+	~thread_pool()
+	{
+		{
+			const std::unique_lock<std::mutex> lock(_wake_mutex);
+			_stop = true;
+		}
+		_wake_cv.notify_all();
+
+		// Workers drain all remaining tasks before exiting
+		for (std::thread &thread : _threads)
+			thread.join();
+	}
+
+	thread_pool(const thread_pool &) = delete;
+	thread_pool &operator=(const thread_pool &) = delete;
+
+	/// <summary>
+	/// Gets the maximum number of worker threads in this pool.
+	/// </summary>
+	size_t num_threads() const { return _queues.size(); }
+
+	/// <summary>
+	/// Queues a task to be executed by a worker thread.
+	/// Tasks are distributed round-robin over the worker queues, so submitting a batch in descending order of cost has every worker start with the most expensive ones.
+	/// </summary>
+	/// <param name="group">Group to add this task to.</param>
+	/// <param name="task">Function to execute.</param>
+	void submit(task_group &group, std::function<void()> task)
+	{
+		group._pending++;
+
+		worker_queue &queue = _queues[_next_queue++ % _queues.size()];
+		{
+			const std::unique_lock<std::mutex> lock(queue.mutex);
+			queue.tasks.push_back({ &group, std::move(task) });
+		}
+
+		{
+			const std::unique_lock<std::mutex> lock(_wake_mutex);
+			_num_queued++;
+
+			// Launch threads lazily, so that pools that are never used do not cost anything
+			if (_threads.size() < _queues.size() && _num_queued > _num_idle)
+				_threads.emplace_back(&thread_pool::worker_main, this, _threads.size());
+		}
+		_wake_cv.notify_one();
+	}
+
+	/// <summary>
+	/// Blocks the calling thread until all tasks in the specified <paramref name="group"/> have finished executing.
+	/// </summary>
+	void wait(task_group &group)
+	{
+		std::unique_lock<std::mutex> lock(_done_mutex);
+		_done_cv.wait(lock, [&group]() { return group._pending == 0; });
+	}
+	/// <summary>
+	/// Blocks the calling thread until all tasks in the specified <paramref name="group"/> have finished executing, while executing tasks of that group which are still queued on the calling thread.
+	/// This avoids having to wait for workers that are busy with long-running tasks from other groups to get to them.
+	/// </summary>
+	void wait_and_execute(task_group &group)
+	{
+		task current_task;
+		while (try_take(group, current_task))
+			execute(current_task);
+
+		// All remaining tasks of the group are already being executed by workers at this point
+		wait(group);
+	}
+
+private:
+	struct task
+	{
+		task_group *group;
+		std::function<void()> function;
+	};
+	struct worker_queue
+	{
+		std::mutex mutex;
+		std::deque<task> tasks;
+	};
+
+	bool try_pop(size_t queue_index, task &result)
+	{
+		// Pop from the front of the own queue first, so that tasks are executed in submission order
+		{
+			worker_queue &queue = _queues[queue_index];
+
+			const std::unique_lock<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				result = std::move(queue.tasks.front());
+				queue.tasks.pop_front();
+				return true;
+			}
+		}
+
+		// Then try to steal from the back of the other queues
+		for (size_t i = 1; i < _queues.size(); ++i)
+		{
+			worker_queue &queue = _queues[(queue_index + i) % _queues.size()];
+
+			const std::unique_lock<std::mutex> lock(queue.mutex);
+			if (!queue.tasks.empty())
+			{
+				result = std::move(queue.tasks.back());
+				queue.tasks.pop_back();
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool try_take(task_group &group, task &result)
+	{
+		// Reserve a queued task first, so that a worker that was woken up for it does not end up waiting for a task that no longer exists
+		{
+			const std::unique_lock<std::mutex> lock(_wake_mutex);
+			if (_num_queued == 0)
+				return false;
+			_num_queued--;
+		}
+
+		for (worker_queue &queue : _queues)
+		{
+			const std::unique_lock<std::mutex> lock(queue.mutex);
+
+			if (const auto it = std::find_if(queue.tasks.begin(), queue.tasks.end(), [&group](const task &item) { return item.group == &group; });
+				it != queue.tasks.end())
+			{
+				result = std::move(*it);
+				queue.tasks.erase(it);
+				return true;
+			}
+		}
+
+		// No task of this group is queued, so give the reservation back to the workers
+		{
+			const std::unique_lock<std::mutex> lock(_wake_mutex);
+			_num_queued++;
+		}
+		_wake_cv.notify_one();
+
+		return false;
+	}
+
+	void execute(task &current_task)
+	{
+		current_task.function();
+
+		if (--current_task.group->_pending == 0)
+		{
+			const std::unique_lock<std::mutex> lock(_done_mutex);
+			_done_cv.notify_all();
+		}
+	}
+
+	void worker_main(size_t queue_index)
+	{
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(_wake_mutex);
+				_num_idle++;
+				_wake_cv.wait(lock, [this]() { return _num_queued != 0 || _stop; });
+				_num_idle--;
+
+				if (_num_queued == 0)
+				{
+					assert(_stop);
+					break;
+				}
+
+				_num_queued--;
+			}
+
+			// A task was reserved above, so one of the queues is guaranteed to contain it
+			task current_task;
+			while (!try_pop(queue_index, current_task))
+				std::this_thread::yield();
+
+			execute(current_task);
+		}
+	}
+
+	std::vector<worker_queue> _queues;
+	std::vector<std::thread> _threads;
+	std::atomic<size_t> _next_queue = 0;
+
+	std::mutex _wake_mutex;
+	std::condition_variable _wake_cv;
+	size_t _num_queued = 0;
+	size_t _num_idle = 0;
+	bool _stop = false;
+
+	std::mutex _done_mutex;
+	std::condition_variable _done_cv;
+};
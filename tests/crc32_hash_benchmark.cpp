@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "crc32_hash.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace crc32_hash;
+
+static uint32_t crc32_bytewise(const uint8_t *data, size_t size)
+{
+	return ~internal::update_crc32_bytewise(~0u, data, size);
+}
+static uint32_t crc32_slicing_by_8(const uint8_t *data, size_t size)
+{
+	return ~internal::update_crc32_slicing_by_8(~0u, data, size);
+}
+static uint32_t crc32_pclmul(const uint8_t *data, size_t size)
+{
+	uint32_t crc = ~0u;
+	if (size >= 64)
+	{
+		const size_t folded_size = size & ~static_cast<size_t>(15);
+		crc = internal::update_crc32_pclmul(crc, data, folded_size);
+		data += folded_size;
+		size -= folded_size;
+	}
+	return ~internal::update_crc32_bytewise(crc, data, size);
+}
+
+// Hashes the data until the minimum duration has passed and returns the throughput in megabytes per second
+template <typename F>
+static double measure(F function, const uint8_t *data, size_t size, double min_seconds)
+{
+	using clock = std::chrono::steady_clock;
+
+	size_t bytes = 0;
+	uint64_t sink = 0;
+	const clock::time_point start = clock::now();
+	double elapsed = 0;
+
+	do
+	{
+		for (size_t i = 0, n = 1 + (1 << 20) / (size + 1); i < n; ++i)
+			sink += function(data, size);
+		bytes += (1 + (1 << 20) / (size + 1)) * size;
+		elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	} while (elapsed < min_seconds);
+
+	// Prevent the compiler from optimizing the calls away
+	volatile uint64_t result = sink;
+	(void)result;
+
+	return bytes / elapsed / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+	const double min_seconds = argc > 1 ? std::atof(argv[1]) : 0.05;
+
+	bool success = true;
+	const auto check = [&success](bool condition, const char *message, size_t size) {
+		if (!condition)
+		{
+			std::fprintf(stderr, "error: %s (size %zu)\n", message, size);
+			success = false;
+		}
+	};
+
+	// Known answers for the standard check string
+	const uint8_t check_string[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+	check(compute_crc32(check_string, sizeof(check_string)) == 0xCBF43926, "CRC-32 of check string is wrong", sizeof(check_string));
+	check(compute_hash64(nullptr, 0) == 0xEF46DB3751D8E999, "XXH64 of empty input is wrong", 0);
+	check(compute_hash64(reinterpret_cast<const uint8_t *>("abc"), 3) == 0x44BC2CF5AD770999, "XXH64 of 'abc' is wrong", 3);
+
+	const bool pclmul = internal::has_pclmul();
+
+	std::mt19937 random(42);
+	std::vector<uint8_t> data(16 * 1024 * 1024 + 64);
+	for (uint8_t &value : data)
+		value = static_cast<uint8_t>(random());
+
+	// Verify that every implementation produces the same checksum as the bytewise reference, for all sizes around the folding boundaries and at unaligned addresses
+	for (size_t size = 0; size <= 300; ++size)
+	{
+		for (size_t offset = 0; offset < 4; ++offset)
+		{
+			const uint8_t *const p = data.data() + offset;
+			const uint32_t reference = crc32_bytewise(p, size);
+			check(crc32_slicing_by_8(p, size) == reference, "slicing-by-8 does not match bytewise CRC-32", size);
+			if (pclmul)
+				check(crc32_pclmul(p, size) == reference, "PCLMULQDQ does not match bytewise CRC-32", size);
+			check(compute_crc32(p, size) == reference, "compute_crc32 does not match bytewise CRC-32", size);
+
+			// Checksumming data in two blocks has to produce the same result as checksumming it at once
+			const size_t split = size / 3;
+			check(compute_crc32(p + split, size - split, compute_crc32(p, split)) == reference, "incremental compute_crc32 does not match", size);
+		}
+	}
+
+	std::printf("%-10s %10s %10s %10s %10s %10s   (megabytes per second)\n", "size", "bytewise", "slicing8", "pclmul", "crc32", "hash64");
+
+	for (const size_t size : { 16, 64, 256, 1024, 4096, 65536, 1024 * 1024, 16 * 1024 * 1024 })
+	{
+		const uint8_t *const p = data.data();
+
+		check(crc32_slicing_by_8(p, size) == crc32_bytewise(p, size), "slicing-by-8 does not match bytewise CRC-32", size);
+		if (pclmul)
+			check(crc32_pclmul(p, size) == crc32_bytewise(p, size), "PCLMULQDQ does not match bytewise CRC-32", size);
+
+		std::printf("%-10zu %10.1f %10.1f", size, measure(crc32_bytewise, p, size, min_seconds), measure(crc32_slicing_by_8, p, size, min_seconds));
+		if (pclmul)
+			std::printf(" %10.1f", measure(crc32_pclmul, p, size, min_seconds));
+		else
+			std::printf(" %10s", "n/a");
+		std::printf(" %10.1f %10.1f\n",
+			measure([](const uint8_t *data, size_t size) { return compute_crc32(data, size); }, p, size, min_seconds),
+			measure([](const uint8_t *data, size_t size) { return compute_hash64(data, size); }, p, size, min_seconds));
+	}
+
+	return success ? 0 : 1;
+}
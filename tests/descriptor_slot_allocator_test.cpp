@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "descriptor_slot_allocator.hpp"
+#include <memory>
+#include <thread>
+#include <random>
+#include <cstdio>
+#include <condition_variable>
+
+using namespace reshade;
+
+static std::atomic<int> s_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+			++s_failures; \
+		} \
+	} while (0)
+
+static bool add_pool(descriptor_slot_allocator &allocator)
+{
+	return allocator.add_pool();
+}
+
+static void test_pools()
+{
+	CHECK(descriptor_slot_allocator::pool_of_slot(0) == 0);
+	CHECK(descriptor_slot_allocator::pool_of_slot(1023) == 0);
+	CHECK(descriptor_slot_allocator::pool_of_slot(1024) == 1);
+	CHECK(descriptor_slot_allocator::pool_of_slot(3071) == 1);
+	CHECK(descriptor_slot_allocator::pool_of_slot(3072) == 2);
+	for (uint32_t pool = 0; pool < descriptor_slot_allocator::max_pools; ++pool)
+	{
+		CHECK(descriptor_slot_allocator::pool_of_slot(descriptor_slot_allocator::pool_first_slot(pool)) == pool);
+		CHECK(descriptor_slot_allocator::pool_of_slot(descriptor_slot_allocator::pool_first_slot(pool) + descriptor_slot_allocator::pool_size(pool) - 1) == pool);
+	}
+
+	descriptor_slot_allocator allocator;
+
+	uint32_t slots[4096];
+	CHECK(allocator.allocate(slots, 1) == 0);
+
+	CHECK(allocator.add_pool());
+	CHECK(allocator.allocate(slots, 4096) == 1024);
+	for (uint32_t i = 0; i < 1024; ++i)
+		CHECK(slots[i] == i);
+	CHECK(allocator.used_count() == 1024);
+
+	CHECK(allocator.add_pool());
+	CHECK(allocator.allocate(slots, 1) == 1 && slots[0] == 1024);
+
+	// Freed slots in smaller pools are preferred over free slots in larger ones
+	const uint32_t freed[] = { 700, 5, 1024 };
+	allocator.free(freed, 3);
+	CHECK(allocator.used_count() == 1022);
+	CHECK(allocator.allocate(slots, 3) == 3 && slots[0] == 5 && slots[1] == 700 && slots[2] == 1024);
+
+	while (allocator.add_pool())
+		continue;
+	CHECK(allocator.pool_count() == descriptor_slot_allocator::max_pools);
+}
+
+static void test_concurrent_allocate_free()
+{
+	concurrent_descriptor_slot_allocator allocator(0);
+
+	// Tracks which slots are handed out, to detect a slot being allocated twice
+	const size_t max_slots = descriptor_slot_allocator::pool_first_slot(descriptor_slot_allocator::max_pools);
+	const std::unique_ptr<std::atomic<uint8_t>[]> owned(new std::atomic<uint8_t>[max_slots]());
+
+	const auto worker = [&](unsigned int seed) {
+		std::mt19937 random(seed);
+		std::vector<uint32_t> held;
+
+		for (int i = 0; i < 200000; ++i)
+		{
+			if (held.empty() || (random() % 8) < (held.size() < 2000 ? 5u : 3u))
+			{
+				uint32_t slot;
+				if (allocator.allocate(slot, add_pool))
+				{
+					CHECK(slot < max_slots && owned[slot].exchange(1) == 0);
+					held.push_back(slot);
+				}
+				else
+				{
+					CHECK(false);
+				}
+			}
+			else
+			{
+				const size_t index = random() % held.size();
+				const uint32_t slot = held[index];
+				held[index] = held.back();
+				held.pop_back();
+
+				CHECK(owned[slot].exchange(0) == 1);
+				allocator.free(slot);
+			}
+		}
+
+		for (const uint32_t slot : held)
+		{
+			CHECK(owned[slot].exchange(0) == 1);
+			allocator.free(slot);
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (unsigned int i = 0; i < 8; ++i)
+		threads.emplace_back(worker, 100 + i);
+	for (std::thread &thread : threads)
+		thread.join();
+
+	// All threads freed everything they allocated, so once they exited (which returns the slots left in their caches), nothing may be in use anymore
+	CHECK(allocator.used_count() == 0);
+}
+
+static void test_cross_thread_free()
+{
+	concurrent_descriptor_slot_allocator allocator(1);
+
+	std::vector<uint32_t> slots(5000);
+	std::thread([&]() {
+		for (uint32_t &slot : slots)
+			CHECK(allocator.allocate(slot, add_pool));
+	}).join();
+
+	CHECK(allocator.used_count() >= slots.size());
+
+	std::thread([&]() {
+		for (const uint32_t slot : slots)
+			allocator.free(slot);
+	}).join();
+
+	CHECK(allocator.used_count() == 0);
+}
+
+static void test_cache_handover()
+{
+	concurrent_descriptor_slot_allocator allocator_a(2);
+	concurrent_descriptor_slot_allocator allocator_b(2);
+
+	std::thread([&]() {
+		uint32_t slot_a, slot_b;
+		CHECK(allocator_a.allocate(slot_a, add_pool));
+		allocator_a.free(slot_a);
+		CHECK(allocator_a.used_count() != 0); // Still held in the cache of this thread
+
+		// Using another allocator with the same cache index returns the cached slots of the previous one
+		CHECK(allocator_b.allocate(slot_b, add_pool));
+		CHECK(allocator_a.used_count() == 0);
+		allocator_b.free(slot_b);
+	}).join();
+
+	CHECK(allocator_a.used_count() == 0);
+	CHECK(allocator_b.used_count() == 0);
+}
+
+static void test_owner_destroyed_before_thread_exit()
+{
+	auto allocator = std::make_unique<concurrent_descriptor_slot_allocator>(3);
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	int stage = 0;
+
+	std::thread thread([&]() {
+		uint32_t slot;
+		CHECK(allocator->allocate(slot, add_pool));
+		allocator->free(slot);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		stage = 1;
+		cv.notify_one();
+		cv.wait(lock, [&]() { return stage == 2; });
+		// Slots still in the cache of this thread have to be discarded on exit, since their owner no longer exists
+	});
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&]() { return stage == 1; });
+		allocator.reset();
+		stage = 2;
+		cv.notify_one();
+	}
+
+	thread.join();
+}
+
+int main()
+{
+	test_pools();
+	test_concurrent_allocate_free();
+	test_cross_thread_free();
+	test_cache_handover();
+	test_owner_destroyed_before_thread_exit();
+
+	if (s_failures != 0)
+		std::fprintf(stderr, "%d check(s) failed\n", s_failures.load());
+	return s_failures == 0 ? 0 : 1;
+}
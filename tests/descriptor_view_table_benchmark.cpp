@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "descriptor_view_table.hpp"
+#include <mutex>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <random>
+#include <vector>
+#include <algorithm>
+#include <shared_mutex>
+#include <unordered_map>
+
+using namespace reshade;
+
+using resource_handle = uintptr_t;
+
+// How resource views were tracked before the view table, which is what the device still falls back to for handles the table cannot represent
+struct locked_view_map
+{
+	bool insert(uint64_t handle, resource_handle resource, const api::resource_view_desc &desc)
+	{
+		const std::unique_lock<std::shared_mutex> lock(mutex);
+		views.insert_or_assign(handle, std::make_pair(resource, desc));
+		return true;
+	}
+
+	bool find(uint64_t handle, resource_handle *out_resource, api::resource_view_desc *out_desc) const
+	{
+		const std::shared_lock<std::shared_mutex> lock(mutex);
+		const auto it = views.find(handle);
+		if (it == views.end())
+			return false;
+		if (out_resource != nullptr)
+			*out_resource = it->second.first;
+		if (out_desc != nullptr)
+			*out_desc = it->second.second;
+		return true;
+	}
+
+	size_t memory_usage() const
+	{
+		// Estimate for the common node-based implementation: bucket array plus one node per element holding the value and a next pointer (and the cached hash)
+		return views.bucket_count() * sizeof(void *) + views.size() * (sizeof(std::pair<const uint64_t, std::pair<resource_handle, api::resource_view_desc>>) + 2 * sizeof(void *));
+	}
+
+	mutable std::shared_mutex mutex;
+	std::unordered_map<uint64_t, std::pair<resource_handle, api::resource_view_desc>> views;
+};
+
+// Wraps the view table with the same exclusive lock around modifications the device uses, while lookups go without
+struct locked_view_table
+{
+	explicit locked_view_table(uint32_t increment_size) : table(increment_size) {}
+
+	bool insert(uint64_t handle, resource_handle resource, const api::resource_view_desc &desc)
+	{
+		const std::unique_lock<std::shared_mutex> lock(mutex);
+		return table.insert(handle, resource, desc);
+	}
+
+	bool find(uint64_t handle, resource_handle *out_resource, api::resource_view_desc *out_desc) const
+	{
+		return table.find(handle, out_resource, out_desc);
+	}
+
+	size_t memory_usage() const
+	{
+		const std::shared_lock<std::shared_mutex> lock(mutex);
+		return table.memory_usage();
+	}
+
+	mutable std::shared_mutex mutex;
+	descriptor_view_table<resource_handle> table;
+};
+
+static api::resource_view_desc make_desc(uint64_t index)
+{
+	return api::resource_view_desc(api::resource_view_type::buffer, api::format::r32_typeless, index * 256, 256);
+}
+
+template <typename T>
+static bool run(const char *name, T &views, const std::vector<uint64_t> &handles, unsigned int num_readers)
+{
+	using clock = std::chrono::steady_clock;
+
+	bool success = true;
+
+	clock::time_point start = clock::now();
+	for (size_t i = 0; i < handles.size(); ++i)
+		if (!views.insert(handles[i], i + 1, make_desc(i)))
+			success = false;
+	const double insert_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count() / handles.size();
+
+	// Verify every view can be found again
+	for (size_t i = 0; i < handles.size(); ++i)
+	{
+		resource_handle resource = 0;
+		api::resource_view_desc desc;
+		if (!views.find(handles[i], &resource, &desc) || resource != i + 1 || desc.buffer.offset != i * 256)
+			success = false;
+	}
+
+	// Look up views from several threads, while another thread keeps writing views like an application creating descriptors during rendering
+	std::atomic<bool> stop = false;
+	std::atomic<uint64_t> num_lookups = 0;
+	std::vector<std::thread> readers;
+
+	start = clock::now();
+	for (unsigned int r = 0; r < num_readers; ++r)
+	{
+		readers.emplace_back([&, r]() {
+			std::mt19937 random(r);
+			uint64_t lookups = 0;
+			while (!stop.load(std::memory_order_relaxed))
+			{
+				for (int k = 0; k < 1024; ++k, ++lookups)
+				{
+					const size_t i = random() % handles.size();
+					resource_handle resource = 0;
+					if (!views.find(handles[i], &resource, nullptr) || resource != i + 1)
+						success = false;
+				}
+			}
+			num_lookups += lookups;
+		});
+	}
+
+	std::thread writer([&]() {
+		std::mt19937 random(42);
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			const size_t i = random() % handles.size();
+			views.insert(handles[i], i + 1, make_desc(i));
+		}
+	});
+
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	stop = true;
+	writer.join();
+	for (std::thread &reader : readers)
+		reader.join();
+
+	const double elapsed_ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+	const double find_ns = elapsed_ns * num_readers / num_lookups;
+
+	std::printf("%-34s %12.1f %12.1f %14.1f %12.1f\n", name, insert_ns, find_ns, num_lookups / (elapsed_ns / 1e9) / 1e6, views.memory_usage() / (1024.0 * 1024.0));
+
+	return success;
+}
+
+int main()
+{
+	// Shader resource view descriptors are typically 32 bytes apart, render target and depth stencil views can be as small as 8 bytes
+	constexpr uint32_t view_increment = 32;
+	constexpr uint32_t min_increment = 8;
+
+	// Simulate a large bindless heap plus many small heaps scattered across the address space, each starting at a 64 KiB aligned address
+	std::vector<uint64_t> handles;
+	std::mt19937_64 random(1);
+	for (uint64_t i = 0; i < (1 << 20); ++i)
+		handles.push_back(0x7FF000000000ull + i * view_increment);
+	for (uint32_t heap = 0; heap < 2048; ++heap)
+	{
+		const uint64_t base = 0x10000000000ull + (random() % (1ull << 30)) * 0x10000;
+		for (uint64_t i = 0; i < 64; ++i)
+			handles.push_back(base + i * view_increment);
+	}
+
+	const unsigned int num_readers = std::max(2u, std::thread::hardware_concurrency() - 1);
+
+	std::printf("%zu views, %u reader threads and 1 writer thread\n\n", handles.size(), num_readers);
+	std::printf("%-34s %12s %12s %14s %12s\n", "", "insert (ns)", "find (ns)", "finds (M/s)", "memory (MiB)");
+
+	bool success = true;
+	{
+		locked_view_map views;
+		success &= run("unordered_map + shared_mutex", views, handles, num_readers);
+	}
+	{
+		locked_view_table views(view_increment);
+		success &= run("view table (keyed by view size)", views, handles, num_readers);
+	}
+	{
+		// Keying by the smallest descriptor size leaves three out of four entries of every leaf unused
+		locked_view_table views(min_increment);
+		success &= run("view table (keyed by minimum size)", views, handles, num_readers);
+	}
+
+	if (!success)
+		std::fprintf(stderr, "error: a lookup returned the wrong view!\n");
+	return success ? 0 : 1;
+}
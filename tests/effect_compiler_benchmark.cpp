@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "effect_preprocessor.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <fstream>
+
+/// <summary>
+/// Generates an effect with the specified number of distinct constants, which stresses deduplication of types and constants in the code generators.
+/// Half of them are scalar literals and the other half vector constructors with constant arguments (which are emitted as composite constants), followed by a few uniforms that are turned into specialization constants in the SPIR-V backend with '--spec-constants'.
+/// </summary>
+static std::string generate_effect(size_t num_constants)
+{
+	std::string source;
+	source.reserve(num_constants * 64);
+
+	char line[256];
+
+	const size_t num_uniforms = num_constants / 100;
+	for (size_t i = 0; i < num_uniforms; ++i)
+	{
+		std::snprintf(line, sizeof(line), "uniform float u%zu < ui_type = \"drag\"; > = %zu.25;\n", i, i);
+		source += line;
+	}
+
+	source += "float4 PS(float4 pos : SV_Position, float2 uv : TEXCOORD) : SV_Target\n{\n\tfloat4 r = 0;\n";
+
+	for (size_t i = 0; i < num_uniforms; ++i)
+	{
+		std::snprintf(line, sizeof(line), "\tr.x += u%zu;\n", i);
+		source += line;
+	}
+
+	for (size_t i = 0; i < num_constants; i += 2)
+	{
+		// Keep each statement separate, so that the expressions do not become deeply nested
+		std::snprintf(line, sizeof(line), "\tr.x += uv.x * %zu.5;\n\tr += float4(%zu, %zu, %zu, uv.y);\n", i, i + 1, i + 2, i + 3);
+		source += line;
+	}
+
+	source += "\treturn r;\n}\n"
+		"void VS(uint id : SV_VertexID, out float4 pos : SV_Position, out float2 uv : TEXCOORD)\n{\n"
+		"\tuv.x = (id == 2) ? 2.0 : 0.0;\n\tuv.y = (id == 1) ? 2.0 : 0.0;\n\tpos = float4(uv * float2(2.0, -2.0) + float2(-1.0, 1.0), 0.0, 1.0);\n}\n"
+		"technique Constants\n{\n\tpass\n\t{\n\t\tVertexShader = VS;\n\t\tPixelShader = PS;\n\t}\n}\n";
+
+	return source;
+}
+
+struct compile_timings
+{
+	double preprocess_ms = 0.0;
+	double parse_ms = 0.0;
+	double codegen_ms = 0.0;
+};
+
+static bool compile(const std::string &source, reshadefx::codegen *(*create_backend)(), compile_timings &timings)
+{
+	using clock = std::chrono::high_resolution_clock;
+
+	const clock::time_point preprocess_start = clock::now();
+
+	reshadefx::preprocessor pp;
+	if (!pp.append_string(source, "generated.fx"))
+	{
+		std::fprintf(stderr, "%s", pp.errors().c_str());
+		return false;
+	}
+
+	const clock::time_point parse_start = clock::now();
+
+	const std::unique_ptr<reshadefx::codegen> backend(create_backend());
+
+	reshadefx::parser parser;
+	if (!parser.parse(pp.output(), backend.get()))
+	{
+		std::fprintf(stderr, "%s", parser.errors().c_str());
+		return false;
+	}
+
+	const clock::time_point codegen_start = clock::now();
+
+	const std::string code = backend->finalize_code();
+
+	const clock::time_point end = clock::now();
+
+	timings.preprocess_ms = std::chrono::duration<double, std::milli>(parse_start - preprocess_start).count();
+	timings.parse_ms = std::chrono::duration<double, std::milli>(codegen_start - parse_start).count();
+	timings.codegen_ms = std::chrono::duration<double, std::milli>(end - codegen_start).count();
+
+	return !code.empty();
+}
+
+int main(int argc, char *argv[])
+{
+	// Usage: effect_compiler_benchmark [number of constants] [path to write the generated effect to]
+	// The written effect can be passed to ReShadeFXC (e.g. "ReShadeFXC --stats --spec-constants constants.fx") to compare against the numbers printed here
+	const size_t num_constants = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+	const std::string source = generate_effect(num_constants);
+
+	if (argc > 2)
+	{
+		std::ofstream file(argv[2], std::ios::binary);
+		if (!(file << source))
+		{
+			std::fprintf(stderr, "error: failed to write generated effect to '%s'\n", argv[2]);
+			return 1;
+		}
+	}
+
+	static const struct
+	{
+		const char *name;
+		reshadefx::codegen *(*create_backend)();
+	} backends[] = {
+		{ "spirv", []() { return reshadefx::create_codegen_spirv(true, false, false); } },
+		{ "spirv (spec constants)", []() { return reshadefx::create_codegen_spirv(true, false, true); } },
+		{ "glsl", []() { return reshadefx::create_codegen_glsl(false, false, false); } },
+		{ "hlsl50", []() { return reshadefx::create_codegen_hlsl(50, false, false); } },
+	};
+
+	std::printf("%zu constants, %zu bytes of source\n", num_constants, source.size());
+	std::printf("%-24s %14s %14s %14s\n", "backend", "preprocess ms", "parse ms", "codegen ms");
+
+	for (const auto &backend : backends)
+	{
+		// Take the fastest of a few runs, to reduce noise from other processes
+		compile_timings best;
+		for (int run = 0; run < 3; ++run)
+		{
+			compile_timings timings;
+			if (!compile(source, backend.create_backend, timings))
+			{
+				std::fprintf(stderr, "error: failed to compile generated effect with %s backend\n", backend.name);
+				return 1;
+			}
+
+			if (run == 0 || timings.preprocess_ms + timings.parse_ms + timings.codegen_ms < best.preprocess_ms + best.parse_ms + best.codegen_ms)
+				best = timings;
+		}
+
+		std::printf("%-24s %14.2f %14.2f %14.2f\n", backend.name, best.preprocess_ms, best.parse_ms, best.codegen_ms);
+	}
+
+	return 0;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "format_conversion.hpp"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace format_conversion;
+
+static const char *const simd_level_names[] = { "scalar", "sse2", "avx2" };
+
+struct conversion
+{
+	const char *name;
+	bool (*function)(reshade::api::format format, const uint8_t *src, uint8_t *dst, size_t width);
+	reshade::api::format format;
+};
+
+static bool strip_alpha(reshade::api::format, const uint8_t *src, uint8_t *dst, size_t width)
+{
+	strip_alpha_rgba8(src, dst, width);
+	return true;
+}
+
+// Converts rows until the minimum duration has passed and returns the throughput in megapixels per second
+static double measure(const conversion &conv, const uint8_t *src, uint8_t *dst, size_t width, double min_seconds)
+{
+	using clock = std::chrono::steady_clock;
+
+	size_t pixels = 0;
+	const clock::time_point start = clock::now();
+	double elapsed = 0;
+
+	do
+	{
+		for (int i = 0; i < 256; ++i)
+			conv.function(conv.format, src, dst, width);
+		pixels += 256 * width;
+		elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	} while (elapsed < min_seconds);
+
+	return pixels / elapsed / 1e6;
+}
+
+int main(int argc, char *argv[])
+{
+	const double min_seconds = argc > 1 ? std::atof(argv[1]) : 0.05;
+
+	const conversion conversions[] = {
+		{ "r8 -> rgba8", &convert_row_to_rgba8, reshade::api::format::r8_unorm },
+		{ "r8g8 -> rgba8", &convert_row_to_rgba8, reshade::api::format::r8g8_unorm },
+		{ "l8a8 -> rgba8", &convert_row_to_rgba8, reshade::api::format::l8a8_unorm },
+		{ "rgbx8 -> rgba8", &convert_row_to_rgba8, reshade::api::format::r8g8b8x8_unorm },
+		{ "bgra8 -> rgba8", &convert_row_to_rgba8, reshade::api::format::b8g8r8a8_unorm },
+		{ "bgrx8 -> rgba8", &convert_row_to_rgba8, reshade::api::format::b8g8r8x8_unorm },
+		{ "rgb10a2 -> rgba8", &convert_row_to_rgba8, reshade::api::format::r10g10b10a2_unorm },
+		{ "bgr10a2 -> rgba8", &convert_row_to_rgba8, reshade::api::format::b10g10r10a2_unorm },
+		{ "rgba8 -> r8", &convert_row_from_rgba8, reshade::api::format::r8_unorm },
+		{ "rgba8 -> r8g8", &convert_row_from_rgba8, reshade::api::format::r8g8_unorm },
+		{ "rgba8 -> bgra8", &convert_row_from_rgba8, reshade::api::format::b8g8r8a8_unorm },
+		{ "rgba8 -> rgb8", &strip_alpha, reshade::api::format::unknown },
+	};
+	const size_t widths[] = { 3, 8, 16, 33, 64, 256, 1920, 3840 };
+
+	const simd_level max_level = get_max_simd_level();
+
+	std::mt19937 random(42);
+	std::vector<uint8_t> src(widths[std::size(widths) - 1] * 8);
+	for (uint8_t &value : src)
+		value = static_cast<uint8_t>(random());
+
+	std::vector<uint8_t> reference(src.size()), dst(src.size());
+
+	bool success = true;
+
+	std::printf("%-18s %6s", "conversion", "width");
+	for (int level = 0; level <= static_cast<int>(max_level); ++level)
+		std::printf(" %10s", simd_level_names[level]);
+	std::printf("   (megapixels per second)\n");
+
+	for (const conversion &conv : conversions)
+	{
+		for (const size_t width : widths)
+		{
+			std::printf("%-18s %6zu", conv.name, width);
+
+			for (int level = 0; level <= static_cast<int>(max_level); ++level)
+			{
+				set_max_simd_level(static_cast<simd_level>(level));
+
+				// Verify that every code path produces the same output as the scalar one
+				std::fill(dst.begin(), dst.end(), uint8_t(0xCD));
+				conv.function(conv.format, src.data(), dst.data(), width);
+				if (level == 0)
+					reference = dst;
+				else if (dst != reference)
+				{
+					std::fprintf(stderr, "\nerror: %s output of '%s' for width %zu does not match scalar output!\n", simd_level_names[level], conv.name, width);
+					success = false;
+				}
+
+				std::printf(" %10.1f", measure(conv, src.data(), dst.data(), width, min_seconds));
+			}
+
+			std::printf("\n");
+		}
+	}
+
+	set_max_simd_level(max_level);
+
+	return success ? 0 : 1;
+}
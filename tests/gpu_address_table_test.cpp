@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "gpu_address_table.hpp"
+#include <mutex>
+#include <thread>
+#include <random>
+#include <cstdio>
+
+using namespace reshade;
+
+static std::atomic<int> s_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+			++s_failures; \
+		} \
+	} while (0)
+
+static void test_insert_find_erase()
+{
+	gpu_address_table<uint32_t> table;
+
+	uint32_t resource = 0;
+	uint64_t offset = 0;
+	bool acceleration_structure = false;
+
+	CHECK(!table.find(0x10000, resource, offset, acceleration_structure));
+
+	CHECK(table.insert(1, 0x10000, 0x30000, false));
+	CHECK(table.insert(2, 0x80000, 0x100, true));
+
+	CHECK(table.find(0x10000, resource, offset, acceleration_structure) && resource == 1 && offset == 0 && !acceleration_structure);
+	CHECK(table.find(0x3FFFF, resource, offset, acceleration_structure) && resource == 1 && offset == 0x2FFFF);
+	CHECK(!table.find(0x40000, resource, offset, acceleration_structure));
+	CHECK(table.find(0x800FF, resource, offset, acceleration_structure) && resource == 2 && offset == 0xFF && acceleration_structure);
+	// Address is in a page referencing a buffer, but outside of that buffer
+	CHECK(!table.find(0x80100, resource, offset, acceleration_structure));
+
+	// Inserting the same resource again replaces its previous registration
+	CHECK(table.insert(1, 0x200000, 0x10000, false));
+	CHECK(!table.find(0x10000, resource, offset, acceleration_structure));
+	CHECK(table.find(0x208000, resource, offset, acceleration_structure) && resource == 1 && offset == 0x8000);
+
+	// Placed resources aliasing an older one take over its pages
+	CHECK(table.insert(3, 0x200000, 0x10000, false));
+	CHECK(table.find(0x200000, resource, offset, acceleration_structure) && resource == 3);
+	// Erasing the older resource must not clear pages that were taken over
+	table.erase(1);
+	CHECK(table.find(0x200000, resource, offset, acceleration_structure) && resource == 3);
+	table.erase(3);
+	CHECK(!table.find(0x200000, resource, offset, acceleration_structure));
+
+	// Erasing a resource that was never added does nothing
+	table.erase(42);
+	CHECK(table.find(0x80000, resource, offset, acceleration_structure) && resource == 2);
+
+	// Addresses outside the covered address space are rejected
+	CHECK(!table.insert(4, 1ull << 48, 0x10000, false));
+	CHECK(!table.insert(4, (1ull << 48) - 0x10000, 0x20000, false));
+	CHECK(!table.insert(4, 0x10000, 0, false));
+	CHECK(!table.find(1ull << 48, resource, offset, acceleration_structure));
+
+	// Highest page of the address space
+	CHECK(table.insert(5, (1ull << 48) - 0x10000, 0x10000, false));
+	CHECK(table.find((1ull << 48) - 1, resource, offset, acceleration_structure) && resource == 5 && offset == 0xFFFF);
+}
+
+static void test_entry_reuse()
+{
+	gpu_address_table<uint32_t> table;
+
+	uint32_t resource = 0;
+	uint64_t offset = 0;
+	bool acceleration_structure = false;
+
+	// Cycle through more resources than fit into a single entry block, with only a few alive at a time
+	for (uint32_t i = 1; i <= 20000; ++i)
+	{
+		CHECK(table.insert(i, uint64_t(i % 64) << 20, 0x10000, false));
+		if (i > 8)
+			table.erase(i - 8);
+	}
+
+	for (uint32_t i = 20000 - 7; i <= 20000; ++i)
+		CHECK(table.find((uint64_t(i % 64) << 20) + 0x1234, resource, offset, acceleration_structure) && resource == i && offset == 0x1234);
+	CHECK(!table.find(uint64_t((20000 - 8) % 64) << 20, resource, offset, acceleration_structure));
+}
+
+// Every resource always occupies the same address range, derived from its handle, so that readers can verify any result without synchronizing with the writers
+// Ranges of different resources overlap, to exercise pages being taken over and shared
+static constexpr uint32_t num_resources = 256;
+
+static uint64_t resource_address(uint32_t resource)
+{
+	return 0x100000000ull + uint64_t(resource % 64) * 0x30000 + uint64_t(resource / 64) * 0x100;
+}
+static uint64_t resource_size(uint32_t resource)
+{
+	return 0x10000 + uint64_t(resource % 7) * 0x8000;
+}
+
+static void test_concurrent_insert_erase_find()
+{
+	gpu_address_table<uint32_t> table;
+	std::mutex table_mutex; // Modifications have to be serialized by the caller
+
+	std::atomic<bool> stop = false;
+	std::atomic<uint64_t> num_found = 0;
+
+	const auto writer = [&](unsigned int seed) {
+		std::mt19937 random(seed);
+		for (int i = 0; i < 200000; ++i)
+		{
+			const uint32_t resource = 1 + random() % num_resources;
+
+			const std::unique_lock<std::mutex> lock(table_mutex);
+			if (random() % 2)
+			{
+				CHECK(table.insert(resource, resource_address(resource), resource_size(resource), (resource % 3) == 0));
+			}
+			else
+			{
+				table.erase(resource);
+			}
+		}
+	};
+	const auto reader = [&](unsigned int seed) {
+		std::mt19937 random(seed);
+		uint64_t found = 0;
+		while (!stop.load(std::memory_order_relaxed))
+		{
+			const uint64_t address = 0x100000000ull + random() % (64 * 0x30000 + 0x40000);
+
+			uint32_t resource = 0;
+			uint64_t offset = 0;
+			bool acceleration_structure = false;
+			if (table.find(address, resource, offset, acceleration_structure))
+			{
+				// Any result has to describe a resource that actually contains the address
+				CHECK(resource >= 1 && resource <= num_resources);
+				CHECK(address >= resource_address(resource) && offset == address - resource_address(resource) && offset < resource_size(resource));
+				CHECK(acceleration_structure == ((resource % 3) == 0));
+				++found;
+			}
+		}
+		num_found += found;
+	};
+
+	std::vector<std::thread> readers;
+	for (unsigned int i = 0; i < 4; ++i)
+		readers.emplace_back(reader, 100 + i);
+	std::vector<std::thread> writers;
+	for (unsigned int i = 0; i < 2; ++i)
+		writers.emplace_back(writer, 200 + i);
+
+	for (std::thread &thread : writers)
+		thread.join();
+	stop = true;
+	for (std::thread &thread : readers)
+		thread.join();
+
+	// Readers should have succeeded for a fair share of lookups, otherwise the test did not exercise much
+	CHECK(num_found > 0);
+
+	// Once every resource was erased again, no lookup may succeed anymore
+	for (uint32_t resource = 1; resource <= num_resources; ++resource)
+		table.erase(resource);
+	uint32_t resource = 0;
+	uint64_t offset = 0;
+	bool acceleration_structure = false;
+	for (uint64_t address = 0x100000000ull; address < 0x100000000ull + 64 * 0x30000 + 0x40000; address += 0x1000)
+		CHECK(!table.find(address, resource, offset, acceleration_structure));
+}
+
+int main()
+{
+	test_insert_find_erase();
+	test_entry_reuse();
+	test_concurrent_insert_erase_find();
+
+	if (s_failures != 0)
+		std::fprintf(stderr, "%d check(s) failed\n", s_failures.load());
+	return s_failures == 0 ? 0 : 1;
+}
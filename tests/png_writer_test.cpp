@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "png_writer.hpp"
+#include <zlib.h>
+#include <future>
+#include <random>
+#include <cstdio>
+#include <cstdlib> // std::abs
+#include <cstring> // std::memcmp
+
+using namespace reshade;
+
+static std::atomic<int> s_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+			++s_failures; \
+		} \
+	} while (0)
+
+static const char *const s_file_path = "png_writer_test.png";
+
+static uint32_t read_u32_be(const uint8_t *data)
+{
+	return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) | (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+}
+
+static uint8_t paeth_predictor(uint8_t a, uint8_t b, uint8_t c)
+{
+	const int p = a + b - c;
+	const int pa = std::abs(p - a);
+	const int pb = std::abs(p - b);
+	const int pc = std::abs(p - c);
+	return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+
+/// <summary>
+/// Decodes a PNG file written by <see cref="write_png_async"/>, using zlib as the reference implementation to inflate the image data.
+/// </summary>
+static bool decode_png(const std::vector<uint8_t> &file, uint32_t &width, uint32_t &height, uint32_t &channels, std::vector<uint8_t> &pixels)
+{
+	static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	if (file.size() < 8 || std::memcmp(file.data(), signature, 8) != 0)
+		return false;
+
+	std::vector<uint8_t> compressed;
+	bool has_header = false, has_end = false;
+
+	for (size_t offset = 8; offset < file.size() && !has_end;)
+	{
+		if (file.size() - offset < 12)
+			return false;
+
+		const uint32_t length = read_u32_be(file.data() + offset);
+		if (file.size() - offset - 12 < length)
+			return false;
+
+		const uint8_t *const type = file.data() + offset + 4;
+		const uint8_t *const data = type + 4;
+
+		// Checksum covers chunk type and data
+		if (read_u32_be(data + length) != static_cast<uint32_t>(crc32(0, type, 4 + length)))
+			return false;
+
+		if (std::memcmp(type, "IHDR", 4) == 0)
+		{
+			if (length != 13 || data[8] != 8 || (data[9] != 2 && data[9] != 6) || data[10] != 0 || data[11] != 0 || data[12] != 0)
+				return false;
+
+			width = read_u32_be(data);
+			height = read_u32_be(data + 4);
+			channels = data[9] == 6 ? 4 : 3;
+			has_header = true;
+		}
+		else if (std::memcmp(type, "IDAT", 4) == 0)
+		{
+			compressed.insert(compressed.end(), data, data + length);
+		}
+		else if (std::memcmp(type, "IEND", 4) == 0)
+		{
+			has_end = true;
+		}
+
+		offset += 12 + length;
+	}
+
+	if (!has_header || !has_end)
+		return false;
+
+	const size_t row_size = static_cast<size_t>(width) * channels;
+
+	// 'uncompress' verifies the zlib header and Adler-32 checksum too, and fails if the stream does not end exactly at the expected size
+	std::vector<uint8_t> filtered((row_size + 1) * height);
+	uLongf filtered_size = static_cast<uLongf>(filtered.size());
+	if (uncompress(filtered.data(), &filtered_size, compressed.data(), static_cast<uLong>(compressed.size())) != Z_OK || filtered_size != filtered.size())
+		return false;
+
+	pixels.resize(row_size * height);
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t filter = filtered[y * (row_size + 1)];
+		const uint8_t *const in = filtered.data() + y * (row_size + 1) + 1;
+		uint8_t *const row = pixels.data() + y * row_size;
+		const uint8_t *const prev_row = y != 0 ? row - row_size : nullptr;
+
+		for (size_t i = 0; i < row_size; ++i)
+		{
+			const uint8_t a = i >= channels ? row[i - channels] : 0;
+			const uint8_t b = prev_row != nullptr ? prev_row[i] : 0;
+			const uint8_t c = i >= channels && prev_row != nullptr ? prev_row[i - channels] : 0;
+
+			switch (filter)
+			{
+			case 0:
+				row[i] = in[i];
+				break;
+			case 1:
+				row[i] = static_cast<uint8_t>(in[i] + a);
+				break;
+			case 2:
+				row[i] = static_cast<uint8_t>(in[i] + b);
+				break;
+			case 3:
+				row[i] = static_cast<uint8_t>(in[i] + (a + b) / 2);
+				break;
+			case 4:
+				row[i] = static_cast<uint8_t>(in[i] + paeth_predictor(a, b, c));
+				break;
+			default:
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+enum class pattern
+{
+	noise,
+	gradient,
+	repeating,
+	solid,
+	mixed,
+};
+
+static std::vector<uint8_t> generate_pixels(uint32_t width, uint32_t height, uint32_t channels, pattern content)
+{
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * channels);
+
+	std::mt19937 rng(width * 31 + height * 17 + channels);
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			for (uint32_t c = 0; c < channels; ++c)
+			{
+				uint8_t &value = pixels[(static_cast<size_t>(y) * width + x) * channels + c];
+
+				switch (content)
+				{
+				case pattern::noise:
+					value = static_cast<uint8_t>(rng());
+					break;
+				case pattern::gradient:
+					value = static_cast<uint8_t>(x * (c + 1) + y * 3);
+					break;
+				case pattern::repeating:
+					// Short period horizontally and a longer one vertically, so that matches with small and large distances are found
+					value = static_cast<uint8_t>(((x % 7) * 40 + (y % 5) * 11) ^ c);
+					break;
+				case pattern::solid:
+					value = static_cast<uint8_t>(0x40 + c);
+					break;
+				case pattern::mixed:
+					// Alternate between noise and flat regions, so that blocks switch between literals and long matches
+					value = ((x / 16 + y / 16) % 2) != 0 ? static_cast<uint8_t>(rng()) : static_cast<uint8_t>(c * 60);
+					break;
+				}
+			}
+		}
+	}
+
+	return pixels;
+}
+
+static void test_round_trip(thread_pool &pool, uint32_t width, uint32_t height, uint32_t channels, pattern content)
+{
+	const std::vector<uint8_t> pixels = generate_pixels(width, height, channels, content);
+
+	FILE *const file = std::fopen(s_file_path, "wb");
+	CHECK(file != nullptr);
+	if (file == nullptr)
+		return;
+
+	std::promise<bool> written;
+
+	thread_pool::task_group group;
+	write_png_async(pool, group, file, width, height, channels, std::vector<uint8_t>(pixels), [&written](bool success) { written.set_value(success); });
+	pool.wait(group);
+
+	const bool success = written.get_future().get();
+	CHECK(success);
+
+	std::vector<uint8_t> contents;
+	if (FILE *const read_file = std::fopen(s_file_path, "rb"))
+	{
+		uint8_t buffer[65536];
+		for (size_t size; (size = std::fread(buffer, 1, sizeof(buffer), read_file)) != 0;)
+			contents.insert(contents.end(), buffer, buffer + size);
+		std::fclose(read_file);
+	}
+
+	uint32_t decoded_width = 0, decoded_height = 0, decoded_channels = 0;
+	std::vector<uint8_t> decoded_pixels;
+	const bool decoded = decode_png(contents, decoded_width, decoded_height, decoded_channels, decoded_pixels);
+	CHECK(decoded);
+	if (!decoded)
+	{
+		std::fprintf(stderr, "failed to decode %ux%u image with %u channels (pattern %d)\n", width, height, channels, static_cast<int>(content));
+		return;
+	}
+
+	CHECK(decoded_width == width);
+	CHECK(decoded_height == height);
+	CHECK(decoded_channels == channels);
+	CHECK(decoded_pixels == pixels);
+}
+
+static void test_invalid_input(thread_pool &pool)
+{
+	FILE *const file = std::fopen(s_file_path, "wb");
+	CHECK(file != nullptr);
+	if (file == nullptr)
+		return;
+
+	std::promise<bool> written;
+
+	// Fewer pixels than the dimensions require
+	thread_pool::task_group group;
+	write_png_async(pool, group, file, 16, 16, 4, std::vector<uint8_t>(16 * 15 * 4), [&written](bool success) { written.set_value(success); });
+	pool.wait(group);
+
+	CHECK(!written.get_future().get());
+}
+
+int main()
+{
+	thread_pool pool(4);
+
+	const pattern patterns[] = { pattern::noise, pattern::gradient, pattern::repeating, pattern::solid, pattern::mixed };
+
+	for (const uint32_t channels : { 3u, 4u })
+	{
+		for (const pattern content : patterns)
+		{
+			// Tiny and odd sizes, which fit into a single stripe
+			test_round_trip(pool, 1, 1, channels, content);
+			test_round_trip(pool, 3, 1, channels, content);
+			test_round_trip(pool, 1, 7, channels, content);
+			test_round_trip(pool, 13, 17, channels, content);
+			test_round_trip(pool, 257, 129, channels, content);
+
+			// Stripes are 1 MiB of pixel data, so these span multiple stripes, with the last one being partially filled
+			test_round_trip(pool, 1001, 701, channels, content);
+			// Height that is an exact multiple of the rows per stripe
+			test_round_trip(pool, 1024, 1024 * 1024 / (1024 * channels) * 3, channels, content);
+		}
+
+		// Rows that are larger than a stripe, so that every row ends up in a separate stripe
+		test_round_trip(pool, 300000, 3, channels, pattern::mixed);
+	}
+
+	test_invalid_input(pool);
+
+	std::remove(s_file_path);
+
+	if (s_failures != 0)
+		std::fprintf(stderr, "%d check(s) failed\n", s_failures.load());
+	return s_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,161 @@
+/*
+ * Copyright (C) 2025 Patrick Mours
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "temp_mem_arena.hpp"
+#include <thread>
+#include <iterator>
+#include <cstdio>
+
+using namespace reshade;
+
+static std::atomic<int> s_failures = 0;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			std::fprintf(stderr, "%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition); \
+			++s_failures; \
+		} \
+	} while (0)
+
+static void test_alignment()
+{
+	size_t marks[6];
+	const size_t alignments[] = { 1, 2, 8, 16, 64, 4096 };
+
+	// Start from an odd offset, so that every alignment actually has to pad
+	size_t first_mark = 0;
+	CHECK(temp_mem_arena::allocate(1, 1, first_mark) != nullptr);
+
+	for (size_t i = 0; i < std::size(alignments); ++i)
+	{
+		void *const p = temp_mem_arena::allocate(3, alignments[i], marks[i]);
+		CHECK(p != nullptr && (reinterpret_cast<uintptr_t>(p) % alignments[i]) == 0);
+	}
+
+	temp_mem_arena::release(first_mark);
+}
+
+static void test_lifo_rewind()
+{
+	size_t mark_a = 0, mark_b = 0, mark_c = 0;
+	uint8_t *const a = static_cast<uint8_t *>(temp_mem_arena::allocate(100, 16, mark_a));
+	uint8_t *const b = static_cast<uint8_t *>(temp_mem_arena::allocate(200, 16, mark_b));
+	CHECK(a != nullptr && b != nullptr && b >= a + 100);
+
+	// Releasing the most recent allocation hands out the same memory again
+	temp_mem_arena::release(mark_b);
+	CHECK(temp_mem_arena::allocate(200, 16, mark_c) == b && mark_c == mark_b);
+	temp_mem_arena::release(mark_c);
+
+	// Releasing an outer allocation also frees everything allocated after it
+	temp_mem_arena::release(mark_a);
+	CHECK(temp_mem_arena::allocate(100, 16, mark_c) == a && mark_c == mark_a);
+	temp_mem_arena::release(mark_c);
+
+	// Nested allocations released in reverse order (like scoped temporary arrays do) rewind the arena back to where it started
+	size_t outer_mark = 0, inner_mark = 0;
+	uint8_t *const outer = static_cast<uint8_t *>(temp_mem_arena::allocate(4000, 4, outer_mark));
+	uint8_t *const inner = static_cast<uint8_t *>(temp_mem_arena::allocate(4000, 4, inner_mark));
+	CHECK(outer == a && inner >= outer + 4000);
+	temp_mem_arena::release(inner_mark);
+	CHECK(temp_mem_arena::allocate(4000, 4, inner_mark) == inner);
+	temp_mem_arena::release(inner_mark);
+	temp_mem_arena::release(outer_mark);
+	CHECK(temp_mem_arena::allocate(4000, 4, outer_mark) == a);
+	temp_mem_arena::release(outer_mark);
+}
+
+static void test_exhaustion()
+{
+	const temp_mem_arena::statistics stats_before = temp_mem_arena::get_statistics();
+
+	size_t mark = 0, other_mark = 0;
+	void *const p = temp_mem_arena::allocate(temp_mem_arena::capacity - 1, 1, mark);
+	CHECK(p != nullptr);
+	CHECK(temp_mem_arena::allocate(128, 1, other_mark) == nullptr);
+	CHECK(temp_mem_arena::allocate(temp_mem_arena::capacity + 1, 1, other_mark) == nullptr);
+	// The last byte is still free, but alignment padding must not push an allocation past the end (the arena memory is at least aligned to 2 bytes, so that byte is at an odd address)
+	CHECK(temp_mem_arena::allocate(1, 2, other_mark) == nullptr);
+
+	// Once the large allocation was released, the space is available again
+	temp_mem_arena::release(mark);
+	CHECK(temp_mem_arena::allocate(128, 1, other_mark) == p);
+	temp_mem_arena::release(other_mark);
+
+	const temp_mem_arena::statistics stats_after = temp_mem_arena::get_statistics();
+	CHECK(stats_after.heap_allocations - stats_before.heap_allocations == 3); // Each failed request counts as one that fell back to the heap
+	CHECK(stats_after.arena_allocations - stats_before.arena_allocations == 2);
+	CHECK(stats_after.peak_usage >= temp_mem_arena::capacity - 1);
+}
+
+static void test_thread_isolation()
+{
+	const temp_mem_arena::statistics stats_before = temp_mem_arena::get_statistics();
+
+	// Exhaust the arena of this thread, which must not affect other threads
+	size_t mark = 0;
+	uint8_t *const p = static_cast<uint8_t *>(temp_mem_arena::allocate(temp_mem_arena::capacity, 1, mark));
+	CHECK(p != nullptr);
+
+	constexpr int num_threads = 4;
+	uint8_t *thread_memory[num_threads] = {};
+
+	std::thread threads[num_threads];
+	for (int t = 0; t < num_threads; ++t)
+	{
+		threads[t] = std::thread([t, &thread_memory]() {
+			size_t thread_mark = 0;
+			uint8_t *const q = static_cast<uint8_t *>(temp_mem_arena::allocate(1024, 16, thread_mark));
+			CHECK(q != nullptr && thread_mark == 0);
+			thread_memory[t] = q;
+
+			// Write a pattern and verify it after a while, to catch threads sharing memory
+			for (int round = 0; round < 1000; ++round)
+			{
+				for (size_t i = 0; i < 1024; ++i)
+					q[i] = static_cast<uint8_t>(t + round);
+				std::this_thread::yield();
+				for (size_t i = 0; i < 1024; ++i)
+					CHECK(q[i] == static_cast<uint8_t>(t + round));
+
+				size_t nested_mark = 0;
+				CHECK(temp_mem_arena::allocate(400, 4, nested_mark) == q + 1024 && nested_mark == 1024);
+				temp_mem_arena::release(nested_mark);
+			}
+
+			temp_mem_arena::release(thread_mark);
+		});
+	}
+	for (std::thread &thread : threads)
+		thread.join();
+
+	for (int t = 0; t < num_threads; ++t)
+	{
+		CHECK(thread_memory[t] != p);
+		for (int other = t + 1; other < num_threads; ++other)
+			CHECK(thread_memory[t] != thread_memory[other]);
+	}
+
+	temp_mem_arena::release(mark);
+
+	// Statistics of threads that already exited are still included
+	const temp_mem_arena::statistics stats_after = temp_mem_arena::get_statistics();
+	CHECK(stats_after.arena_allocations - stats_before.arena_allocations == 1 + num_threads * (1 + 1000));
+	CHECK(stats_after.heap_allocations == stats_before.heap_allocations);
+	CHECK(stats_after.peak_usage == temp_mem_arena::capacity);
+}
+
+int main()
+{
+	test_alignment();
+	test_lifo_rewind();
+	test_exhaustion();
+	test_thread_isolation();
+
+	if (s_failures != 0)
+		std::fprintf(stderr, "%d check(s) failed\n", s_failures.load());
+	return s_failures == 0 ? 0 : 1;
+}
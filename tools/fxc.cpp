@@ -7,13 +7,69 @@
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
 #include "version.h"
+#include "thread_pool.hpp"
+#include <new> // std::bad_alloc
+#include <chrono>
+#include <cstddef> // std::max_align_t
+#include <cstdlib> // std::free, std::malloc
+#include <algorithm> // std::sort
 #include <cstring>
 #include <fstream>
 #include <iostream>
 
+// Track heap usage of the whole process, so that '--stats' can report peak allocations of each compiler phase
+// This is only enabled with '--stats' (before any threads are started), since the shared counters would otherwise slow down every allocation of parallel compiles
+static bool s_track_allocations = false;
+static std::atomic<size_t> s_allocated_size = 0;
+static std::atomic<size_t> s_peak_allocated_size = 0;
+
+void *operator new(size_t size)
+{
+	// Prefix each allocation with its size, so that it can be subtracted again on deletion (or zero if it was not tracked, e.g. because it was made before tracking was enabled)
+	void *const ptr = std::malloc(size + sizeof(std::max_align_t));
+	if (ptr == nullptr)
+		throw std::bad_alloc();
+	*static_cast<size_t *>(ptr) = s_track_allocations ? size : 0;
+
+	if (s_track_allocations)
+	{
+		const size_t allocated_size = s_allocated_size += size;
+		for (size_t peak_allocated_size = s_peak_allocated_size; allocated_size > peak_allocated_size && !s_peak_allocated_size.compare_exchange_weak(peak_allocated_size, allocated_size);)
+			continue;
+	}
+
+	return static_cast<char *>(ptr) + sizeof(std::max_align_t);
+}
+void operator delete(void *ptr) noexcept
+{
+	if (ptr == nullptr)
+		return;
+
+	ptr = static_cast<char *>(ptr) - sizeof(std::max_align_t);
+	if (const size_t size = *static_cast<size_t *>(ptr))
+		s_allocated_size -= size;
+
+	std::free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+/// <summary>
+/// Resets the peak allocation size to the current allocation size and returns the latter, so that the peak of a following phase can be determined relative to it.
+/// </summary>
+static size_t begin_allocation_tracking()
+{
+	const size_t allocated_size = s_allocated_size;
+	s_peak_allocated_size = allocated_size;
+	return allocated_size;
+}
+
 static void print_usage(const char *path)
 {
 	printf(R"(usage: %s [options] <filename>
+       %s [options] --batch <directory|manifest>
 
 Options:
   -h, --help                Print this help.
@@ -37,12 +93,296 @@ Options:
   --vulkan-semantics        Generate GLSL/SPIR-V code under Vulkan semantics, instead of OpenGL semantics.
 
   -Zi                       Enable debug information.
-	)", path);
+  --stats                   Print time spent, tokens processed, macros expanded, instructions emitted and peak heap allocations of each compiler phase to standard error (or add them to the report in batch mode).
+
+Batch mode:
+  --batch <path>            Compile all effect files in the given directory (recursively), or listed in the given manifest file (one path per line), and print a JSON report to standard output.
+  --backends <list>         Comma-separated list of backends to compile each effect for. Can be spirv, glsl, hlsl30, hlsl40, hlsl41, hlsl50, hlsl51, hlsl60, ... Defaults to all.
+  -j <value>                Maximum number of effects to compile in parallel. Defaults to the number of processors.
+	)", path, path);
+}
+
+struct batch_backend
+{
+	std::string name;
+	unsigned int shader_model; // Zero for SPIR-V and GLSL
+	bool glsl;
+};
+struct batch_result
+{
+	bool success = false;
+	double preprocess_ms = 0.0;
+	double compile_ms = 0.0;
+	std::string errors;
+
+	size_t preprocess_tokens = 0;
+	size_t macro_expansions = 0;
+	double parse_ms = 0.0;
+	size_t parse_tokens = 0;
+	double codegen_ms = 0.0;
+	size_t instructions = 0;
+};
+
+static bool parse_shader_model(const char *value, unsigned int &shader_model)
+{
+	char *end = nullptr;
+	shader_model = static_cast<unsigned int>(std::strtoul(value, &end, 10));
+	if (end == value || *end != '\0')
+		return false;
+
+	switch (shader_model)
+	{
+	case 30:
+	case 40:
+	case 41:
+	case 50:
+	case 51:
+		return true;
+	default:
+		return shader_model >= 60 && shader_model <= 67;
+	}
+}
+
+static bool parse_backend_list(const char *list, std::vector<batch_backend> &backends)
+{
+	for (const char *next = list; *next != '\0';)
+	{
+		const char *end = std::strchr(next, ',');
+		if (end == nullptr)
+			end = next + std::strlen(next);
+
+		const std::string name(next, end);
+		if (name == "spirv")
+			backends.push_back({ name, 0, false });
+		else if (name == "glsl")
+			backends.push_back({ name, 0, true });
+		else if (unsigned int shader_model = 0;
+			name.compare(0, 4, "hlsl") == 0 && parse_shader_model(name.c_str() + 4, shader_model))
+			backends.push_back({ name, shader_model, false });
+		else
+			return false;
+
+		next = *end != '\0' ? end + 1 : end;
+	}
+
+	return !backends.empty();
+}
+
+static bool collect_batch_files(const std::filesystem::path &path, std::vector<std::filesystem::path> &files)
+{
+	std::error_code ec;
+
+	if (std::filesystem::is_directory(path, ec))
+	{
+		for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(path, std::filesystem::directory_options::skip_permission_denied, ec))
+			if (entry.is_regular_file(ec) && entry.path().extension() == ".fx")
+				files.push_back(entry.path());
+	}
+	else
+	{
+		std::ifstream manifest(path);
+		if (!manifest)
+			return false;
+
+		// Paths in the manifest are relative to the manifest itself
+		for (std::string line; std::getline(manifest, line);)
+		{
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			if (line.empty() || line[0] == '#')
+				continue;
+
+			files.push_back(path.parent_path() / std::filesystem::u8path(line));
+		}
+	}
+
+	// Sort to make the report order independent of file system enumeration order
+	std::sort(files.begin(), files.end());
+
+	return true;
+}
+
+static std::string escape_json_string(const std::string &s)
+{
+	std::string result;
+	result.reserve(s.size() + 2);
+	result += '\"';
+	for (const char c : s)
+	{
+		switch (c)
+		{
+		case '\"':
+			result += "\\\"";
+			break;
+		case '\\':
+			result += "\\\\";
+			break;
+		case '\n':
+			result += "\\n";
+			break;
+		case '\r':
+			result += "\\r";
+			break;
+		case '\t':
+			result += "\\t";
+			break;
+		default:
+			if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char hex[7];
+				std::snprintf(hex, sizeof(hex), "\\u%04x", c);
+				result += hex;
+			}
+			else
+			{
+				result += c;
+			}
+			break;
+		}
+	}
+	result += '\"';
+	return result;
+}
+
+static int run_batch(
+	const std::filesystem::path &batch_path,
+	const std::vector<batch_backend> &backends,
+	const std::vector<std::pair<std::string, std::string>> &macros,
+	const std::vector<std::filesystem::path> &include_paths,
+	size_t num_threads,
+	bool debug_info,
+	bool invert_y_axis,
+	bool spec_constants,
+	bool vulkan_semantics,
+	bool print_stats)
+{
+	std::vector<std::filesystem::path> files;
+	if (!collect_batch_files(batch_path, files))
+	{
+		std::cout << "error: Failed to open manifest file '" << batch_path.u8string() << '\'' << std::endl;
+		return 1;
+	}
+
+	const auto batch_start = std::chrono::high_resolution_clock::now();
+	const size_t allocated_size_at_start = begin_allocation_tracking();
+
+	// Results are indexed by file and backend, so that tasks can write them without synchronization
+	std::vector<batch_result> results(files.size() * backends.size());
+	const std::shared_ptr<reshadefx::file_cache> file_cache = std::make_shared<reshadefx::file_cache>();
+
+	{
+		thread_pool pool(num_threads);
+		thread_pool::task_group tasks;
+
+		for (size_t file_index = 0; file_index < files.size(); ++file_index)
+		{
+			pool.submit(tasks, [&, file_index]() {
+				const auto preprocess_start = std::chrono::high_resolution_clock::now();
+
+				// Preprocessing does not depend on the backend, so only do it once per file and share the output between all backends
+				const std::shared_ptr<reshadefx::preprocessor> pp = std::make_shared<reshadefx::preprocessor>();
+				pp->set_file_cache(file_cache);
+				for (const std::filesystem::path &include_path : include_paths)
+					pp->add_include_path(include_path);
+				for (const std::pair<std::string, std::string> &macro : macros)
+					pp->add_macro_definition(macro.first, macro.second);
+
+				const bool preprocess_success = pp->append_file(files[file_index]);
+
+				const double preprocess_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - preprocess_start).count();
+
+				for (size_t backend_index = 0; backend_index < backends.size(); ++backend_index)
+				{
+					batch_result &result = results[file_index * backends.size() + backend_index];
+					result.preprocess_ms = preprocess_ms;
+					result.preprocess_tokens = pp->stats().num_tokens;
+					result.macro_expansions = pp->stats().num_macro_expansions;
+
+					if (!preprocess_success)
+					{
+						result.errors = pp->errors();
+						continue;
+					}
+
+					pool.submit(tasks, [&, pp, backend_index]() {
+						const batch_backend &backend_info = backends[backend_index];
+						const auto compile_start = std::chrono::high_resolution_clock::now();
+
+						std::unique_ptr<reshadefx::codegen> backend;
+						if (backend_info.glsl)
+							backend.reset(reshadefx::create_codegen_glsl(vulkan_semantics, debug_info, spec_constants, false, invert_y_axis));
+						else if (backend_info.shader_model != 0)
+							backend.reset(reshadefx::create_codegen_hlsl(backend_info.shader_model, debug_info, spec_constants));
+						else
+							backend.reset(reshadefx::create_codegen_spirv(vulkan_semantics, debug_info, spec_constants, false, invert_y_axis));
+
+						reshadefx::parser parser;
+						result.success = parser.parse(pp->output(), backend.get());
+						result.parse_ms = std::chrono::duration<double, std::milli>(parser.stats().duration).count();
+						result.parse_tokens = parser.stats().num_tokens;
+
+						if (result.success)
+						{
+							const auto codegen_start = std::chrono::high_resolution_clock::now();
+							backend->finalize_code();
+							result.codegen_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - codegen_start).count();
+						}
+
+						result.instructions = backend->num_instructions();
+						result.compile_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - compile_start).count();
+						result.errors = pp->errors() + parser.errors();
+					});
+				}
+			});
+		}
+
+		pool.wait(tasks);
+	}
+
+	const double batch_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - batch_start).count();
+
+	size_t num_failed = 0;
+
+	std::cout << "{\n  \"results\": [";
+	for (size_t file_index = 0; file_index < files.size(); ++file_index)
+	{
+		for (size_t backend_index = 0; backend_index < backends.size(); ++backend_index)
+		{
+			const batch_result &result = results[file_index * backends.size() + backend_index];
+			if (!result.success)
+				num_failed++;
+
+			std::cout << (file_index == 0 && backend_index == 0 ? "\n" : ",\n")
+				<< "    { \"file\": " << escape_json_string(files[file_index].u8string())
+				<< ", \"backend\": " << escape_json_string(backends[backend_index].name)
+				<< ", \"success\": " << (result.success ? "true" : "false")
+				<< ", \"preprocess_ms\": " << result.preprocess_ms
+				<< ", \"compile_ms\": " << result.compile_ms;
+			if (print_stats)
+				std::cout
+					<< ", \"preprocess_tokens\": " << result.preprocess_tokens
+					<< ", \"macro_expansions\": " << result.macro_expansions
+					<< ", \"parse_ms\": " << result.parse_ms
+					<< ", \"parse_tokens\": " << result.parse_tokens
+					<< ", \"codegen_ms\": " << result.codegen_ms
+					<< ", \"instructions\": " << result.instructions;
+			std::cout << ", \"errors\": " << escape_json_string(result.errors) << " }";
+		}
+	}
+	std::cout << "\n  ],\n"
+		<< "  \"num_files\": " << files.size() << ",\n"
+		<< "  \"num_failed\": " << num_failed << ",\n";
+	if (print_stats)
+		std::cout << "  \"peak_allocated_bytes\": " << (s_peak_allocated_size - allocated_size_at_start) << ",\n";
+	std::cout << "  \"total_ms\": " << batch_ms << "\n}" << std::endl;
+
+	return num_failed == 0 ? 0 : 1;
 }
 
 int main(int argc, char *argv[])
 {
 	const char *source_file = nullptr;
+	const char *batch_path = nullptr;
 	const char *preprocess_file = nullptr;
 	const char *error_file = nullptr;
 	const char *object_file = nullptr;
@@ -54,11 +394,17 @@ int main(int argc, char *argv[])
 	bool invert_y_axis = false;
 	bool spec_constants = false;
 	bool vulkan_semantics = false;
+	bool print_stats = false;
 	unsigned int shader_model = 50;
+	size_t num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	std::vector<batch_backend> batch_backends;
 
-	reshadefx::preprocessor pp;
-	pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
-	pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", "0");
+	// Keep track of macros and include paths, so they can be applied to every preprocessor instance in batch mode
+	std::vector<std::pair<std::string, std::string>> macros;
+	std::vector<std::filesystem::path> include_paths;
+
+	macros.emplace_back("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
+	macros.emplace_back("__RESHADE_PERFORMANCE_MODE__", "0");
 
 	// Parse command-line arguments
 	for (int i = 1; i < argc; ++i)
@@ -81,13 +427,13 @@ int main(int argc, char *argv[])
 				char *name = argv[++i];
 				char *value = std::strchr(name, '=');
 				if (value) *value++ = '\0';
-				pp.add_macro_definition(name, value ? value : "1");
+				macros.emplace_back(name, value ? value : "1");
 				continue;
 			}
 
 			if (0 == std::strcmp(arg, "-I"))
 			{
-				pp.add_include_path(argv[++i]);
+				include_paths.push_back(argv[++i]);
 				continue;
 			}
 
@@ -103,6 +449,8 @@ int main(int argc, char *argv[])
 				spec_constants = true;
 			else if (0 == std::strcmp(arg, "--vulkan-semantics"))
 				vulkan_semantics = true;
+			else if (0 == std::strcmp(arg, "--stats"))
+				print_stats = s_track_allocations = true;
 
 			if (i + 1 >= argc)
 				continue;
@@ -118,6 +466,16 @@ int main(int argc, char *argv[])
 				buffer_width = argv[++i];
 			else if (0 == std::strcmp(arg, "--height"))
 				buffer_height = argv[++i];
+			else if (0 == std::strcmp(arg, "--batch"))
+				batch_path = argv[++i];
+			else if (0 == std::strcmp(arg, "-j"))
+				num_threads = std::max(std::strtoul(argv[++i], nullptr, 10), 1ul);
+			else if (0 == std::strcmp(arg, "--backends") && !parse_backend_list(argv[++i], batch_backends))
+			{
+				std::cout << "error: Invalid backend list '" << argv[i] << '\'' << std::endl;
+				print_usage(argv[0]);
+				return 1;
+			}
 		}
 		else
 		{
@@ -131,18 +489,61 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	macros.emplace_back("BUFFER_WIDTH", buffer_width);
+	macros.emplace_back("BUFFER_HEIGHT", buffer_height);
+	macros.emplace_back("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
+	macros.emplace_back("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+
+	if (batch_path != nullptr)
+	{
+		if (source_file != nullptr || print_glsl || print_hlsl || object_file || preprocess_file)
+		{
+			print_usage(argv[0]);
+			return 1;
+		}
+
+		if (batch_backends.empty())
+			parse_backend_list("spirv,glsl,hlsl30,hlsl40,hlsl50", batch_backends);
+
+		return run_batch(batch_path, batch_backends, macros, include_paths, num_threads, debug_info, invert_y_axis, spec_constants, vulkan_semantics, print_stats);
+	}
+
 	if (source_file == nullptr || (print_glsl && print_hlsl) || (print_glsl && object_file) || (print_hlsl && object_file))
 	{
 		print_usage(argv[0]);
 		return 1;
 	}
 
-	pp.add_macro_definition("BUFFER_WIDTH", buffer_width);
-	pp.add_macro_definition("BUFFER_HEIGHT", buffer_height);
-	pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
-	pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+	reshadefx::preprocessor pp;
+	for (const std::filesystem::path &include_path : include_paths)
+		pp.add_include_path(include_path);
+	for (const std::pair<std::string, std::string> &macro : macros)
+		pp.add_macro_definition(macro.first, macro.second);
+
+	size_t allocated_size_at_start = begin_allocation_tracking();
 
-	if (!pp.append_file(source_file))
+	const bool preprocess_success = pp.append_file(source_file);
+
+	if (print_stats)
+	{
+		const reshadefx::preprocessor::statistics &stats = pp.stats();
+
+		std::cerr << "preprocessor: " << std::chrono::duration<double, std::milli>(stats.duration).count() << " ms, "
+			<< stats.num_tokens << " tokens, "
+			<< stats.num_macro_expansions << " macro expansions, "
+			<< (s_peak_allocated_size - allocated_size_at_start) << " bytes peak allocated" << std::endl;
+
+		std::vector<std::pair<std::string, reshadefx::preprocessor::file_statistics>> files(stats.files.begin(), stats.files.end());
+		std::sort(files.begin(), files.end(),
+			[](const auto &lhs, const auto &rhs) { return lhs.second.num_tokens > rhs.second.num_tokens; });
+		for (const std::pair<std::string, reshadefx::preprocessor::file_statistics> &file : files)
+			std::cerr << "  " << file.first << ": "
+				<< file.second.size << " bytes, "
+				<< file.second.num_tokens << " tokens, "
+				<< file.second.num_macro_expansions << " macro expansions" << std::endl;
+	}
+
+	if (!preprocess_success)
 	{
 		if (error_file == nullptr)
 			std::cout << pp.errors() << std::endl;
@@ -168,8 +569,17 @@ int main(int argc, char *argv[])
 	else
 		backend.reset(reshadefx::create_codegen_spirv(vulkan_semantics, debug_info, spec_constants, invert_y_axis));
 
+	allocated_size_at_start = begin_allocation_tracking();
+
 	reshadefx::parser parser;
-	if (!parser.parse(pp.output(), backend.get()))
+	const bool parse_success = parser.parse(pp.output(), backend.get());
+
+	if (print_stats)
+		std::cerr << "parser: " << std::chrono::duration<double, std::milli>(parser.stats().duration).count() << " ms, "
+			<< parser.stats().num_tokens << " tokens, "
+			<< (s_peak_allocated_size - allocated_size_at_start) << " bytes peak allocated" << std::endl;
+
+	if (!parse_success)
 	{
 		if (error_file == nullptr)
 			std::cout << pp.errors() << parser.errors() << std::endl;
@@ -178,8 +588,17 @@ int main(int argc, char *argv[])
 		return 1;
 	}
 
+	allocated_size_at_start = begin_allocation_tracking();
+	const auto codegen_start = std::chrono::high_resolution_clock::now();
+
 	std::basic_string<char> code = backend->finalize_code();
 
+	if (print_stats)
+		std::cerr << "codegen: " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - codegen_start).count() << " ms, "
+			<< backend->num_instructions() << " instructions, "
+			<< code.size() << " bytes output, "
+			<< (s_peak_allocated_size - allocated_size_at_start) << " bytes peak allocated" << std::endl;
+
 	if (print_glsl || print_hlsl)
 	{
 		std::cout.write(code.data(), code.size()).flush();